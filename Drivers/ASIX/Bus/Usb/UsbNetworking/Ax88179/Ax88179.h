@@ -69,7 +69,12 @@
 #define USB_NETWORK_CLASS   0x09    ///<  USB Network class code
 #define USB_BUS_TIMEOUT     1000    ///<  USB timeout in milliseconds
 
-#define AX88179_BULKIN_SIZE_INK     2
+//
+//  The device aggregates received frames into bulk-in transfers of up to
+//  (RXBINQSIZE + 2) KB. The buffer must hold a whole aggregate, a smaller
+//  one splits it over several transfers and caps the frames per poll.
+//
+#define AX88179_BULKIN_SIZE_INK     14
 #define AX88179_MAX_BULKIN_SIZE    (1024 * AX88179_BULKIN_SIZE_INK)
 #define AX88179_MAX_PKT_SIZE  2048
 
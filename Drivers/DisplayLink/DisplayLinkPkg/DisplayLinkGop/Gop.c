@@ -69,6 +69,27 @@ CheckBounds (
   return EFI_SUCCESS;
 }
 
+/**
+ * Extend the area of the screen that is "dirty" - that we need to send in the next screen update.
+ * @param UsbDisplayLinkDev
+ * @param DestinationY
+ * @param Height
+ */
+STATIC VOID
+MarkRowsDirty (
+  IN  USB_DISPLAYLINK_DEV                     *UsbDisplayLinkDev,
+  IN  UINTN                                   DestinationY,
+  IN  UINTN                                   Height
+)
+{
+  if (DestinationY < UsbDisplayLinkDev->LastY1) {
+    UsbDisplayLinkDev->LastY1 = DestinationY;
+  }
+  if ((DestinationY + Height) > UsbDisplayLinkDev->LastY2) {
+    UsbDisplayLinkDev->LastY2 = DestinationY + Height;
+  }
+}
+
 /**
  * Update the local copy of the Frame Buffer. This local copy is periodically transmitted to the
  * DisplayLink device (via DlGopSendScreenUpdate)
@@ -121,13 +142,7 @@ BuildBackBuffer (
 
   case EfiBltBufferToVideo:
   {
-    // Update the store of the area of the screen that is "dirty" - that we need to send in the next screen update.
-    if (DestinationY < UsbDisplayLinkDev->LastY1) {
-      UsbDisplayLinkDev->LastY1 = DestinationY;
-    }
-    if ((DestinationY + Height) > UsbDisplayLinkDev->LastY2) {
-      UsbDisplayLinkDev->LastY2 = DestinationY + Height;
-    }
+    MarkRowsDirty (UsbDisplayLinkDev, DestinationY, Height);
 
     EFI_GRAPHICS_OUTPUT_BLT_PIXEL* Blt;
     EFI_GRAPHICS_OUTPUT_BLT_PIXEL* DstB;
@@ -146,6 +161,8 @@ BuildBackBuffer (
 
   case EfiBltVideoToVideo:
   {
+    MarkRowsDirty (UsbDisplayLinkDev, DestinationY, Height);
+
     EFI_GRAPHICS_OUTPUT_BLT_PIXEL* SrcB;
     EFI_GRAPHICS_OUTPUT_BLT_PIXEL* DstB;
     SrcB = UsbDisplayLinkDev->Screen + SourceY * PixelsPerScanLine + SourceX;
@@ -163,6 +180,8 @@ BuildBackBuffer (
 
   case EfiBltVideoFill:
   {
+    MarkRowsDirty (UsbDisplayLinkDev, DestinationY, Height);
+
     EFI_GRAPHICS_OUTPUT_BLT_PIXEL* DstB;
     DstB = UsbDisplayLinkDev->Screen + DestinationY * PixelsPerScanLine + DestinationX;
     for (H = 0; H < Height; H++) {
@@ -269,7 +288,7 @@ DlGopSendScreenUpdate (
   // This allows us to update a hot-plugged monitor quickly.
   if (UsbDisplayLinkDev->TimeSinceLastScreenUpdate > DISPLAYLINK_FULL_SCREEN_UPDATE_PERIOD) {
     UsbDisplayLinkDev->LastY1 = 0;
-    UsbDisplayLinkDev->LastY2 = UsbDisplayLinkDev->GraphicsOutputProtocol.Mode->Info->HorizontalResolution - 1;
+    UsbDisplayLinkDev->LastY2 = UsbDisplayLinkDev->GraphicsOutputProtocol.Mode->Info->VerticalResolution;
   }
 
   // If there has been no BLT since the last update/poll, drop out quietly.
@@ -282,50 +301,58 @@ DlGopSendScreenUpdate (
 
   EFI_TPL OriginalTPL = gBS->RaiseTPL (TPL_NOTIFY);
 
+  UINTN LineLen;
   UINTN DataLen;
   UINTN Width;
   UINTN Height;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL* SrcPtr;
   UINT8* DstPtr;
-  UINT8 DstBuffer[1920 * 3]; // Get rid of the magic numbers at some point
-                             // Could also use a buffer allocated at runtime to store the line, stored in the USB_DISPLAYLINK_DEV structure.
   UINTN H;
+  UINTN W;
 
-  DataLen = UsbDisplayLinkDev->GraphicsOutputProtocol.Mode->Info->HorizontalResolution * 3; // Send 1 line @ 24 bits per pixel
   Width = UsbDisplayLinkDev->GraphicsOutputProtocol.Mode->Info->HorizontalResolution;
   Height = UsbDisplayLinkDev->GraphicsOutputProtocol.Mode->Info->VerticalResolution;
-  SrcPtr = UsbDisplayLinkDev->Screen;
-  DstPtr = DstBuffer;
+  LineLen = Width * DISPLAYLINK_BYTES_PER_PIXEL; // Send 1 line @ 24 bits per pixel
+  DataLen = LineLen;
+
+  // A line whose length is divisible by USB MaxPacketSize must be followed by a short packet. Rather than
+  // doing an extra DlUsbBulkWrite, send a couple more bytes in the same transfer: they are the start of the
+  // next line (or the padding at the end of the buffer), and just get written into the (invisible) stride area.
+  // Note that the API doesn't let us do a bulk write of 0.
+  if ((LineLen & (UsbDisplayLinkDev->BulkOutEndpointDescriptor.MaxPacketSize - 1)) == 0) {
+    DataLen += DISPLAYLINK_LINE_PADDING;
+  }
 
-  for (H = 0; H < Height; H++) {
-    DstPtr = DstBuffer;
+  if (UsbDisplayLinkDev->LastY2 > Height) {
+    UsbDisplayLinkDev->LastY2 = Height;
+  }
+
+  // Only the lines that have been BLTted to since the last update need converting. The rest of the
+  // wire buffer already holds what the device was sent last time.
+  for (H = UsbDisplayLinkDev->LastY1; H < UsbDisplayLinkDev->LastY2; H++) {
+    SrcPtr = UsbDisplayLinkDev->Screen + H * Width;
+    DstPtr = UsbDisplayLinkDev->WireBuffer + H * LineLen;
 
-    UINTN W;
     for (W = 0; W < Width; W++) {
       // Need to swap round the RGB values
-      DstPtr[0] = ((UINT8 *)SrcPtr)[2];
-      DstPtr[1] = ((UINT8 *)SrcPtr)[1];
-      DstPtr[2] = ((UINT8 *)SrcPtr)[0];
+      DstPtr[0] = SrcPtr->Red;
+      DstPtr[1] = SrcPtr->Green;
+      DstPtr[2] = SrcPtr->Blue;
       SrcPtr++;
-      DstPtr += 3;
+      DstPtr += DISPLAYLINK_BYTES_PER_PIXEL;
     }
+  }
 
-    Status = DlUsbBulkWrite (UsbDisplayLinkDev, DstBuffer, DataLen, &USBStatus);
+  // The device expects every line of the frame, in order, so the lines outside the dirty area still
+  // have to be sent, but they go straight from the wire buffer.
+  for (H = 0; H < Height; H++) {
+    Status = DlUsbBulkWrite (UsbDisplayLinkDev, UsbDisplayLinkDev->WireBuffer + H * LineLen, DataLen, &USBStatus);
 
     // USBStatus values defined in usbio.h, e.g. EFI_USB_ERR_TIMEOUT 0x40
     if (EFI_ERROR (Status)) {
       DEBUG ((DEBUG_ERROR, "Screen update - USB bulk transfer of pixel data failed. Line %d len %d, failure code %r USB status x%x\n", H, DataLen, Status, USBStatus));
       break;
     }
-    // Need an extra DlUsbBulkWrite if the data length is divisible by USB MaxPacketSize. This spare data will just get written into the (invisible) stride area.
-    // Note that the API doesn't let us do a bulk write of 0.
-    if ((DataLen & (UsbDisplayLinkDev->BulkOutEndpointDescriptor.MaxPacketSize - 1)) == 0) {
-      Status = DlUsbBulkWrite (UsbDisplayLinkDev, DstBuffer, 2, &USBStatus);
-      if (EFI_ERROR (Status)) {
-        DEBUG ((DEBUG_ERROR, "Screen update - USB bulk transfer of pixel data failed. Line %d len %d, failure code %r USB status x%x\n", H, DataLen, Status, USBStatus));
-        break;
-      }
-    }
   }
 
   if (!EFI_ERROR (Status)) {
@@ -337,7 +364,7 @@ DlGopSendScreenUpdate (
 
   // Payload with length of 1 to terminate the frame
   // We need to do this even if we had an error, to indicate to the DL device that it should now expect a new frame.
-  DlUsbBulkWrite (UsbDisplayLinkDev, DstBuffer, 1, &USBStatus);
+  DlUsbBulkWrite (UsbDisplayLinkDev, UsbDisplayLinkDev->WireBuffer, 1, &USBStatus);
 
   gBS->RestoreTPL (OriginalTPL);
 
@@ -486,6 +513,21 @@ DisplayLinkSetMode (
     return EFI_OUT_OF_RESOURCES;
   }
 
+  if (UsbDisplayLinkDev->WireBuffer != NULL) {
+    FreePool (UsbDisplayLinkDev->WireBuffer);
+  }
+
+  UsbDisplayLinkDev->WireBuffer = (UINT8*)AllocateZeroPool (
+    Gop->Mode->Info->HorizontalResolution *
+    Gop->Mode->Info->VerticalResolution *
+    DISPLAYLINK_BYTES_PER_PIXEL + DISPLAYLINK_LINE_PADDING);
+
+  if (UsbDisplayLinkDev->WireBuffer == NULL) {
+    FreePool (UsbDisplayLinkDev->Screen);
+    UsbDisplayLinkDev->Screen = NULL;
+    return EFI_OUT_OF_RESOURCES;
+  }
+
   DEBUG ((DEBUG_INFO, "Video mode %d selected by BIOS - %d x %d.\n", ModeNumber, VideoMode->HActive, VideoMode->VActive));
   // Wait until we are sure that we can set the video mode before we tell the firmware
   Status = DlUsbSendControlWriteMessage (UsbDisplayLinkDev, SET_VIDEO_MODE, 0, VideoMode, sizeof (struct VideoMode));
@@ -496,6 +538,8 @@ DisplayLinkSetMode (
     Gop->Mode->Mode = GRAPHICS_OUTPUT_INVALID_MODE_NUMBER;
     FreePool (UsbDisplayLinkDev->Screen);
     UsbDisplayLinkDev->Screen = NULL;
+    FreePool (UsbDisplayLinkDev->WireBuffer);
+    UsbDisplayLinkDev->WireBuffer = NULL;
   } else {
     BuildBackBuffer (
       UsbDisplayLinkDev,
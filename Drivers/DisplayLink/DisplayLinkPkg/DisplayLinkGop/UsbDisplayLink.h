@@ -44,6 +44,10 @@
 
 #define DISPLAYLINK_FIXED_VERTICAL_REFRESH_RATE ((UINT16)60)
 
+#define DISPLAYLINK_BYTES_PER_PIXEL     3
+// Bytes added to a line transfer that is a multiple of the max packet size, so it ends with a short packet
+#define DISPLAYLINK_LINE_PADDING        2
+
 // Requests to read values from the firmware
 #define EDID_BLOCK_SIZE 128
 #define EDID_DETAILED_TIMING_INVALID_PIXEL_CLOCK ((UINT16)(0x64))
@@ -80,6 +84,7 @@ typedef struct {
   EFI_EDID_ACTIVE_PROTOCOL      EdidActive;
   EFI_UNICODE_STRING_TABLE      *ControllerNameTable;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Screen;
+  UINT8                         *WireBuffer;                   /** Copy of Screen in the 24 bpp RGB format sent to the device */
   UINTN                         DataSent;                       /** Debug - used to track the bandwidth */
   EFI_EVENT                     TimerEvent;
   EFI_EVENT                     DriverExitBootServicesEvent;
@@ -110,6 +110,281 @@ ReadWriteRpmb (
   return Status;
 }
 
+/**
+  Writes the staged ranges of the memory copy to the RPMB, in the order they
+  were staged.
+
+  Writes and erases only update the memory copy and stage the range they
+  touched. The staged ranges are written to the RPMB at the end of every MMI,
+  i.e. once the variable driver has completed the SetVariable() request that
+  caused them. If power is lost before that, the RPMB still holds the store as
+  it was after the previous request. If power is lost while flushing, the
+  RPMB holds a prefix of the writes in the order the upper layers issued
+  them, which is what the variable and FTW drivers recover from.
+
+  If flushing at the end of an MMI fails, the driver falls back to writing
+  through, and writes and erases fail until the ranges left over have been
+  written, see FlushFailedRanges ().
+
+  @param[in,out] Instance     MEM_INSTANCE pointer describing the device
+
+  @retval        EFI_SUCCESS  All staged ranges were written
+  @retval        Others       Writing a range failed. That range and the ones
+                              staged after it are kept.
+**/
+STATIC
+EFI_STATUS
+FlushDirtyRanges (
+  IN OUT MEM_INSTANCE *Instance
+  )
+{
+  EFI_STATUS Status;
+  UINTN      Index;
+
+  Status = EFI_SUCCESS;
+  for (Index = 0; Index < Instance->NDirtyRanges; Index++) {
+    Status = ReadWriteRpmb (
+               SP_SVC_RPMB_WRITE,
+               (UINTN)Instance->MemBaseAddress + Instance->DirtyRanges[Index].Offset,
+               Instance->DirtyRanges[Index].Length,
+               Instance->DirtyRanges[Index].Offset
+               );
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+  }
+
+  Instance->NDirtyRanges -= Index;
+  CopyMem (
+    Instance->DirtyRanges,
+    &Instance->DirtyRanges[Index],
+    Instance->NDirtyRanges * sizeof (RPMB_DIRTY_RANGE)
+    );
+
+  return Status;
+}
+
+/**
+  Writes the ranges a failed end of MMI flush left staged. Must be called
+  before a write or erase changes the memory copy, so that it is not
+  reported as successful while earlier changes are still missing from the
+  RPMB.
+
+  @param[in,out] Instance          MEM_INSTANCE pointer describing the device
+
+  @retval        EFI_SUCCESS       No ranges are left over
+  @retval        EFI_DEVICE_ERROR  The left over ranges still can't be written
+**/
+STATIC
+EFI_STATUS
+FlushFailedRanges (
+  IN OUT MEM_INSTANCE *Instance
+  )
+{
+  EFI_STATUS Status;
+
+  if (Instance->WriteBack || Instance->NDirtyRanges == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Status = FlushDirtyRanges (Instance);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: %u ranges still not written to the RPMB: %r\n",
+      __FUNCTION__, (UINT32)Instance->NDirtyRanges, Status));
+    return EFI_DEVICE_ERROR;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Stages a range of the memory copy that is about to be written or erased.
+  Must be called before the memory copy is updated.
+
+  A range that starts where the last staged range ends is merged into it, so
+  sequential writes go out as one multi-block RPMB transaction. A range that
+  overlaps any staged range would reorder the writes to those bytes, so the
+  staged ranges are flushed first and the range is staged on its own.
+
+  @param[in,out] Instance     MEM_INSTANCE pointer describing the device
+  @param[in]     Offset       Offset of the range into the memory copy
+  @param[in]     Length       Length of the range in bytes
+
+  @retval        EFI_SUCCESS  The range was staged
+  @retval        Others       Flushing the staged ranges failed
+**/
+STATIC
+EFI_STATUS
+StageDirtyRange (
+  IN OUT MEM_INSTANCE *Instance,
+  IN     UINTN        Offset,
+  IN     UINTN        Length
+  )
+{
+  EFI_STATUS       Status;
+  RPMB_DIRTY_RANGE *Range;
+  UINTN            Index;
+
+  if (Length == 0) {
+    return EFI_SUCCESS;
+  }
+
+  for (Index = 0; Index < Instance->NDirtyRanges; Index++) {
+    Range = &Instance->DirtyRanges[Index];
+    if (Offset < Range->Offset + Range->Length &&
+        Range->Offset < Offset + Length) {
+      break;
+    }
+  }
+
+  if (Index < Instance->NDirtyRanges ||
+      Instance->NDirtyRanges == RPMB_MAX_DIRTY_RANGES) {
+    Status = FlushDirtyRanges (Instance);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  if (Instance->NDirtyRanges > 0) {
+    Range = &Instance->DirtyRanges[Instance->NDirtyRanges - 1];
+    if (Range->Offset + Range->Length == Offset) {
+      Range->Length += Length;
+      return EFI_SUCCESS;
+    }
+  }
+
+  Range = &Instance->DirtyRanges[Instance->NDirtyRanges++];
+  Range->Offset = Offset;
+  Range->Length = Length;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Root MMI handler, called once every MMI has been handled. This is the
+  commit point for the writes and erases staged while handling it.
+
+  @param[in]     DispatchHandle  The unique handle assigned to this handler
+  @param[in]     Context         Unused
+  @param[in,out] CommBuffer      Unused
+  @param[in,out] CommBufferSize  Unused
+
+  @retval        EFI_WARN_INTERRUPT_SOURCE_QUIESCED  Other handlers still run
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+OpTeeRpmbFvbFlushHandler (
+  IN     EFI_HANDLE  DispatchHandle,
+  IN     CONST VOID  *Context         OPTIONAL,
+  IN OUT VOID        *CommBuffer      OPTIONAL,
+  IN OUT UINTN       *CommBufferSize  OPTIONAL
+  )
+{
+  EFI_STATUS Status;
+
+  if (!mInstance.WriteBack || mInstance.NDirtyRanges == 0) {
+    return EFI_WARN_INTERRUPT_SOURCE_QUIESCED;
+  }
+
+  Status = FlushDirtyRanges (&mInstance);
+  if (EFI_ERROR (Status)) {
+    // The writes were already reported as successful. Keep the remaining
+    // ranges and write through from now on, so that the next write or erase
+    // fails until they are written instead of being retried here silently.
+    DEBUG ((DEBUG_ERROR, "%a: %u ranges not written to the RPMB, writing through: %r\n",
+      __FUNCTION__, (UINT32)mInstance.NDirtyRanges, Status));
+    mInstance.WriteBack = FALSE;
+  }
+
+  return EFI_WARN_INTERRUPT_SOURCE_QUIESCED;
+}
+
+/**
+  Since we use a memory backed storage we need to restore the RPMB contents
+  into memory before they are accessed. Reads the blocks of the range that
+  are not in memory yet, merging consecutive missing blocks into one read.
+
+  @param[in,out] Instance     MEM_INSTANCE pointer describing the device
+  @param[in]     Lba          First block to load
+  @param[in]     NumLba       Number of blocks to load
+
+  @retval        EFI_SUCCESS  The blocks are in memory
+  @retval        Others       Reading from the RPMB failed
+**/
+STATIC
+EFI_STATUS
+LoadBlocks (
+  IN OUT MEM_INSTANCE *Instance,
+  IN     UINTN        Lba,
+  IN     UINTN        NumLba
+  )
+{
+  EFI_STATUS Status;
+  UINTN      End;
+  UINTN      RunEnd;
+
+  End = MIN (Lba + NumLba, Instance->NBlocks);
+  while (Lba < End) {
+    if (RPMB_BLOCK_IS_LOADED (Instance, Lba)) {
+      Lba++;
+      continue;
+    }
+
+    for (RunEnd = Lba + 1; RunEnd < End; RunEnd++) {
+      if (RPMB_BLOCK_IS_LOADED (Instance, RunEnd)) {
+        break;
+      }
+    }
+
+    Status = ReadWriteRpmb (
+               SP_SVC_RPMB_READ,
+               (UINTN)Instance->MemBaseAddress + Lba * Instance->BlockSize,
+               (RunEnd - Lba) * Instance->BlockSize,
+               Lba * Instance->BlockSize
+               );
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    for (; Lba < RunEnd; Lba++) {
+      RPMB_SET_BLOCK_LOADED (Instance, Lba);
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Loads the blocks covering a byte range of the memory copy.
+
+  @param[in,out] Instance     MEM_INSTANCE pointer describing the device
+  @param[in]     Offset       Offset of the range into the memory copy
+  @param[in]     Length       Length of the range in bytes
+
+  @retval        EFI_SUCCESS  The blocks are in memory
+  @retval        Others       Reading from the RPMB failed
+**/
+STATIC
+EFI_STATUS
+LoadRange (
+  IN OUT MEM_INSTANCE *Instance,
+  IN     UINTN        Offset,
+  IN     UINTN        Length
+  )
+{
+  if (Length == 0) {
+    return EFI_SUCCESS;
+  }
+
+  return LoadBlocks (
+           Instance,
+           Offset / Instance->BlockSize,
+           (Offset + Length - 1) / Instance->BlockSize -
+           Offset / Instance->BlockSize + 1
+           );
+}
+
 /**
   The GetAttributes() function retrieves the attributes and
   current settings of the block.
@@ -307,8 +582,11 @@ OpTeeRpmbFvbRead (
 
   Base = (VOID *)(UINTN)Instance->MemBaseAddress + (Lba * Instance->BlockSize) +
          Offset;
-  // We could read the data from the RPMB instead of memory
-  // The 2 copies should already be identical
+  Status = LoadRange (Instance, (UINTN)(Lba * Instance->BlockSize) + Offset, *NumBytes);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  // Once loaded, the memory copy is at least as recent as the RPMB
   // Copy from memory image
   CopyMem (Buffer, Base, *NumBytes);
 
@@ -388,13 +666,24 @@ OpTeeRpmbFvbWrite (
       return Status;
     }
   }
+  Status = FlushFailedRanges (Instance);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
   Base = (VOID *)(UINTN)Instance->MemBaseAddress + (Lba * Instance->BlockSize) +
          Offset;
-  Status = ReadWriteRpmb (
-             SP_SVC_RPMB_WRITE,
-             (UINTN)Buffer,
-             *NumBytes,
-             (Lba * Instance->BlockSize) + Offset
+  // Bytes of the blocks that aren't overwritten must be valid before the
+  // blocks are marked as loaded
+  Status = LoadRange (Instance, (UINTN)(Lba * Instance->BlockSize) + Offset, *NumBytes);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  // The write reaches the RPMB with the other writes of this MMI, see
+  // FlushDirtyRanges ()
+  Status = StageDirtyRange (
+             Instance,
+             (UINTN)(Lba * Instance->BlockSize) + Offset,
+             *NumBytes
              );
   if (EFI_ERROR (Status)) {
     return Status;
@@ -403,6 +692,10 @@ OpTeeRpmbFvbWrite (
   // Update the memory copy
   CopyMem (Base, Buffer, *NumBytes);
 
+  if (!Instance->WriteBack) {
+    Status = FlushDirtyRanges (Instance);
+  }
+
   return Status;
 }
 
@@ -464,12 +757,16 @@ OpTeeRpmbFvbErase (
   UINTN   NumLba;
   EFI_LBA Start;
   VOID    *Base;
-  VOID    *Buf;
   VA_LIST Args;
   EFI_STATUS Status;
 
   Instance = INSTANCE_FROM_FVB_THIS (This);
 
+  Status = FlushFailedRanges (Instance);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
   VA_START (Args, This);
   for (Start = VA_ARG (Args, EFI_LBA);
        Start != EFI_LBA_LIST_TERMINATOR;
@@ -481,62 +778,30 @@ OpTeeRpmbFvbErase (
     NumBytes = NumLba * Instance->BlockSize;
     Base = (VOID *)(UINTN)Instance->MemBaseAddress +
            (Start * Instance->BlockSize);
-    Buf = AllocatePool (NumLba * Instance->BlockSize);
-    if (Buf == NULL) {
-      return EFI_DEVICE_ERROR;
-    }
-    SetMem64 (Buf, NumLba * Instance->BlockSize, ~0UL);
-    // Write the device
-    Status = ReadWriteRpmb (
-               SP_SVC_RPMB_WRITE,
-               (UINTN)Buf,
-               NumBytes,
-               Start * Instance->BlockSize
+    // Erased blocks are written out from the memory copy like any other
+    // staged range
+    Status = StageDirtyRange (
+               Instance,
+               (UINTN)(Start * Instance->BlockSize),
+               NumBytes
                );
     if (EFI_ERROR (Status)) {
-      FreePool (Buf);
       return Status;
     }
-    // Update the in memory copy
-    SetMem64 (Base, NumLba * Instance->BlockSize, ~0UL);
-    FreePool (Buf);
+    // Update the in memory copy, erased blocks don't need to be read
+    SetMem64 (Base, NumBytes, ~0UL);
+    for (; NumLba > 0; NumLba--, Start++) {
+      RPMB_SET_BLOCK_LOADED (Instance, (UINTN)Start);
+    }
   }
 
   VA_END (Args);
 
-  return EFI_SUCCESS;
-}
-
-/**
-  Since we use a memory backed storage we need to restore the RPMB contents
-  into memory before we register the Fvb protocol.
-
-  @param Instance Address to copy flash contents to
-**/
-STATIC
-VOID
-ReadEntireFlash (
-  IN MEM_INSTANCE *Instance
- )
-{
-  UINTN ReadAddr;
-  UINTN StorageFtwWorkingSize;
-  UINTN StorageVariableSize;
-  UINTN StorageFtwSpareSize;
-
-  StorageFtwWorkingSize = PcdGet32 (PcdFlashNvStorageFtwWorkingSize);
-  StorageVariableSize   = PcdGet32 (PcdFlashNvStorageVariableSize);
-  StorageFtwSpareSize   = PcdGet32 (PcdFlashNvStorageFtwSpareSize);
+  if (!Instance->WriteBack) {
+    return FlushDirtyRanges (Instance);
+  }
 
-  ReadAddr = Instance->MemBaseAddress;
-  // There's no need to check if the read failed here. The upper EDK2 layers
-  // will initialize the flash correctly if the in-memory copy is wrong
-  ReadWriteRpmb (
-    SP_SVC_RPMB_READ,
-    ReadAddr,
-    StorageVariableSize + StorageFtwWorkingSize + StorageFtwSpareSize,
-    0
-    );
+  return EFI_SUCCESS;
 }
 
 /**
@@ -747,11 +1012,17 @@ FvbInitialize (
   ASSERT ((PcdGet64 (PcdFlashNvStorageFtwWorkingBase64) % Instance->BlockSize) == 0);
   ASSERT ((PcdGet64 (PcdFlashNvStorageFtwSpareBase64) % Instance->BlockSize) == 0);
 
-  // Read the file from disk and copy it to memory
-  ReadEntireFlash (Instance);
+  // Probe the headers in the first block before reading the rest of the store.
+  // There's no need to check if the read failed here. The upper EDK2 layers
+  // will initialize the flash correctly if the in-memory copy is wrong
+  LoadBlocks (Instance, 0, 1);
 
   FwVolHeader = (EFI_FIRMWARE_VOLUME_HEADER *)(UINTN)Instance->MemBaseAddress;
-  Status = ValidateFvHeader (FwVolHeader);
+  if (FwVolHeader->HeaderLength + sizeof (VARIABLE_STORE_HEADER) > Instance->BlockSize) {
+    Status = EFI_VOLUME_CORRUPTED;
+  } else {
+    Status = ValidateFvHeader (FwVolHeader);
+  }
   if (EFI_ERROR (Status)) {
     // There is no valid header, so time to install one.
     DEBUG ((DEBUG_INFO, "%a: The FVB Header is not valid.\n", __FUNCTION__));
@@ -762,6 +1033,7 @@ FvbInitialize (
       Instance->NBlocks * Instance->BlockSize,
       ~0UL
       );
+    SetMem (Instance->LoadedBlocks, (Instance->NBlocks + 7) / 8, 0xFF);
     DEBUG ((DEBUG_INFO, "%a: Erasing Flash.\n", __FUNCTION__));
     Status = ReadWriteRpmb (
                SP_SVC_RPMB_WRITE,
@@ -783,6 +1055,18 @@ FvbInitialize (
     }
   } else {
     DEBUG ((DEBUG_INFO, "%a: Found valid FVB Header.\n", __FUNCTION__));
+    // The variable driver accesses the variable store through the memory map
+    // rather than Read(), so it must be in memory before the protocol is used.
+    // The FTW working and spare areas are only accessed through the protocol
+    // and are loaded on demand.
+    Status = LoadBlocks (
+               Instance,
+               1,
+               PcdGet32 (PcdFlashNvStorageVariableSize) / Instance->BlockSize - 1
+               );
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
   }
   Instance->Initialized = TRUE;
 
@@ -812,6 +1096,7 @@ OpTeeRpmbFvbInit (
   VOID         *Addr;
   UINTN        FvLength;
   UINTN        NBlocks;
+  EFI_HANDLE   DispatchHandle;
 
   FvLength = PcdGet32 (PcdFlashNvStorageVariableSize) +
              PcdGet32 (PcdFlashNvStorageFtwWorkingSize) +
@@ -839,6 +1124,11 @@ OpTeeRpmbFvbInit (
   mInstance.Initialize     = FvbInitialize;
   mInstance.BlockSize      = EFI_PAGE_SIZE;
   mInstance.NBlocks        = NBlocks;
+  mInstance.LoadedBlocks   = AllocateZeroPool ((NBlocks + 7) / 8);
+  if (mInstance.LoadedBlocks == NULL) {
+    FreePages (Addr, NBlocks);
+    return EFI_OUT_OF_RESOURCES;
+  }
 
   // Update the defined PCDs related to Variable Storage
   PatchPcdSet64 (PcdFlashNvStorageVariableBase64, mInstance.MemBaseAddress);
@@ -853,6 +1143,21 @@ OpTeeRpmbFvbInit (
     PcdGet32 (PcdFlashNvStorageFtwWorkingSize)
     );
 
+  // Without a root MMI handler to flush them, ranges are written as soon as
+  // they are staged. Decide before the FVB is published, so that its
+  // consumers see the same behavior from their first write.
+  mInstance.WriteBack = !EFI_ERROR (
+                           gMmst->MmiHandlerRegister (
+                                    OpTeeRpmbFvbFlushHandler,
+                                    NULL,
+                                    &DispatchHandle
+                                    )
+                           );
+  if (!mInstance.WriteBack) {
+    DEBUG ((DEBUG_WARN, "%a: Can't register the flush handler, writing through\n",
+      __FUNCTION__));
+  }
+
   Status = gMmst->MmInstallProtocolInterface (
                     &mInstance.Handle,
                     &gEfiSmmFirmwareVolumeBlockProtocolGuid,
@@ -32,9 +32,29 @@
 #define INSTANCE_FROM_FVB_THIS(a)  CR (a, MEM_INSTANCE, FvbProtocol, \
                                       FLASH_SIGNATURE)
 
+/**
+  Maximum number of disjoint ranges staged in the memory copy before
+  they are written to the RPMB
+**/
+#define RPMB_MAX_DIRTY_RANGES      16
+
+#define RPMB_BLOCK_IS_LOADED(Instance, Lba) \
+  (((Instance)->LoadedBlocks[(Lba) / 8] & (1 << ((Lba) % 8))) != 0)
+#define RPMB_SET_BLOCK_LOADED(Instance, Lba) \
+  ((Instance)->LoadedBlocks[(Lba) / 8] |= (UINT8)(1 << ((Lba) % 8)))
+
 typedef struct _MEM_INSTANCE         MEM_INSTANCE;
 typedef EFI_STATUS (*MEM_INITIALIZE) (MEM_INSTANCE* Instance);
 
+/**
+  A range of the memory copy that was written or erased but has not been
+  written to the RPMB yet. Offset is relative to MemBaseAddress.
+**/
+typedef struct {
+    UINTN                               Offset;
+    UINTN                               Length;
+} RPMB_DIRTY_RANGE;
+
 /**
   This struct is used by the RPMB driver. Since the upper EDK2 layers
   expect byte addressable memory, we allocate a memory area of certain
@@ -58,6 +78,15 @@ struct _MEM_INSTANCE
     UINT16                              BlockSize;
     /// Number of allocated blocks
     UINT16                              NBlocks;
+    /// Set to true if staged ranges are flushed at the end of each MMI.
+    /// Cleared for good once such a flush fails.
+    BOOLEAN                             WriteBack;
+    /// Staged ranges, in the order they were first written
+    RPMB_DIRTY_RANGE                    DirtyRanges[RPMB_MAX_DIRTY_RANGES];
+    /// Number of valid entries in DirtyRanges
+    UINTN                               NDirtyRanges;
+    /// Bitmap of the blocks already read from the RPMB into memory
+    UINT8                               *LoadedBlocks;
 };
 
 #endif
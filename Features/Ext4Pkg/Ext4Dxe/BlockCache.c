@@ -0,0 +1,156 @@
+/** @file
+  Metadata block cache
+
+  Copyright (c) 2021 Pedro Falcato All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include "Ext4Dxe.h"
+
+/**
+   Hashes a block number into a bucket of the block cache.
+
+   @param[in]  Block          Block number.
+
+   @return The bucket index.
+**/
+STATIC
+UINTN
+Ext4BlockCacheBucket (
+  IN EXT4_BLOCK_NR  Block
+  )
+{
+  return (UINTN)(Block ^ RShiftU64 (Block, 16)) % EXT4_BLOCK_CACHE_HASH_SIZE;
+}
+
+/**
+   Initialises the (empty) block cache of a partition.
+
+   @param[in out]  Partition  Pointer to the ext4 partition.
+**/
+VOID
+Ext4BlockCacheInit (
+  IN OUT EXT4_PARTITION  *Partition
+  )
+{
+  UINTN  Index;
+
+  InitializeListHead (&Partition->BlockCacheLru);
+
+  for (Index = 0; Index < EXT4_BLOCK_CACHE_HASH_SIZE; Index++) {
+    InitializeListHead (&Partition->BlockCacheHash[Index]);
+  }
+
+  Partition->BlockCacheCount = 0;
+}
+
+/**
+   Drops and frees every block in the block cache of a partition.
+
+   @param[in out]  Partition  Pointer to the ext4 partition.
+**/
+VOID
+Ext4BlockCacheFlush (
+  IN OUT EXT4_PARTITION  *Partition
+  )
+{
+  LIST_ENTRY              *Node;
+  EXT4_BLOCK_CACHE_ENTRY  *Entry;
+
+  while (!IsListEmpty (&Partition->BlockCacheLru)) {
+    Node  = GetFirstNode (&Partition->BlockCacheLru);
+    Entry = EXT4_BLOCK_CACHE_ENTRY_FROM_LRU_NODE (Node);
+
+    RemoveEntryList (&Entry->LruNode);
+    RemoveEntryList (&Entry->HashNode);
+    FreePool (Entry);
+  }
+
+  Partition->BlockCacheCount = 0;
+}
+
+/**
+   Reads a metadata block through the partition's block cache.
+
+   The returned entry stays valid until the next call into the block cache,
+   and its data must not be modified.
+
+   @param[in]  Partition      Pointer to the opened ext4 partition.
+   @param[in]  Block          Block number.
+   @param[out] OutEntry       Pointer to where the cache entry will be stored.
+
+   @retval EFI_SUCCESS            The block was read.
+   @retval EFI_OUT_OF_RESOURCES   Memory allocation failed.
+   @retval !EFI_SUCCESS           The disk read failed.
+**/
+EFI_STATUS
+Ext4BlockCacheRead (
+  IN EXT4_PARTITION            *Partition,
+  IN EXT4_BLOCK_NR             Block,
+  OUT EXT4_BLOCK_CACHE_ENTRY  **OutEntry
+  )
+{
+  LIST_ENTRY              *Bucket;
+  LIST_ENTRY              *Node;
+  EXT4_BLOCK_CACHE_ENTRY  *Entry;
+  UINTN                   VerifiedSize;
+  EFI_STATUS              Status;
+
+  // Don't hand out blocks of a medium that's no longer there
+  if (Partition->BlockCacheMediaId != EXT4_MEDIA_ID (Partition)) {
+    Ext4BlockCacheFlush (Partition);
+    Partition->BlockCacheMediaId = EXT4_MEDIA_ID (Partition);
+  }
+
+  Bucket = &Partition->BlockCacheHash[Ext4BlockCacheBucket (Block)];
+
+  BASE_LIST_FOR_EACH (Node, Bucket) {
+    Entry = EXT4_BLOCK_CACHE_ENTRY_FROM_HASH_NODE (Node);
+
+    if (Entry->Block == Block) {
+      // Move it to the head of the LRU list
+      RemoveEntryList (&Entry->LruNode);
+      InsertHeadList (&Partition->BlockCacheLru, &Entry->LruNode);
+      *OutEntry = Entry;
+      return EFI_SUCCESS;
+    }
+  }
+
+  VerifiedSize = (Partition->BlockSize / EXT4_GOOD_OLD_INODE_SIZE + 7) / 8;
+
+  if (Partition->BlockCacheCount >= EXT4_BLOCK_CACHE_MAX_BLOCKS) {
+    // Recycle the least recently used block
+    Node  = GetPreviousNode (&Partition->BlockCacheLru, &Partition->BlockCacheLru);
+    Entry = EXT4_BLOCK_CACHE_ENTRY_FROM_LRU_NODE (Node);
+
+    RemoveEntryList (&Entry->LruNode);
+    RemoveEntryList (&Entry->HashNode);
+    Partition->BlockCacheCount--;
+  } else {
+    Entry = AllocatePool (sizeof (EXT4_BLOCK_CACHE_ENTRY) + Partition->BlockSize + VerifiedSize);
+
+    if (Entry == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    Entry->Data     = (UINT8 *)(Entry + 1);
+    Entry->Verified = Entry->Data + Partition->BlockSize;
+  }
+
+  Status = Ext4ReadBlocks (Partition, Entry->Data, 1, Block);
+
+  if (EFI_ERROR (Status)) {
+    FreePool (Entry);
+    return Status;
+  }
+
+  Entry->Block = Block;
+  ZeroMem (Entry->Verified, VerifiedSize);
+
+  InsertHeadList (&Partition->BlockCacheLru, &Entry->LruNode);
+  InsertHeadList (Bucket, &Entry->HashNode);
+  Partition->BlockCacheCount++;
+
+  *OutEntry = Entry;
+  return EFI_SUCCESS;
+}
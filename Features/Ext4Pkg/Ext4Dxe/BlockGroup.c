@@ -28,27 +28,34 @@ Ext4GetBlockGroupDesc (
 }
 
 /**
-   Reads an inode from disk.
+   Finds where an inode lives on disk.
 
-   @param[in]    Partition  Pointer to the opened partition.
-   @param[in]    InodeNum   Number of the desired Inode
-   @param[out]   OutIno     Pointer to where it will be stored a pointer to the read inode.
+   @param[in]    Partition      Pointer to the opened partition.
+   @param[in]    InodeNum       Number of the desired Inode
+   @param[out]   InodeBlock     Pointer to the inode table block holding the inode.
+   @param[out]   OffsetInBlock  Pointer to the offset of the inode inside InodeBlock.
 
-   @return Status of the inode read.
+   @retval EFI_SUCCESS           The inode was found.
+   @retval EFI_VOLUME_CORRUPTED  The inode number is out of range.
 **/
+STATIC
 EFI_STATUS
-Ext4ReadInode (
-  IN EXT4_PARTITION  *Partition,
-  IN EXT4_INO_NR     InodeNum,
-  OUT EXT4_INODE     **OutIno
+Ext4GetInodeLocation (
+  IN  EXT4_PARTITION  *Partition,
+  IN  EXT4_INO_NR     InodeNum,
+  OUT EXT4_BLOCK_NR   *InodeBlock,
+  OUT UINT32          *OffsetInBlock
   )
 {
   UINT64                 InodeOffset;
   UINT32                 BlockGroupNumber;
-  EXT4_INODE             *Inode;
   EXT4_BLOCK_GROUP_DESC  *BlockGroup;
   EXT4_BLOCK_NR          InodeTableStart;
-  EFI_STATUS             Status;
+  UINT64                 TableOffset;
+
+  if (InodeNum == 0) {
+    return EFI_VOLUME_CORRUPTED;
+  }
 
   BlockGroupNumber = (UINT32)DivU64x64Remainder (
                                InodeNum - 1,
@@ -61,12 +68,6 @@ Ext4ReadInode (
     return EFI_VOLUME_CORRUPTED;
   }
 
-  Inode = Ext4AllocateInode (Partition);
-
-  if (Inode == NULL) {
-    return EFI_OUT_OF_RESOURCES;
-  }
-
   BlockGroup = Ext4GetBlockGroupDesc (Partition, BlockGroupNumber);
 
   // Note: We'll need to check INODE_UNINIT and friends when/if we add write support
@@ -77,27 +78,97 @@ Ext4ReadInode (
                       BlockGroup->bg_inode_table_hi
                       );
 
-  Status = Ext4ReadDiskIo (
-             Partition,
-             Inode,
-             Partition->InodeSize,
-             EXT4_BLOCK_TO_BYTES (Partition, InodeTableStart) + MultU64x32 (InodeOffset, Partition->InodeSize)
-             );
+  TableOffset = MultU64x32 (InodeOffset, Partition->InodeSize);
+  *InodeBlock = InodeTableStart + DivU64x32Remainder (TableOffset, Partition->BlockSize, OffsetInBlock);
+
+  return EFI_SUCCESS;
+}
+
+/**
+   Checks if an inode can be read through the block cache, i.e. if it
+   doesn't straddle inode table blocks.
+
+   @param[in]    Partition      Pointer to the opened partition.
+   @param[in]    OffsetInBlock  Offset of the inode inside its inode table block.
+
+   @return TRUE if the inode is cacheable, else FALSE.
+**/
+#define EXT4_INODE_IS_CACHEABLE(Partition, OffsetInBlock)                      \
+  ((Partition->InodeSize >= EXT4_GOOD_OLD_INODE_SIZE) &&                       \
+   ((OffsetInBlock) + Partition->InodeSize <= Partition->BlockSize))
+
+/**
+   Reads an inode from disk.
+
+   @param[in]    Partition  Pointer to the opened partition.
+   @param[in]    InodeNum   Number of the desired Inode
+   @param[out]   OutIno     Pointer to where it will be stored a pointer to the read inode.
+
+   @return Status of the inode read.
+**/
+EFI_STATUS
+Ext4ReadInode (
+  IN EXT4_PARTITION  *Partition,
+  IN EXT4_INO_NR     InodeNum,
+  OUT EXT4_INODE     **OutIno
+  )
+{
+  EXT4_INODE              *Inode;
+  EFI_STATUS              Status;
+  UINT32                  OffsetInBlock;
+  EXT4_BLOCK_NR           InodeBlock;
+  EXT4_BLOCK_CACHE_ENTRY  *CacheEntry;
+  UINTN                   Slot;
+
+  Status = Ext4GetInodeLocation (Partition, InodeNum, &InodeBlock, &OffsetInBlock);
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Inode = Ext4AllocateInode (Partition);
+
+  if (Inode == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  CacheEntry = NULL;
+  Slot       = OffsetInBlock / Partition->InodeSize;
+
+  if (EXT4_INODE_IS_CACHEABLE (Partition, OffsetInBlock)) {
+    // Inodes that share an inode table block are read (and checksummed) once
+    Status = Ext4BlockCacheRead (Partition, InodeBlock, &CacheEntry);
+
+    if (!EFI_ERROR (Status)) {
+      CopyMem (Inode, CacheEntry->Data + OffsetInBlock, Partition->InodeSize);
+    }
+  } else {
+    // Odd inode sizes may straddle blocks, don't bother caching those
+    Status = Ext4ReadDiskIo (
+               Partition,
+               Inode,
+               Partition->InodeSize,
+               EXT4_BLOCK_TO_BYTES (Partition, InodeBlock) + OffsetInBlock
+               );
+  }
 
   if (EFI_ERROR (Status)) {
     DEBUG ((
       DEBUG_ERROR,
-      "[ext4] Error reading inode: status %x; inode offset %lx"
-      " inode table start %lu block group %lu\n",
+      "[ext4] Error reading inode: status %x; inode block %lu offset %x\n",
       Status,
-      InodeOffset,
-      InodeTableStart,
-      BlockGroupNumber
+      InodeBlock,
+      OffsetInBlock
       ));
     FreePool (Inode);
     return Status;
   }
 
+  if ((CacheEntry != NULL) && EXT4_BLOCK_CACHE_IS_VERIFIED (CacheEntry, Slot)) {
+    *OutIno = Inode;
+    return EFI_SUCCESS;
+  }
+
   if (!Ext4CheckInodeChecksum (Partition, Inode, InodeNum)) {
     DEBUG ((
       DEBUG_ERROR,
@@ -109,10 +180,76 @@ Ext4ReadInode (
     return EFI_VOLUME_CORRUPTED;
   }
 
+  if (CacheEntry != NULL) {
+    EXT4_BLOCK_CACHE_SET_VERIFIED (CacheEntry, Slot);
+  }
+
   *OutIno = Inode;
   return EFI_SUCCESS;
 }
 
+/**
+   Pulls the inode table blocks of a set of inodes into the block cache, in
+   on-disk order, so that reading the inodes afterwards doesn't seek back and
+   forth across the inode tables.
+
+   @param[in]      Partition  Pointer to the opened partition.
+   @param[in out]  Inodes     Array of inode numbers. It's sorted in place.
+   @param[in]      Count      Number of inodes in the array.
+**/
+VOID
+Ext4PrefetchInodes (
+  IN     EXT4_PARTITION  *Partition,
+  IN OUT EXT4_INO_NR     *Inodes,
+  IN     UINTN           Count
+  )
+{
+  UINTN                   Index;
+  UINTN                   Previous;
+  UINTN                   Prefetched;
+  EXT4_INO_NR             Inode;
+  EXT4_BLOCK_NR           InodeBlock;
+  EXT4_BLOCK_NR           LastBlock;
+  UINT32                  OffsetInBlock;
+  EXT4_BLOCK_CACHE_ENTRY  *CacheEntry;
+
+  // Insertion sort, since the inode numbers in a directory block tend to be
+  // nearly sorted already. Inode number order is inode table order.
+  for (Index = 1; Index < Count; Index++) {
+    Inode = Inodes[Index];
+    for (Previous = Index; Previous > 0 && Inodes[Previous - 1] > Inode; Previous--) {
+      Inodes[Previous] = Inodes[Previous - 1];
+    }
+
+    Inodes[Previous] = Inode;
+  }
+
+  LastBlock  = 0;
+  Prefetched = 0;
+
+  for (Index = 0; Index < Count; Index++) {
+    // Leave room in the cache for the extent nodes the caller will need
+    if (Prefetched >= EXT4_BLOCK_CACHE_MAX_BLOCKS / 2) {
+      break;
+    }
+
+    if (EFI_ERROR (Ext4GetInodeLocation (Partition, Inodes[Index], &InodeBlock, &OffsetInBlock))) {
+      continue;
+    }
+
+    if (!EXT4_INODE_IS_CACHEABLE (Partition, OffsetInBlock) || (InodeBlock == LastBlock)) {
+      continue;
+    }
+
+    if (EFI_ERROR (Ext4BlockCacheRead (Partition, InodeBlock, &CacheEntry))) {
+      return;
+    }
+
+    LastBlock = InodeBlock;
+    Prefetched++;
+  }
+}
+
 /**
    Calculates the checksum of the block group descriptor for METADATA_CSUM enabled filesystems.
    @param[in]      Partition       Pointer to the opened EXT4 partition.
@@ -164,19 +301,17 @@ Ext4CalculateBlockGroupDescChecksumGdtCsum (
   )
 {
   UINT16  Csum;
-  UINT16  Dummy;
-
-  Dummy = 0;
 
-  Csum = CalculateCrc16Ansi (Partition->SuperBlock.s_uuid, 16, 0);
-  Csum = CalculateCrc16Ansi (&BlockGroupNum, sizeof (BlockGroupNum), Csum);
-  Csum = CalculateCrc16Ansi (BlockGroupDesc, OFFSET_OF (EXT4_BLOCK_GROUP_DESC, bg_checksum), Csum);
-  Csum = CalculateCrc16Ansi (&Dummy, sizeof (Dummy), Csum);
+  // Unlike metadata_csum, the checksum field itself isn't hashed at all here,
+  // and the CRC starts at ~0.
+  Csum = Ext4CalculateCrc16 (0xFFFF, Partition->SuperBlock.s_uuid, 16);
+  Csum = Ext4CalculateCrc16 (Csum, &BlockGroupNum, sizeof (BlockGroupNum));
+  Csum = Ext4CalculateCrc16 (Csum, BlockGroupDesc, OFFSET_OF (EXT4_BLOCK_GROUP_DESC, bg_checksum));
   Csum =
-    CalculateCrc16Ansi (
+    Ext4CalculateCrc16 (
+      Csum,
       &BlockGroupDesc->bg_block_bitmap_hi,
-      Partition->DescSize - OFFSET_OF (EXT4_BLOCK_GROUP_DESC, bg_block_bitmap_hi),
-      Csum
+      Partition->DescSize - OFFSET_OF (EXT4_BLOCK_GROUP_DESC, bg_block_bitmap_hi)
       );
   return Csum;
 }
@@ -217,14 +217,15 @@ Ext4GetBlocks (
   OUT EXT4_EXTENT     *Extent
   )
 {
-  EXT4_INODE     *Inode;
-  EXT4_BLOCK_NR  BlockPath[EXT4_MAX_BLOCK_PATH];
-  UINTN          BlockPathLength;
-  UINTN          Index;
-  UINT32         *Buffer;
-  EFI_STATUS     Status;
-  UINT32         Block;
-  UINT32         BlockIndex;
+  EXT4_INODE              *Inode;
+  EXT4_BLOCK_NR           BlockPath[EXT4_MAX_BLOCK_PATH];
+  UINTN                   BlockPathLength;
+  UINTN                   Index;
+  UINT32                  *Buffer;
+  EFI_STATUS              Status;
+  UINT32                  Block;
+  UINT32                  BlockIndex;
+  EXT4_BLOCK_CACHE_ENTRY  *CacheEntry;
 
   Inode = File->Inode;
 
@@ -244,10 +245,7 @@ Ext4GetBlocks (
     return EFI_SUCCESS;
   }
 
-  Buffer = AllocatePool (Partition->BlockSize);
-  if (Buffer == NULL) {
-    return EFI_OUT_OF_RESOURCES;
-  }
+  Buffer = NULL;
 
   // Note the BlockPathLength - 1 so we don't end up reading the final block
   for (Index = 0; Index < BlockPathLength - 1; Index++) {
@@ -260,20 +258,21 @@ Ext4GetBlocks (
     }
 
     if (Block == EXT4_BLOCK_FILE_HOLE) {
-      FreePool (Buffer);
       return EFI_NO_MAPPING;
     }
 
-    Status = Ext4ReadBlocks (Partition, Buffer, 1, Block);
+    // Indirect blocks go through the block cache, as consecutive lookups
+    // usually walk the same (double/triple) indirect blocks.
+    Status = Ext4BlockCacheRead (Partition, Block, &CacheEntry);
 
     if (EFI_ERROR (Status)) {
-      FreePool (Buffer);
       return Status;
     }
+
+    Buffer = (UINT32 *)CacheEntry->Data;
   }
 
   Ext4GetExtentInBlockMap (Buffer, Partition->BlockSize / sizeof (UINT32), BlockPath[BlockPathLength - 1], Extent);
-  FreePool (Buffer);
 
   return EFI_SUCCESS;
 }
@@ -0,0 +1,164 @@
+/** @file
+  CRC32C and CRC16 routines for ext4 metadata checksums
+
+  Copyright (c) 2021 Pedro Falcato All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include "Ext4Dxe.h"
+
+// Reflected polynomials
+#define EXT4_CRC32C_POLY  0x82F63B78
+#define EXT4_CRC16_POLY   0xA001
+
+STATIC UINT32   mExt4Crc32cTable[256];
+STATIC UINT16   mExt4Crc16Table[256];
+STATIC BOOLEAN  mExt4HasCrc32cInstructions;
+
+#if defined (MDE_CPU_AARCH64)
+
+/**
+   Checks if the CPU implements the CRC32 instructions (ID_AA64ISAR0_EL1.CRC32).
+
+   @return TRUE if supported, else FALSE.
+**/
+BOOLEAN
+EFIAPI
+Ext4Crc32cHwSupported (
+  VOID
+  );
+
+#elif defined (MDE_CPU_X64)
+
+/**
+   Checks if the CPU implements SSE4.2, which includes the crc32 instruction.
+
+   @return TRUE if supported, else FALSE.
+**/
+STATIC
+BOOLEAN
+Ext4Crc32cHwSupported (
+  VOID
+  )
+{
+  UINT32  Ecx;
+
+  AsmCpuid (1, NULL, NULL, &Ecx, NULL);
+  return (Ecx & BIT20) != 0;
+}
+
+#endif
+
+/**
+   Builds the CRC tables and detects CRC instructions.
+   Must be called before any other CRC routine.
+**/
+VOID
+Ext4InitialiseCrc (
+  VOID
+  )
+{
+  UINTN   Index;
+  UINTN   Bit;
+  UINT32  Crc32;
+  UINT16  Crc16;
+
+  for (Index = 0; Index < 256; Index++) {
+    Crc32 = (UINT32)Index;
+    Crc16 = (UINT16)Index;
+
+    for (Bit = 0; Bit < 8; Bit++) {
+      Crc32 = (Crc32 & 1) ? (Crc32 >> 1) ^ EXT4_CRC32C_POLY : Crc32 >> 1;
+      Crc16 = (Crc16 & 1) ? (UINT16)((Crc16 >> 1) ^ EXT4_CRC16_POLY) : (UINT16)(Crc16 >> 1);
+    }
+
+    mExt4Crc32cTable[Index] = Crc32;
+    mExt4Crc16Table[Index]  = Crc16;
+  }
+
+ #if defined (MDE_CPU_AARCH64) || defined (MDE_CPU_X64)
+  mExt4HasCrc32cInstructions = Ext4Crc32cHwSupported ();
+ #endif
+
+  DEBUG ((DEBUG_FS, "[ext4] CRC32C instructions %a\n", mExt4HasCrc32cInstructions ? "present" : "absent"));
+}
+
+/**
+   Updates a CRC32C (Castagnoli), as used by metadata_csum.
+   Unlike CalculateCrc32c, neither the initial value nor the result is
+   inverted, which is what ext4 wants.
+
+   @param[in]  Crc            Current CRC.
+   @param[in]  Buffer         Pointer to the buffer.
+   @param[in]  Length         Length of the buffer, in bytes.
+
+   @return The updated CRC.
+**/
+UINT32
+Ext4CalculateCrc32c (
+  IN UINT32      Crc,
+  IN CONST VOID  *Buffer,
+  IN UINTN       Length
+  )
+{
+ #if defined (MDE_CPU_AARCH64) || defined (MDE_CPU_X64)
+  if (mExt4HasCrc32cInstructions) {
+    return Ext4Crc32cHw (Crc, Buffer, Length);
+  }
+
+ #endif
+
+  return Ext4CalculateCrc32cTable (Crc, Buffer, Length);
+}
+
+/**
+   Updates a CRC32C (Castagnoli) with the byte-wise table, whatever the CPU
+   supports. Neither the initial value nor the result is inverted.
+
+   @param[in]  Crc            Current CRC.
+   @param[in]  Buffer         Pointer to the buffer.
+   @param[in]  Length         Length of the buffer, in bytes.
+
+   @return The updated CRC.
+**/
+UINT32
+Ext4CalculateCrc32cTable (
+  IN UINT32      Crc,
+  IN CONST VOID  *Buffer,
+  IN UINTN       Length
+  )
+{
+  CONST UINT8  *Buf;
+
+  for (Buf = Buffer; Length != 0; Length--, Buf++) {
+    Crc = mExt4Crc32cTable[(Crc ^ *Buf) & 0xFF] ^ (Crc >> 8);
+  }
+
+  return Crc;
+}
+
+/**
+   Updates a CRC16 (ANSI/ARC polynomial, reflected), as used by gdt_csum.
+   Neither the initial value nor the result is inverted.
+
+   @param[in]  Crc            Current CRC.
+   @param[in]  Buffer         Pointer to the buffer.
+   @param[in]  Length         Length of the buffer, in bytes.
+
+   @return The updated CRC.
+**/
+UINT16
+Ext4CalculateCrc16 (
+  IN UINT16      Crc,
+  IN CONST VOID  *Buffer,
+  IN UINTN       Length
+  )
+{
+  CONST UINT8  *Buf;
+
+  for (Buf = Buffer; Length != 0; Length--, Buf++) {
+    Crc = (UINT16)(mExt4Crc16Table[(Crc ^ *Buf) & 0xFF] ^ (Crc >> 8));
+  }
+
+  return Crc;
+}
@@ -82,44 +82,128 @@ Ext4ValidDirent (
 }
 
 /**
-   Retrieves a directory entry.
+   Searches a directory block for a directory entry.
 
-   @param[in]      Directory   Pointer to the opened directory.
-   @param[in]      NameUnicode Pointer to the UCS-2 formatted filename.
    @param[in]      Partition   Pointer to the ext4 partition.
+   @param[in]      Block       Pointer to the contents of the directory block,
+                               of size Partition->BlockSize.
+   @param[in]      Name        Pointer to the UCS-2 formatted filename.
    @param[out]     Result      Pointer to the destination directory entry.
 
-   @return The result of the operation.
+   @retval EFI_SUCCESS           The entry was found and copied to Result.
+   @retval EFI_NOT_FOUND         The block doesn't contain the entry.
+   @retval EFI_VOLUME_CORRUPTED  The block is corrupted.
 **/
 EFI_STATUS
-Ext4RetrieveDirent (
-  IN EXT4_FILE        *Directory,
-  IN CONST CHAR16     *Name,
+Ext4SearchDirBlock (
   IN EXT4_PARTITION   *Partition,
+  IN CONST CHAR8      *Block,
+  IN CONST CHAR16     *Name,
   OUT EXT4_DIR_ENTRY  *Result
   )
 {
   EFI_STATUS      Status;
-  CHAR8           *Buf;
-  UINT64          Off;
-  EXT4_INODE      *Inode;
-  UINT64          DirInoSize;
-  UINT32          BlockRemainder;
-  UINTN           Length;
   EXT4_DIR_ENTRY  *Entry;
   UINTN           RemainingBlock;
   CHAR16          DirentUcs2Name[EXT4_NAME_MAX + 1];
   UINTN           ToCopy;
   UINTN           BlockOffset;
+  UINTN           NameLen;
 
-  Status = EFI_NOT_FOUND;
-  Buf    = AllocatePool (Partition->BlockSize);
+  NameLen = StrLen (Name);
 
-  if (Buf == NULL) {
-    return EFI_OUT_OF_RESOURCES;
+  for (BlockOffset = 0; BlockOffset < Partition->BlockSize; ) {
+    Entry          = (EXT4_DIR_ENTRY *)(Block + BlockOffset);
+    RemainingBlock = Partition->BlockSize - BlockOffset;
+    // Check if the minimum directory entry fits inside [BlockOffset, EndOfBlock]
+    if (RemainingBlock < EXT4_MIN_DIR_ENTRY_LEN) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+
+    if (!Ext4ValidDirent (Entry)) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+
+    if ((Entry->name_len > RemainingBlock) || (Entry->rec_len > RemainingBlock)) {
+      // Corrupted filesystem
+      return EFI_VOLUME_CORRUPTED;
+    }
+
+    // Ignore names bigger than our limit.
+
+    /* Note: I think having a limit is sane because:
+      1) It's nicer to work with.
+      2) Linux and a number of BSDs also have a filename limit of 255.
+    */
+    if (Entry->name_len > EXT4_NAME_MAX) {
+      BlockOffset += Entry->rec_len;
+      continue;
+    }
+
+    // Unused entry
+    if (Entry->inode == 0) {
+      BlockOffset += Entry->rec_len;
+      continue;
+    }
+
+    // Names of a different length can't match, so skip the conversion
+    if (Entry->name_len != NameLen) {
+      BlockOffset += Entry->rec_len;
+      continue;
+    }
+
+    Status = Ext4GetUcs2DirentName (Entry, DirentUcs2Name);
+
+    /* In theory, this should never fail.
+     * In reality, it's quite possible that it can fail, considering filenames in
+     * Linux (and probably other nixes) are just null-terminated bags of bytes, and don't
+     * need to form valid ASCII/UTF-8 sequences.
+     */
+    if (EFI_ERROR (Status)) {
+      // If we error out, skip this entry
+      // I'm not sure if this is correct behaviour, but I don't think there's a precedent here.
+      BlockOffset += Entry->rec_len;
+      continue;
+    }
+
+    if (!Ext4StrCmpInsensitive (DirentUcs2Name, (CHAR16 *)Name)) {
+      ToCopy = MIN (Entry->rec_len, sizeof (EXT4_DIR_ENTRY));
+
+      CopyMem (Result, Entry, ToCopy);
+      return EFI_SUCCESS;
+    }
+
+    BlockOffset += Entry->rec_len;
   }
 
-  Off = 0;
+  return EFI_NOT_FOUND;
+}
+
+/**
+   Retrieves a directory entry.
+
+   @param[in]      Directory   Pointer to the opened directory.
+   @param[in]      NameUnicode Pointer to the UCS-2 formatted filename.
+   @param[in]      Partition   Pointer to the ext4 partition.
+   @param[out]     Result      Pointer to the destination directory entry.
+
+   @return The result of the operation.
+**/
+EFI_STATUS
+Ext4RetrieveDirent (
+  IN EXT4_FILE        *Directory,
+  IN CONST CHAR16     *Name,
+  IN EXT4_PARTITION   *Partition,
+  OUT EXT4_DIR_ENTRY  *Result
+  )
+{
+  EFI_STATUS  Status;
+  CHAR8       *Buf;
+  UINT64      Off;
+  EXT4_INODE  *Inode;
+  UINT64      DirInoSize;
+  UINT32      BlockRemainder;
+  UINTN       Length;
 
   Inode      = Directory->Inode;
   DirInoSize = EXT4_INODE_SIZE (Inode);
@@ -130,6 +214,27 @@ Ext4RetrieveDirent (
     return EFI_VOLUME_CORRUPTED;
   }
 
+  // Indexed directories let us go straight to the block that should hold the
+  // name, and a miss there means the name isn't in the directory. Only scan
+  // linearly if the index can't be used or is corrupt, or if the filesystem
+  // is casefolded, where the hash doesn't cover the name as we were given it.
+  Status = Ext4HtreeRetrieveDirent (Directory, Name, Partition, Result);
+
+  if ((Status == EFI_SUCCESS) ||
+      ((Status != EFI_UNSUPPORTED) && (Status != EFI_VOLUME_CORRUPTED) &&
+       !EXT4_HAS_INCOMPAT (Partition, EXT4_FEATURE_INCOMPAT_CASEFOLD)))
+  {
+    return Status;
+  }
+
+  Buf = AllocatePool (Partition->BlockSize);
+
+  if (Buf == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Off = 0;
+
   while (Off < DirInoSize) {
     Length = Partition->BlockSize;
 
@@ -140,68 +245,11 @@ Ext4RetrieveDirent (
       return Status;
     }
 
-    for (BlockOffset = 0; BlockOffset < Partition->BlockSize; ) {
-      Entry          = (EXT4_DIR_ENTRY *)(Buf + BlockOffset);
-      RemainingBlock = Partition->BlockSize - BlockOffset;
-      // Check if the minimum directory entry fits inside [BlockOffset, EndOfBlock]
-      if (RemainingBlock < EXT4_MIN_DIR_ENTRY_LEN) {
-        FreePool (Buf);
-        return EFI_VOLUME_CORRUPTED;
-      }
-
-      if (!Ext4ValidDirent (Entry)) {
-        FreePool (Buf);
-        return EFI_VOLUME_CORRUPTED;
-      }
-
-      if ((Entry->name_len > RemainingBlock) || (Entry->rec_len > RemainingBlock)) {
-        // Corrupted filesystem
-        FreePool (Buf);
-        return EFI_VOLUME_CORRUPTED;
-      }
-
-      // Ignore names bigger than our limit.
-
-      /* Note: I think having a limit is sane because:
-        1) It's nicer to work with.
-        2) Linux and a number of BSDs also have a filename limit of 255.
-      */
-      if (Entry->name_len > EXT4_NAME_MAX) {
-        BlockOffset += Entry->rec_len;
-        continue;
-      }
-
-      // Unused entry
-      if (Entry->inode == 0) {
-        BlockOffset += Entry->rec_len;
-        continue;
-      }
-
-      Status = Ext4GetUcs2DirentName (Entry, DirentUcs2Name);
-
-      /* In theory, this should never fail.
-       * In reality, it's quite possible that it can fail, considering filenames in
-       * Linux (and probably other nixes) are just null-terminated bags of bytes, and don't
-       * need to form valid ASCII/UTF-8 sequences.
-       */
-      if (EFI_ERROR (Status)) {
-        // If we error out, skip this entry
-        // I'm not sure if this is correct behaviour, but I don't think there's a precedent here.
-        BlockOffset += Entry->rec_len;
-        continue;
-      }
-
-      if ((Entry->name_len == StrLen (Name)) &&
-          !Ext4StrCmpInsensitive (DirentUcs2Name, (CHAR16 *)Name))
-      {
-        ToCopy = MIN (Entry->rec_len, sizeof (EXT4_DIR_ENTRY));
-
-        CopyMem (Result, Entry, ToCopy);
-        FreePool (Buf);
-        return EFI_SUCCESS;
-      }
+    Status = Ext4SearchDirBlock (Partition, Buf, Name, Result);
 
-      BlockOffset += Entry->rec_len;
+    if (Status != EFI_NOT_FOUND) {
+      FreePool (Buf);
+      return Status;
     }
 
     Off += Partition->BlockSize;
@@ -417,6 +465,105 @@ Ext4OpenVolume (
   return EFI_SUCCESS;
 }
 
+/**
+   Fetches (part of) the directory entry at a given offset, from the
+   directory's current block.
+
+   When the offset moves to a new block, the whole block is read once, and
+   the inode table blocks of its entries are prefetched, as the caller is
+   about to open each of them.
+
+   @param[in]      Partition   Pointer to the ext4 partition.
+   @param[in]      File        Pointer to the open directory.
+   @param[in]      Offset      Directory position.
+   @param[out]     Entry       Pointer to the destination directory entry.
+   @param[out]     Length      Pointer to the number of bytes copied to Entry,
+                               0 at the end of the directory.
+
+   @return Result of the operation.
+**/
+STATIC
+EFI_STATUS
+Ext4GetDirentAt (
+  IN  EXT4_PARTITION  *Partition,
+  IN  EXT4_FILE       *File,
+  IN  UINT64          Offset,
+  OUT EXT4_DIR_ENTRY  *Entry,
+  OUT UINTN           *Length
+  )
+{
+  EFI_STATUS      Status;
+  UINT64          BlockOffset;
+  UINT32          OffsetInBlock;
+  UINTN           Len;
+  EXT4_INO_NR     *Inodes;
+  UINTN           NumberInodes;
+  UINTN           Index;
+  EXT4_DIR_ENTRY  *Dirent;
+
+  DivU64x32Remainder (Offset, Partition->BlockSize, &OffsetInBlock);
+  BlockOffset = Offset - OffsetInBlock;
+
+  if ((File->DirBlockLength == 0) || (File->DirBlockOffset != BlockOffset)) {
+    if (File->DirBlock == NULL) {
+      File->DirBlock = AllocatePool (Partition->BlockSize);
+
+      if (File->DirBlock == NULL) {
+        return EFI_OUT_OF_RESOURCES;
+      }
+    }
+
+    File->DirBlockLength = 0;
+
+    Len    = Partition->BlockSize;
+    Status = Ext4Read (Partition, File, File->DirBlock, BlockOffset, &Len);
+
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    File->DirBlockOffset = BlockOffset;
+    File->DirBlockLength = Len;
+
+    // Collect the block's inodes so they can be read in inode table order.
+    // Malformed entries are left for Ext4ReadDir to complain about.
+    Inodes = AllocatePool ((Len / EXT4_MIN_DIR_ENTRY_LEN) * sizeof (EXT4_INO_NR));
+
+    if (Inodes != NULL) {
+      NumberInodes = 0;
+
+      for (Index = 0; Index + EXT4_MIN_DIR_ENTRY_LEN <= Len; Index += Dirent->rec_len) {
+        Dirent = (EXT4_DIR_ENTRY *)(File->DirBlock + Index);
+
+        if (Dirent->rec_len < EXT4_MIN_DIR_ENTRY_LEN) {
+          break;
+        }
+
+        if (Dirent->inode != 0) {
+          Inodes[NumberInodes++] = Dirent->inode;
+        }
+      }
+
+      Ext4PrefetchInodes (Partition, Inodes, NumberInodes);
+      FreePool (Inodes);
+    }
+  }
+
+  if (OffsetInBlock >= File->DirBlockLength) {
+    // End of the directory
+    *Length = 0;
+    return EFI_SUCCESS;
+  }
+
+  // We (try to) fetch the maximum size of a directory entry at a time
+  // Note that we don't need to read any padding that may exist after it.
+  Len = MIN (sizeof (EXT4_DIR_ENTRY), File->DirBlockLength - OffsetInBlock);
+  CopyMem (Entry, File->DirBlock + OffsetInBlock, Len);
+
+  *Length = Len;
+  return EFI_SUCCESS;
+}
+
 /**
    Reads a directory entry.
 
@@ -461,10 +608,7 @@ Ext4ReadDir (
   while (TRUE) {
     TempFile = NULL;
 
-    // We (try to) read the maximum size of a directory entry at a time
-    // Note that we don't need to read any padding that may exist after it.
-    Len    = sizeof (Entry);
-    Status = Ext4Read (Partition, File, &Entry, Offset, &Len);
+    Status = Ext4GetDirentAt (Partition, File, Offset, &Entry, &Len);
 
     if (EFI_ERROR (Status)) {
       goto Out;
@@ -0,0 +1,701 @@
+/** @file
+  Hash tree (dir_index) directory lookups
+
+  Copyright (c) 2021 Pedro Falcato All rights reserved.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include "Ext4Dxe.h"
+
+#include <Library/BaseUcs2Utf8Lib.h>
+
+// Seed used when the superblock's s_hash_seed is all zeroes
+STATIC CONST UINT32  mExt4DefaultHashSeed[4] = {
+  0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476
+};
+
+// Hash value that's reserved as an end-of-directory marker
+#define EXT4_HTREE_EOF_32BIT  0x7fffffff
+
+#define EXT4_TEA_DELTA  0x9E3779B9
+
+#define EXT4_MD4_K1  0
+#define EXT4_MD4_K2  013240474631UL
+#define EXT4_MD4_K3  015666365641UL
+
+#define EXT4_MD4_F(x, y, z)  ((z) ^ ((x) & ((y) ^ (z))))
+#define EXT4_MD4_G(x, y, z)  (((x) & (y)) + (((x) ^ (y)) & (z)))
+#define EXT4_MD4_H(x, y, z)  ((x) ^ (y) ^ (z))
+
+// Position in an index node, one per level of the lookup path
+typedef struct {
+  CONST EXT4_DX_ENTRY    *Entries;
+  UINTN                  Count;
+  UINTN                  At;
+} EXT4_DX_FRAME;
+
+#define EXT4_MD4_ROUND(f, a, b, c, d, x, s)                                   \
+  do {                                                                         \
+    (a) += f ((b), (c), (d)) + (x);                                            \
+    (a)  = ((a) << (s)) | ((a) >> (32 - (s)));                                 \
+  } while (0)
+
+/**
+   Converts a character of a name to an integer, as the kernel does.
+
+   @param[in]      Char        Character.
+   @param[in]      Unsigned    TRUE if chars are unsigned.
+
+   @return The character's value, sign extended if Unsigned is FALSE.
+**/
+STATIC
+UINT32
+Ext4HashChar (
+  IN CHAR8    Char,
+  IN BOOLEAN  Unsigned
+  )
+{
+  if (Unsigned) {
+    return (UINT8)Char;
+  }
+
+  return (UINT32)(INT32)(INT8)Char;
+}
+
+/**
+   Computes the legacy (dx_hack_hash) hash of a name.
+
+   @param[in]      Name        Pointer to the name.
+   @param[in]      Length      Length of the name.
+   @param[in]      Unsigned    TRUE if chars are unsigned.
+
+   @return The hash.
+**/
+STATIC
+UINT32
+Ext4LegacyHash (
+  IN CONST CHAR8  *Name,
+  IN UINTN        Length,
+  IN BOOLEAN      Unsigned
+  )
+{
+  UINT32  Hash;
+  UINT32  Hash0;
+  UINT32  Hash1;
+
+  Hash0 = 0x12a3fe2d;
+  Hash1 = 0x37abe8f9;
+
+  while (Length-- != 0) {
+    Hash = Hash1 + (Hash0 ^ (Ext4HashChar (*Name++, Unsigned) * 7152373));
+
+    if ((Hash & 0x80000000) != 0) {
+      Hash -= 0x7fffffff;
+    }
+
+    Hash1 = Hash0;
+    Hash0 = Hash;
+  }
+
+  return Hash0 << 1;
+}
+
+/**
+   Packs (part of) a name into the input words of the TEA/half MD4 transforms.
+
+   @param[in]      Name        Pointer to the rest of the name.
+   @param[in]      Length      Length of the rest of the name.
+   @param[out]     Buf         Pointer to the output words.
+   @param[in]      Num         Number of output words.
+   @param[in]      Unsigned    TRUE if chars are unsigned.
+**/
+STATIC
+VOID
+Ext4StrToHashBuf (
+  IN CONST CHAR8  *Name,
+  IN INTN         Length,
+  OUT UINT32      *Buf,
+  IN INTN         Num,
+  IN BOOLEAN      Unsigned
+  )
+{
+  UINT32  Pad;
+  UINT32  Val;
+  INTN    Index;
+
+  Pad  = (UINT32)Length | ((UINT32)Length << 8);
+  Pad |= Pad << 16;
+
+  Val = Pad;
+
+  if (Length > Num * 4) {
+    Length = Num * 4;
+  }
+
+  for (Index = 0; Index < Length; Index++) {
+    Val = Ext4HashChar (Name[Index], Unsigned) + (Val << 8);
+    if ((Index % 4) == 3) {
+      *Buf++ = Val;
+      Val    = Pad;
+      Num--;
+    }
+  }
+
+  if (--Num >= 0) {
+    *Buf++ = Val;
+  }
+
+  while (--Num >= 0) {
+    *Buf++ = Pad;
+  }
+}
+
+/**
+   TEA transform, as used by the ext4 TEA directory hash.
+
+   @param[in out]  Buf         Hash state.
+   @param[in]      In          Input words.
+**/
+STATIC
+VOID
+Ext4TeaTransform (
+  IN OUT UINT32    Buf[4],
+  IN CONST UINT32  In[4]
+  )
+{
+  UINT32  Sum;
+  UINT32  B0;
+  UINT32  B1;
+  UINTN   Round;
+
+  Sum = 0;
+  B0  = Buf[0];
+  B1  = Buf[1];
+
+  for (Round = 0; Round < 16; Round++) {
+    Sum += EXT4_TEA_DELTA;
+    B0  += ((B1 << 4) + In[0]) ^ (B1 + Sum) ^ ((B1 >> 5) + In[1]);
+    B1  += ((B0 << 4) + In[2]) ^ (B0 + Sum) ^ ((B0 >> 5) + In[3]);
+  }
+
+  Buf[0] += B0;
+  Buf[1] += B1;
+}
+
+/**
+   Half MD4 transform, as used by the ext4 half MD4 directory hash.
+
+   @param[in out]  Buf         Hash state.
+   @param[in]      In          Input words.
+**/
+STATIC
+VOID
+Ext4HalfMd4Transform (
+  IN OUT UINT32    Buf[4],
+  IN CONST UINT32  In[8]
+  )
+{
+  UINT32  A;
+  UINT32  B;
+  UINT32  C;
+  UINT32  D;
+
+  A = Buf[0];
+  B = Buf[1];
+  C = Buf[2];
+  D = Buf[3];
+
+  EXT4_MD4_ROUND (EXT4_MD4_F, A, B, C, D, In[0] + EXT4_MD4_K1, 3);
+  EXT4_MD4_ROUND (EXT4_MD4_F, D, A, B, C, In[1] + EXT4_MD4_K1, 7);
+  EXT4_MD4_ROUND (EXT4_MD4_F, C, D, A, B, In[2] + EXT4_MD4_K1, 11);
+  EXT4_MD4_ROUND (EXT4_MD4_F, B, C, D, A, In[3] + EXT4_MD4_K1, 19);
+  EXT4_MD4_ROUND (EXT4_MD4_F, A, B, C, D, In[4] + EXT4_MD4_K1, 3);
+  EXT4_MD4_ROUND (EXT4_MD4_F, D, A, B, C, In[5] + EXT4_MD4_K1, 7);
+  EXT4_MD4_ROUND (EXT4_MD4_F, C, D, A, B, In[6] + EXT4_MD4_K1, 11);
+  EXT4_MD4_ROUND (EXT4_MD4_F, B, C, D, A, In[7] + EXT4_MD4_K1, 19);
+
+  EXT4_MD4_ROUND (EXT4_MD4_G, A, B, C, D, In[1] + EXT4_MD4_K2, 3);
+  EXT4_MD4_ROUND (EXT4_MD4_G, D, A, B, C, In[3] + EXT4_MD4_K2, 5);
+  EXT4_MD4_ROUND (EXT4_MD4_G, C, D, A, B, In[5] + EXT4_MD4_K2, 9);
+  EXT4_MD4_ROUND (EXT4_MD4_G, B, C, D, A, In[7] + EXT4_MD4_K2, 13);
+  EXT4_MD4_ROUND (EXT4_MD4_G, A, B, C, D, In[0] + EXT4_MD4_K2, 3);
+  EXT4_MD4_ROUND (EXT4_MD4_G, D, A, B, C, In[2] + EXT4_MD4_K2, 5);
+  EXT4_MD4_ROUND (EXT4_MD4_G, C, D, A, B, In[4] + EXT4_MD4_K2, 9);
+  EXT4_MD4_ROUND (EXT4_MD4_G, B, C, D, A, In[6] + EXT4_MD4_K2, 13);
+
+  EXT4_MD4_ROUND (EXT4_MD4_H, A, B, C, D, In[3] + EXT4_MD4_K3, 3);
+  EXT4_MD4_ROUND (EXT4_MD4_H, D, A, B, C, In[7] + EXT4_MD4_K3, 9);
+  EXT4_MD4_ROUND (EXT4_MD4_H, C, D, A, B, In[2] + EXT4_MD4_K3, 11);
+  EXT4_MD4_ROUND (EXT4_MD4_H, B, C, D, A, In[6] + EXT4_MD4_K3, 15);
+  EXT4_MD4_ROUND (EXT4_MD4_H, A, B, C, D, In[1] + EXT4_MD4_K3, 3);
+  EXT4_MD4_ROUND (EXT4_MD4_H, D, A, B, C, In[5] + EXT4_MD4_K3, 9);
+  EXT4_MD4_ROUND (EXT4_MD4_H, C, D, A, B, In[0] + EXT4_MD4_K3, 11);
+  EXT4_MD4_ROUND (EXT4_MD4_H, B, C, D, A, In[4] + EXT4_MD4_K3, 15);
+
+  Buf[0] += A;
+  Buf[1] += B;
+  Buf[2] += C;
+  Buf[3] += D;
+}
+
+/**
+   Computes the major directory hash of a name.
+
+   @param[in]      Partition   Pointer to the ext4 partition.
+   @param[in]      HashVersion Hash version, already adjusted for signedness.
+   @param[in]      Name        Pointer to the UTF-8 name.
+   @param[in]      Length      Length of the name, in bytes.
+   @param[out]     Hash        Pointer to the resulting hash.
+
+   @retval EFI_SUCCESS           The hash was computed.
+   @retval EFI_UNSUPPORTED       The hash version isn't supported.
+**/
+STATIC
+EFI_STATUS
+Ext4DirHash (
+  IN EXT4_PARTITION  *Partition,
+  IN UINT8           HashVersion,
+  IN CONST CHAR8     *Name,
+  IN UINTN           Length,
+  OUT UINT32         *Hash
+  )
+{
+  UINT32   Buf[4];
+  UINT32   In[8];
+  UINTN    Index;
+  INTN     Remaining;
+  BOOLEAN  Unsigned;
+  UINT32   Result;
+
+  CopyMem (Buf, mExt4DefaultHashSeed, sizeof (Buf));
+
+  for (Index = 0; Index < 4; Index++) {
+    if (Partition->SuperBlock.s_hash_seed[Index] != 0) {
+      CopyMem (Buf, Partition->SuperBlock.s_hash_seed, sizeof (Buf));
+      break;
+    }
+  }
+
+  Remaining = (INTN)Length;
+
+  switch (HashVersion) {
+    case EXT4_DX_HASH_LEGACY:
+    case EXT4_DX_HASH_LEGACY_UNSIGNED:
+      Result = Ext4LegacyHash (Name, Length, HashVersion == EXT4_DX_HASH_LEGACY_UNSIGNED);
+      break;
+    case EXT4_DX_HASH_HALF_MD4:
+    case EXT4_DX_HASH_HALF_MD4_UNSIGNED:
+      Unsigned = HashVersion == EXT4_DX_HASH_HALF_MD4_UNSIGNED;
+      while (Remaining > 0) {
+        Ext4StrToHashBuf (Name, Remaining, In, 8, Unsigned);
+        Ext4HalfMd4Transform (Buf, In);
+        Remaining -= 32;
+        Name      += 32;
+      }
+
+      Result = Buf[1];
+      break;
+    case EXT4_DX_HASH_TEA:
+    case EXT4_DX_HASH_TEA_UNSIGNED:
+      Unsigned = HashVersion == EXT4_DX_HASH_TEA_UNSIGNED;
+      while (Remaining > 0) {
+        Ext4StrToHashBuf (Name, Remaining, In, 4, Unsigned);
+        Ext4TeaTransform (Buf, In);
+        Remaining -= 16;
+        Name      += 16;
+      }
+
+      Result = Buf[0];
+      break;
+    default:
+      // SipHash is only used by encrypted + casefolded directories
+      return EFI_UNSUPPORTED;
+  }
+
+  Result &= ~1U;
+  if (Result == (EXT4_HTREE_EOF_32BIT << 1)) {
+    Result = (EXT4_HTREE_EOF_32BIT - 1) << 1;
+  }
+
+  *Hash = Result;
+  return EFI_SUCCESS;
+}
+
+/**
+   Reads a block of a directory.
+
+   @param[in]      Partition   Pointer to the ext4 partition.
+   @param[in]      Directory   Pointer to the opened directory.
+   @param[in]      Block       Logical block number.
+   @param[out]     Buf         Pointer to the buffer, of size Partition->BlockSize.
+
+   @return The result of the operation.
+**/
+STATIC
+EFI_STATUS
+Ext4ReadDirBlock (
+  IN EXT4_PARTITION  *Partition,
+  IN EXT4_FILE       *Directory,
+  IN UINT32          Block,
+  OUT CHAR8          *Buf
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Length;
+
+  Length = Partition->BlockSize;
+  Status = Ext4Read (Partition, Directory, Buf, EXT4_BLOCK_TO_BYTES (Partition, Block), &Length);
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (Length != Partition->BlockSize) {
+    // The index points past the end of the directory
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+   Validates the count/limit header of an index node.
+
+   @param[in]      Partition   Pointer to the ext4 partition.
+   @param[in]      Entries     Pointer to the index entries, starting with the
+                               count/limit header.
+   @param[in]      Offset      Offset of Entries inside the block.
+   @param[out]     Count       Number of entries in the node.
+
+   @retval EFI_SUCCESS           The node is sane.
+   @retval EFI_VOLUME_CORRUPTED  The node is corrupted.
+**/
+STATIC
+EFI_STATUS
+Ext4DxCheckNode (
+  IN EXT4_PARTITION       *Partition,
+  IN CONST EXT4_DX_ENTRY  *Entries,
+  IN UINTN                Offset,
+  OUT UINTN               *Count
+  )
+{
+  CONST EXT4_DX_COUNTLIMIT  *CountLimit;
+
+  CountLimit = (CONST EXT4_DX_COUNTLIMIT *)Entries;
+
+  if ((CountLimit->count == 0) || (CountLimit->count > CountLimit->limit) ||
+      (Offset + CountLimit->limit * sizeof (EXT4_DX_ENTRY) > Partition->BlockSize))
+  {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  *Count = CountLimit->count;
+  return EFI_SUCCESS;
+}
+
+/**
+   Finds the index entry that covers a hash.
+
+   @param[in]      Partition   Pointer to the ext4 partition.
+   @param[in]      Entries     Pointer to the index entries, starting with the
+                               count/limit header.
+   @param[in]      Offset      Offset of Entries inside the block.
+   @param[in]      Hash        Hash to look for.
+   @param[out]     Count       Number of entries in the node.
+   @param[out]     At          Index of the entry that covers Hash.
+
+   @retval EFI_SUCCESS           The entry was found.
+   @retval EFI_VOLUME_CORRUPTED  The node is corrupted.
+**/
+STATIC
+EFI_STATUS
+Ext4DxProbeNode (
+  IN EXT4_PARTITION       *Partition,
+  IN CONST EXT4_DX_ENTRY  *Entries,
+  IN UINTN                Offset,
+  IN UINT32               Hash,
+  OUT UINTN               *Count,
+  OUT UINTN               *At
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Low;
+  UINTN       High;
+  UINTN       Middle;
+
+  Status = Ext4DxCheckNode (Partition, Entries, Offset, Count);
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  // Entry 0 has an implicit hash of 0, so search [1, count) for the last entry
+  // whose hash is <= Hash.
+  Low  = 1;
+  High = *Count;
+
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (Entries[Middle].hash > Hash) {
+      High = Middle;
+    } else {
+      Low = Middle + 1;
+    }
+  }
+
+  *At = Low - 1;
+  return EFI_SUCCESS;
+}
+
+/**
+   Moves the lookup path to the next leaf that may still hold names with
+   the given hash, like the kernel's ext4_htree_next_block().
+
+   Climbs to the lowest index node that has an entry after the current one,
+   and stops if that entry doesn't continue a run of colliding hashes.
+   Otherwise, reads the index nodes below it and points every level below at
+   its first entry.
+
+   @param[in]      Partition   Pointer to the ext4 partition.
+   @param[in]      Directory   Pointer to the opened directory.
+   @param[in]      Hash        Hash that's being looked up.
+   @param[in out]  Frames      Lookup path, one frame per level.
+   @param[in]      Levels      Number of index levels below the root.
+   @param[in]      IndexBuf    Buffer holding one index block per level.
+
+   @retval EFI_SUCCESS           The path points at the next leaf.
+   @retval EFI_NOT_FOUND         No other leaf may hold the hash.
+   @retval EFI_VOLUME_CORRUPTED  The index is corrupted.
+**/
+STATIC
+EFI_STATUS
+Ext4DxNextLeaf (
+  IN EXT4_PARTITION     *Partition,
+  IN EXT4_FILE          *Directory,
+  IN UINT32             Hash,
+  IN OUT EXT4_DX_FRAME  *Frames,
+  IN UINT8              Levels,
+  IN CHAR8              *IndexBuf
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Level;
+  CHAR8       *Node;
+
+  Level = Levels;
+
+  while (Frames[Level].At + 1 >= Frames[Level].Count) {
+    if (Level == 0) {
+      return EFI_NOT_FOUND;
+    }
+
+    Level--;
+  }
+
+  Frames[Level].At++;
+
+  if ((Frames[Level].Entries[Frames[Level].At].hash & ~1U) != Hash) {
+    return EFI_NOT_FOUND;
+  }
+
+  while (Level < Levels) {
+    Node   = IndexBuf + (Level + 1) * Partition->BlockSize;
+    Status = Ext4ReadDirBlock (
+               Partition,
+               Directory,
+               Frames[Level].Entries[Frames[Level].At].block & EXT4_DX_BLOCK_MASK,
+               Node
+               );
+
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    Level++;
+    Frames[Level].Entries = (CONST EXT4_DX_ENTRY *)(Node + EXT4_DX_NODE_ENTRIES_OFFSET);
+    Frames[Level].At      = 0;
+
+    Status = Ext4DxCheckNode (Partition, Frames[Level].Entries, EXT4_DX_NODE_ENTRIES_OFFSET, &Frames[Level].Count);
+
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+   Retrieves a directory entry using the directory's hash tree index.
+
+   Only the leaf block(s) the name hashes to are searched, so EFI_NOT_FOUND
+   means the directory doesn't contain the name.
+
+   @param[in]      Directory   Pointer to the opened directory.
+   @param[in]      Name        Pointer to the UCS-2 formatted filename.
+   @param[in]      Partition   Pointer to the ext4 partition.
+   @param[out]     Result      Pointer to the destination directory entry.
+
+   @retval EFI_SUCCESS           The entry was found.
+   @retval EFI_NOT_FOUND         The entry wasn't found in the hashed blocks.
+   @retval EFI_UNSUPPORTED       The directory isn't indexed, or uses an
+                                 unsupported hash.
+   @retval EFI_VOLUME_CORRUPTED  The index is corrupted.
+**/
+EFI_STATUS
+Ext4HtreeRetrieveDirent (
+  IN EXT4_FILE        *Directory,
+  IN CONST CHAR16     *Name,
+  IN EXT4_PARTITION   *Partition,
+  OUT EXT4_DIR_ENTRY  *Result
+  )
+{
+  EFI_STATUS               Status;
+  CHAR8                    *Utf8Name;
+  UINTN                    Utf8Length;
+  CHAR8                    *IndexBuf;
+  CHAR8                    *LeafBuf;
+  CONST EXT4_DX_ROOT_INFO  *RootInfo;
+  EXT4_DX_FRAME            Frames[EXT4_DX_MAX_LEVELS_LARGEDIR];
+  EXT4_DX_FRAME            *Frame;
+  UINT8                    HashVersion;
+  UINT8                    Levels;
+  UINT8                    Level;
+  UINT8                    MaxLevels;
+  UINTN                    EntriesOffset;
+  UINT32                   Hash;
+  UINT32                   Block;
+
+  if (!EXT4_HAS_COMPAT (Partition, EXT4_FEATURE_COMPAT_DIR_INDEX) ||
+      ((Directory->Inode->i_flags & EXT4_INDEX_FL) == 0))
+  {
+    return EFI_UNSUPPORTED;
+  }
+
+  Utf8Name = NULL;
+  IndexBuf = NULL;
+  LeafBuf  = NULL;
+
+  Status = UCS2StrToUTF8 ((CHAR16 *)Name, &Utf8Name);
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Utf8Length = AsciiStrLen (Utf8Name);
+
+  if ((Utf8Length == 0) || (Utf8Length > EXT4_NAME_MAX)) {
+    Status = EFI_NOT_FOUND;
+    goto Out;
+  }
+
+  // One index block per level, so the path can be climbed back up
+  IndexBuf = AllocatePool (Partition->BlockSize * EXT4_DX_MAX_LEVELS_LARGEDIR);
+  LeafBuf  = AllocatePool (Partition->BlockSize);
+
+  if ((IndexBuf == NULL) || (LeafBuf == NULL)) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Out;
+  }
+
+  Status = Ext4ReadDirBlock (Partition, Directory, 0, IndexBuf);
+
+  if (EFI_ERROR (Status)) {
+    goto Out;
+  }
+
+  RootInfo = (CONST EXT4_DX_ROOT_INFO *)(IndexBuf + EXT4_DX_ROOT_INFO_OFFSET);
+
+  MaxLevels = EXT4_HAS_INCOMPAT (Partition, EXT4_FEATURE_INCOMPAT_LARGEDIR) ?
+              EXT4_DX_MAX_LEVELS_LARGEDIR : EXT4_DX_MAX_LEVELS;
+
+  if ((RootInfo->reserved_zero != 0) || (RootInfo->info_length != sizeof (EXT4_DX_ROOT_INFO)) ||
+      (RootInfo->indirect_levels >= MaxLevels))
+  {
+    Status = EFI_VOLUME_CORRUPTED;
+    goto Out;
+  }
+
+  HashVersion = RootInfo->hash_version;
+
+  if ((HashVersion <= EXT4_DX_HASH_TEA) &&
+      ((Partition->SuperBlock.s_flags & EXT4_FLAGS_UNSIGNED_HASH) != 0))
+  {
+    HashVersion += EXT4_DX_HASH_LEGACY_UNSIGNED;
+  }
+
+  Status = Ext4DirHash (Partition, HashVersion, Utf8Name, Utf8Length, &Hash);
+
+  if (EFI_ERROR (Status)) {
+    goto Out;
+  }
+
+  // Walk down the index nodes, keeping level N's node at IndexBuf + N blocks
+  Levels        = RootInfo->indirect_levels;
+  EntriesOffset = EXT4_DX_ROOT_INFO_OFFSET + RootInfo->info_length;
+
+  for (Level = 0; ; Level++) {
+    Frame          = &Frames[Level];
+    Frame->Entries = (CONST EXT4_DX_ENTRY *)(IndexBuf + Level * Partition->BlockSize + EntriesOffset);
+    Status         = Ext4DxProbeNode (Partition, Frame->Entries, EntriesOffset, Hash, &Frame->Count, &Frame->At);
+
+    if (EFI_ERROR (Status)) {
+      goto Out;
+    }
+
+    if (Level == Levels) {
+      break;
+    }
+
+    Status = Ext4ReadDirBlock (
+               Partition,
+               Directory,
+               Frame->Entries[Frame->At].block & EXT4_DX_BLOCK_MASK,
+               IndexBuf + (Level + 1) * Partition->BlockSize
+               );
+
+    if (EFI_ERROR (Status)) {
+      goto Out;
+    }
+
+    EntriesOffset = EXT4_DX_NODE_ENTRIES_OFFSET;
+  }
+
+  // Search the leaf, then any following leaves the hash spilled into, which
+  // may hang off a different index node. A leaf that continues a run of
+  // colliding hashes has the low bit of its index hash set.
+  while (TRUE) {
+    Frame  = &Frames[Levels];
+    Block  = Frame->Entries[Frame->At].block & EXT4_DX_BLOCK_MASK;
+    Status = Ext4ReadDirBlock (Partition, Directory, Block, LeafBuf);
+
+    if (EFI_ERROR (Status)) {
+      goto Out;
+    }
+
+    Status = Ext4SearchDirBlock (Partition, LeafBuf, Name, Result);
+
+    if (Status != EFI_NOT_FOUND) {
+      goto Out;
+    }
+
+    Status = Ext4DxNextLeaf (Partition, Directory, Hash, Frames, Levels, IndexBuf);
+
+    if (EFI_ERROR (Status)) {
+      goto Out;
+    }
+  }
+
+Out:
+  if (LeafBuf != NULL) {
+    FreePool (LeafBuf);
+  }
+
+  if (IndexBuf != NULL) {
+    FreePool (IndexBuf);
+  }
+
+  FreePool (Utf8Name);
+  return Status;
+}
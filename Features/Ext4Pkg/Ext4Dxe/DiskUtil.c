@@ -33,6 +33,127 @@ Ext4ReadDiskIo (
                                      );
 }
 
+/**
+   Initialises an empty batch of disk reads.
+
+   @param[in]  Partition      Pointer to the opened ext4 partition.
+   @param[out] Batch          Pointer to the batch.
+**/
+VOID
+Ext4InitIoBatch (
+  IN  EXT4_PARTITION  *Partition,
+  OUT EXT4_IO_BATCH   *Batch
+  )
+{
+  Batch->Pending = 0;
+  Batch->Status  = EFI_SUCCESS;
+
+  // DiskIo2 completions are signalled from the disk driver's timer callbacks,
+  // so we can only poll for them if we're not blocking those.
+  Batch->Async = EXT4_DISK_IO2 (Partition) != NULL &&
+                 EfiGetCurrentTpl () == TPL_APPLICATION;
+}
+
+/**
+   Waits for every read in a batch of disk reads to complete.
+
+   @param[in]      Partition      Pointer to the opened ext4 partition.
+   @param[in out]  Batch          Pointer to the batch.
+
+   @return The first error reported by a read of the batch, or EFI_SUCCESS.
+**/
+EFI_STATUS
+Ext4WaitIoBatch (
+  IN     EXT4_PARTITION  *Partition,
+  IN OUT EXT4_IO_BATCH   *Batch
+  )
+{
+  UINTN               Index;
+  EFI_DISK_IO2_TOKEN  *Token;
+
+  for (Index = 0; Index < Batch->Pending; Index++) {
+    Token = &Batch->Tokens[Index];
+
+    while (gBS->CheckEvent (Token->Event) == EFI_NOT_READY) {
+    }
+
+    if (EFI_ERROR (Token->TransactionStatus) && !EFI_ERROR (Batch->Status)) {
+      Batch->Status = Token->TransactionStatus;
+    }
+
+    gBS->CloseEvent (Token->Event);
+  }
+
+  Batch->Pending = 0;
+
+  return Batch->Status;
+}
+
+/**
+   Adds a read to a batch of disk reads. Buffer must stay valid until
+   Ext4WaitIoBatch is called.
+
+   @param[in]      Partition      Pointer to the opened ext4 partition.
+   @param[in out]  Batch          Pointer to the batch.
+   @param[out]     Buffer         Pointer to a destination buffer.
+   @param[in]      Length         Length of the destination buffer.
+   @param[in]      Offset         Offset, in bytes, of the location to read.
+**/
+VOID
+Ext4SubmitIoBatchRead (
+  IN     EXT4_PARTITION  *Partition,
+  IN OUT EXT4_IO_BATCH   *Batch,
+  OUT    VOID            *Buffer,
+  IN     UINTN           Length,
+  IN     UINT64          Offset
+  )
+{
+  EFI_STATUS          Status;
+  EFI_DISK_IO2_TOKEN  *Token;
+
+  if (EFI_ERROR (Batch->Status)) {
+    // The batch already failed, don't bother
+    return;
+  }
+
+  if (Batch->Pending == EXT4_MAX_ASYNC_READS) {
+    if (EFI_ERROR (Ext4WaitIoBatch (Partition, Batch))) {
+      return;
+    }
+  }
+
+  if (Batch->Async) {
+    Token  = &Batch->Tokens[Batch->Pending];
+    Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &Token->Event);
+
+    if (!EFI_ERROR (Status)) {
+      Status = EXT4_DISK_IO2 (Partition)->ReadDiskEx (
+                                            EXT4_DISK_IO2 (Partition),
+                                            EXT4_MEDIA_ID (Partition),
+                                            Offset,
+                                            Token,
+                                            Length,
+                                            Buffer
+                                            );
+
+      if (!EFI_ERROR (Status)) {
+        Batch->Pending++;
+        return;
+      }
+
+      gBS->CloseEvent (Token->Event);
+    }
+
+    // Fall back to a synchronous read for this one
+  }
+
+  Status = Ext4ReadDiskIo (Partition, Buffer, Length, Offset);
+
+  if (EFI_ERROR (Status)) {
+    Batch->Status = Status;
+  }
+}
+
 /**
    Reads blocks from the partition's disk using the DISK_IO protocol.
 
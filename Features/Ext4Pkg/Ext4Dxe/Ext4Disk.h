@@ -68,7 +68,9 @@
           mostly-list of EXT4_DIR_ENTRY.
        2) Hash tree directories: These are used for larger directories, with
           hundreds of entries, and are designed in a backwards compatible way.
-          These are not yet implemented in the Ext4Dxe driver.
+          Ext4Dxe uses the hash tree to find a name's leaf block, and only
+          falls back to a linear scan when the index is corrupt or the
+          filesystem is casefolded.
 
   7) Journal
      Ext3/4 filesystems have a journal to help protect the filesystem against
@@ -127,6 +129,7 @@
 #define EXT4_FEATURE_INCOMPAT_LARGEDIR     0x04000
 #define EXT4_FEATURE_INCOMPAT_INLINE_DATA  0x08000
 #define EXT4_FEATURE_INCOMPAT_ENCRYPT      0x10000
+#define EXT4_FEATURE_INCOMPAT_CASEFOLD     0x20000
 
 #define EXT4_FEATURE_RO_COMPAT_SPARSE_SUPER   0x0001
 #define EXT4_FEATURE_RO_COMPAT_LARGE_FILE     0x0002
@@ -406,6 +409,60 @@ typedef struct {
 
 #define EXT4_MIN_DIR_ENTRY_LEN  8
 
+/* Hash tree (dir_index) directories
+ * Block 0 of a directory with EXT4_INDEX_FL holds the "." and ".." entries,
+ * a EXT4_DX_ROOT_INFO and an array of EXT4_DX_ENTRY sorted by hash. Inner
+ * index nodes are blocks that start with an empty directory entry covering
+ * the whole block, followed by the EXT4_DX_ENTRY array. The first entry
+ * of each array is overlaid by a EXT4_DX_COUNTLIMIT and has an implicit hash
+ * of 0. Leaf blocks are ordinary blocks of directory entries.
+ */
+#define EXT4_DX_HASH_LEGACY             0
+#define EXT4_DX_HASH_HALF_MD4           1
+#define EXT4_DX_HASH_TEA                2
+#define EXT4_DX_HASH_LEGACY_UNSIGNED    3
+#define EXT4_DX_HASH_HALF_MD4_UNSIGNED  4
+#define EXT4_DX_HASH_TEA_UNSIGNED       5
+#define EXT4_DX_HASH_SIPHASH            6
+
+// s_flags bits that select the signedness of chars for the hash functions
+#define EXT4_FLAGS_SIGNED_HASH    0x0001
+#define EXT4_FLAGS_UNSIGNED_HASH  0x0002
+
+typedef struct {
+  UINT32    reserved_zero;
+  UINT8     hash_version;
+  // Length of this structure, 8
+  UINT8     info_length;
+  // Number of levels of index nodes below the root
+  UINT8     indirect_levels;
+  UINT8     unused_flags;
+} EXT4_DX_ROOT_INFO;
+
+// The root info follows the 12 byte "." and ".." entries
+#define EXT4_DX_ROOT_INFO_OFFSET  24
+// Index node entries follow an 8 byte empty directory entry
+#define EXT4_DX_NODE_ENTRIES_OFFSET  8
+
+typedef struct {
+  UINT32    hash;
+  // Logical block of the directory
+  UINT32    block;
+} EXT4_DX_ENTRY;
+
+typedef struct {
+  UINT16    limit;
+  UINT16    count;
+  UINT32    block;
+} EXT4_DX_COUNTLIMIT;
+
+// Only the low 28 bits of EXT4_DX_ENTRY.block are the block number
+#define EXT4_DX_BLOCK_MASK  0x0FFFFFFF
+
+// Maximum number of levels, root included; 3 with INCOMPAT_LARGEDIR
+#define EXT4_DX_MAX_LEVELS           2
+#define EXT4_DX_MAX_LEVELS_LARGEDIR  3
+
 // This on-disk structure is present at the bottom of the extent tree
 typedef struct {
   // First logical block
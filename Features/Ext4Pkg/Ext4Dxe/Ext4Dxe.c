@@ -513,6 +513,8 @@ Ext4EntryPoint (
 {
   EFI_STATUS  Status;
 
+  Ext4InitialiseCrc ();
+
   Status = EfiLibInstallAllDriverProtocols2 (
              ImageHandle,
              SystemTable,
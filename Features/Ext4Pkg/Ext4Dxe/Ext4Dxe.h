@@ -58,6 +58,50 @@ Ext4OpenPartition (
 typedef struct _Ext4File     EXT4_FILE;
 typedef struct _Ext4_Dentry  EXT4_DENTRY;
 
+// Maximum number of metadata blocks kept in a partition's block cache
+#define EXT4_BLOCK_CACHE_MAX_BLOCKS  64
+#define EXT4_BLOCK_CACHE_HASH_SIZE   32
+
+/**
+   A metadata block (inode table, extent tree or block map block) in the
+   partition's block cache. Verified holds one bit per checksummed object
+   in the block (an inode, or the whole block for extent nodes) that has
+   already passed its checksum check.
+ */
+typedef struct {
+  LIST_ENTRY       LruNode;
+  LIST_ENTRY       HashNode;
+  EXT4_BLOCK_NR    Block;
+  UINT8            *Data;
+  UINT8            *Verified;
+} EXT4_BLOCK_CACHE_ENTRY;
+
+#define EXT4_BLOCK_CACHE_ENTRY_FROM_LRU_NODE(Node)                             \
+  BASE_CR(Node, EXT4_BLOCK_CACHE_ENTRY, LruNode)
+
+#define EXT4_BLOCK_CACHE_ENTRY_FROM_HASH_NODE(Node)                            \
+  BASE_CR(Node, EXT4_BLOCK_CACHE_ENTRY, HashNode)
+
+/**
+   Checks if an object in a cached block has already been verified.
+
+   @param[in]  Entry          Pointer to the EXT4_BLOCK_CACHE_ENTRY.
+   @param[in]  Slot           Index of the object inside the block.
+
+   @return TRUE if the object's checksum was verified, else FALSE.
+**/
+#define EXT4_BLOCK_CACHE_IS_VERIFIED(Entry, Slot)                              \
+  (((Entry)->Verified[(Slot) / 8] & (1 << ((Slot) % 8))) != 0)
+
+/**
+   Marks an object in a cached block as verified.
+
+   @param[in]  Entry          Pointer to the EXT4_BLOCK_CACHE_ENTRY.
+   @param[in]  Slot           Index of the object inside the block.
+**/
+#define EXT4_BLOCK_CACHE_SET_VERIFIED(Entry, Slot)                             \
+  ((Entry)->Verified[(Slot) / 8] |= (UINT8)(1 << ((Slot) % 8)))
+
 typedef struct _Ext4_PARTITION {
   EFI_SIMPLE_FILE_SYSTEM_PROTOCOL    Interface;
   EFI_DISK_IO_PROTOCOL               *DiskIo;
@@ -85,6 +129,11 @@ typedef struct _Ext4_PARTITION {
   LIST_ENTRY                         OpenFiles;
 
   EXT4_DENTRY                        *RootDentry;
+
+  LIST_ENTRY                         BlockCacheLru;
+  LIST_ENTRY                         BlockCacheHash[EXT4_BLOCK_CACHE_HASH_SIZE];
+  UINTN                              BlockCacheCount;
+  UINT32                             BlockCacheMediaId;
 } EXT4_PARTITION;
 
 /**
@@ -227,6 +276,67 @@ Ext4ReadBlocks (
   IN EXT4_BLOCK_NR   BlockNumber
   );
 
+// Maximum number of DiskIo2 reads an EXT4_IO_BATCH keeps in flight
+#define EXT4_MAX_ASYNC_READS  8
+
+/**
+   A batch of disk reads. When the partition has DISK_IO2, reads are issued
+   asynchronously and only waited for by Ext4WaitIoBatch; otherwise they're
+   done synchronously as they're submitted.
+**/
+typedef struct {
+  EFI_DISK_IO2_TOKEN    Tokens[EXT4_MAX_ASYNC_READS];
+  UINTN                 Pending;
+  BOOLEAN               Async;
+  // First error reported by any read of the batch
+  EFI_STATUS            Status;
+} EXT4_IO_BATCH;
+
+/**
+   Initialises an empty batch of disk reads.
+
+   @param[in]  Partition      Pointer to the opened ext4 partition.
+   @param[out] Batch          Pointer to the batch.
+**/
+VOID
+Ext4InitIoBatch (
+  IN  EXT4_PARTITION  *Partition,
+  OUT EXT4_IO_BATCH   *Batch
+  );
+
+/**
+   Adds a read to a batch of disk reads. Buffer must stay valid until
+   Ext4WaitIoBatch is called.
+
+   @param[in]      Partition      Pointer to the opened ext4 partition.
+   @param[in out]  Batch          Pointer to the batch.
+   @param[out]     Buffer         Pointer to a destination buffer.
+   @param[in]      Length         Length of the destination buffer.
+   @param[in]      Offset         Offset, in bytes, of the location to read.
+**/
+VOID
+Ext4SubmitIoBatchRead (
+  IN     EXT4_PARTITION  *Partition,
+  IN OUT EXT4_IO_BATCH   *Batch,
+  OUT    VOID            *Buffer,
+  IN     UINTN           Length,
+  IN     UINT64          Offset
+  );
+
+/**
+   Waits for every read in a batch of disk reads to complete.
+
+   @param[in]      Partition      Pointer to the opened ext4 partition.
+   @param[in out]  Batch          Pointer to the batch.
+
+   @return The first error reported by a read of the batch, or EFI_SUCCESS.
+**/
+EFI_STATUS
+Ext4WaitIoBatch (
+  IN     EXT4_PARTITION  *Partition,
+  IN OUT EXT4_IO_BATCH   *Batch
+  );
+
 /**
    Allocates a buffer and reads blocks from the partition's disk using the
 DISK_IO protocol. This function is deprecated and will be removed in the future.
@@ -245,6 +355,47 @@ Ext4AllocAndReadBlocks (
   IN EXT4_BLOCK_NR   BlockNumber
   );
 
+/**
+   Initialises the (empty) block cache of a partition.
+
+   @param[in out]  Partition  Pointer to the ext4 partition.
+**/
+VOID
+Ext4BlockCacheInit (
+  IN OUT EXT4_PARTITION  *Partition
+  );
+
+/**
+   Drops and frees every block in the block cache of a partition.
+
+   @param[in out]  Partition  Pointer to the ext4 partition.
+**/
+VOID
+Ext4BlockCacheFlush (
+  IN OUT EXT4_PARTITION  *Partition
+  );
+
+/**
+   Reads a metadata block through the partition's block cache.
+
+   The returned entry stays valid until the next call into the block cache,
+   and its data must not be modified.
+
+   @param[in]  Partition      Pointer to the opened ext4 partition.
+   @param[in]  Block          Block number.
+   @param[out] OutEntry       Pointer to where the cache entry will be stored.
+
+   @retval EFI_SUCCESS            The block was read.
+   @retval EFI_OUT_OF_RESOURCES   Memory allocation failed.
+   @retval !EFI_SUCCESS           The disk read failed.
+**/
+EFI_STATUS
+Ext4BlockCacheRead (
+  IN EXT4_PARTITION            *Partition,
+  IN EXT4_BLOCK_NR             Block,
+  OUT EXT4_BLOCK_CACHE_ENTRY  **OutEntry
+  );
+
 /**
    Checks if the opened partition has the 64-bit feature (see
 EXT4_FEATURE_INCOMPAT_64BIT).
@@ -299,6 +450,22 @@ Ext4ReadInode (
   OUT EXT4_INODE     **OutIno
   );
 
+/**
+   Pulls the inode table blocks of a set of inodes into the block cache, in
+   on-disk order, so that reading the inodes afterwards doesn't seek back and
+   forth across the inode tables.
+
+   @param[in]      Partition  Pointer to the opened partition.
+   @param[in out]  Inodes     Array of inode numbers. It's sorted in place.
+   @param[in]      Count      Number of inodes in the array.
+**/
+VOID
+Ext4PrefetchInodes (
+  IN     EXT4_PARTITION  *Partition,
+  IN OUT EXT4_INO_NR     *Inodes,
+  IN     UINTN           Count
+  );
+
 /**
    Converts blocks to bytes.
 
@@ -377,11 +544,25 @@ struct _Ext4File {
 
   // Owning reference to this file's directory entry.
   EXT4_DENTRY           *Dentry;
+
+  // Readahead window for small sequential reads, see Ext4Read
+  UINT8                 *ReadAheadBuffer;
+  UINT64                ReadAheadOffset;
+  UINTN                 ReadAheadLength;
+  UINT64                LastReadEnd;
+
+  // Directory block that Ext4ReadDir is currently walking, decoded once
+  CHAR8                 *DirBlock;
+  UINT64                DirBlockOffset;
+  UINTN                 DirBlockLength;
 };
 
 #define EXT4_FILE_FROM_OPEN_FILES_NODE(Node)                                   \
   BASE_CR(Node, EXT4_FILE, OpenFilesListNode)
 
+// Size of a file's readahead window
+#define EXT4_READAHEAD_SIZE  SIZE_64KB
+
 /**
    Retrieves a directory entry.
 
@@ -400,6 +581,52 @@ Ext4RetrieveDirent (
   OUT EXT4_DIR_ENTRY  *Result
   );
 
+/**
+   Searches a directory block for a directory entry.
+
+   @param[in]      Partition   Pointer to the ext4 partition.
+   @param[in]      Block       Pointer to the contents of the directory block,
+                               of size Partition->BlockSize.
+   @param[in]      Name        Pointer to the UCS-2 formatted filename.
+   @param[out]     Result      Pointer to the destination directory entry.
+
+   @retval EFI_SUCCESS           The entry was found and copied to Result.
+   @retval EFI_NOT_FOUND         The block doesn't contain the entry.
+   @retval EFI_VOLUME_CORRUPTED  The block is corrupted.
+**/
+EFI_STATUS
+Ext4SearchDirBlock (
+  IN EXT4_PARTITION   *Partition,
+  IN CONST CHAR8      *Block,
+  IN CONST CHAR16     *Name,
+  OUT EXT4_DIR_ENTRY  *Result
+  );
+
+/**
+   Retrieves a directory entry using the directory's hash tree index.
+
+   Only the leaf block(s) the name hashes to are searched, so EFI_NOT_FOUND
+   means the directory doesn't contain the name.
+
+   @param[in]      Directory   Pointer to the opened directory.
+   @param[in]      Name        Pointer to the UCS-2 formatted filename.
+   @param[in]      Partition   Pointer to the ext4 partition.
+   @param[out]     Result      Pointer to the destination directory entry.
+
+   @retval EFI_SUCCESS           The entry was found.
+   @retval EFI_NOT_FOUND         The entry wasn't found in the hashed blocks.
+   @retval EFI_UNSUPPORTED       The directory isn't indexed, or uses an
+                                 unsupported hash.
+   @retval EFI_VOLUME_CORRUPTED  The index is corrupted.
+**/
+EFI_STATUS
+Ext4HtreeRetrieveDirent (
+  IN EXT4_FILE        *Directory,
+  IN CONST CHAR16     *Name,
+  IN EXT4_PARTITION   *Partition,
+  OUT EXT4_DIR_ENTRY  *Result
+  );
+
 /**
    Opens a file.
 
@@ -1079,6 +1306,89 @@ Ext4CalculateBlockGroupDescChecksum (
 // Note: Might be a good idea to provide generic Ext4Has$feature() through
 // macros.
 
+/**
+   Builds the CRC tables and detects CRC instructions.
+   Must be called before any other CRC routine.
+**/
+VOID
+Ext4InitialiseCrc (
+  VOID
+  );
+
+/**
+   Updates a CRC32C (Castagnoli), as used by metadata_csum.
+   Unlike CalculateCrc32c, neither the initial value nor the result is
+   inverted, which is what ext4 wants.
+
+   @param[in]  Crc            Current CRC.
+   @param[in]  Buffer         Pointer to the buffer.
+   @param[in]  Length         Length of the buffer, in bytes.
+
+   @return The updated CRC.
+**/
+UINT32
+Ext4CalculateCrc32c (
+  IN UINT32      Crc,
+  IN CONST VOID  *Buffer,
+  IN UINTN       Length
+  );
+
+/**
+   Updates a CRC32C (Castagnoli) with the byte-wise table, whatever the CPU
+   supports. Neither the initial value nor the result is inverted.
+
+   @param[in]  Crc            Current CRC.
+   @param[in]  Buffer         Pointer to the buffer.
+   @param[in]  Length         Length of the buffer, in bytes.
+
+   @return The updated CRC.
+**/
+UINT32
+Ext4CalculateCrc32cTable (
+  IN UINT32      Crc,
+  IN CONST VOID  *Buffer,
+  IN UINTN       Length
+  );
+
+#if defined (MDE_CPU_AARCH64) || defined (MDE_CPU_X64)
+
+/**
+   Updates a CRC32C using the CPU's CRC32C instructions.
+   Must only be called if the CPU implements them.
+
+   @param[in]  Crc            Current (non-inverted) CRC.
+   @param[in]  Buffer         Pointer to the buffer.
+   @param[in]  Length         Length of the buffer, in bytes.
+
+   @return The updated CRC.
+**/
+UINT32
+EFIAPI
+Ext4Crc32cHw (
+  IN UINT32      Crc,
+  IN CONST VOID  *Buffer,
+  IN UINTN       Length
+  );
+
+#endif
+
+/**
+   Updates a CRC16 (ANSI/ARC polynomial, reflected), as used by gdt_csum.
+   Neither the initial value nor the result is inverted.
+
+   @param[in]  Crc            Current CRC.
+   @param[in]  Buffer         Pointer to the buffer.
+   @param[in]  Length         Length of the buffer, in bytes.
+
+   @return The updated CRC.
+**/
+UINT16
+Ext4CalculateCrc16 (
+  IN UINT16      Crc,
+  IN CONST VOID  *Buffer,
+  IN UINTN       Length
+  );
+
 /**
    Checks if metadata_csum is enabled on the partition.
    @param[in]      Partition           Pointer to the opened EXT4 partition.
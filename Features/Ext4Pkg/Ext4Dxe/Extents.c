@@ -230,17 +230,16 @@ Ext4GetExtent (
   OUT EXT4_EXTENT     *Extent
   )
 {
-  EXT4_INODE          *Inode;
-  VOID                *Buffer;
-  EXT4_EXTENT         *Ext;
-  UINT32              CurrentDepth;
-  EXT4_EXTENT_HEADER  *ExtHeader;
-  EXT4_EXTENT_INDEX   *Index;
-  EFI_STATUS          Status;
-
-  Inode  = File->Inode;
-  Ext    = NULL;
-  Buffer = NULL;
+  EXT4_INODE              *Inode;
+  EXT4_EXTENT             *Ext;
+  UINT32                  CurrentDepth;
+  EXT4_EXTENT_HEADER      *ExtHeader;
+  EXT4_EXTENT_INDEX       *Index;
+  EFI_STATUS              Status;
+  EXT4_BLOCK_CACHE_ENTRY  *CacheEntry;
+
+  Inode = File->Inode;
+  Ext   = NULL;
 
   DEBUG ((DEBUG_FS, "[ext4] Looking up extent for block %lu\n", LogicalBlock));
 
@@ -288,36 +287,30 @@ Ext4GetExtent (
 
     Index = Ext4BinsearchExtentIndex (ExtHeader, LogicalBlock);
 
-    if (Buffer == NULL) {
-      Buffer = AllocatePool (Partition->BlockSize);
-      if (Buffer == NULL) {
-        return EFI_OUT_OF_RESOURCES;
-      }
-    }
-
-    // Read the leaf block onto the previously-allocated buffer.
+    // Read the next node through the block cache; index nodes near the root
+    // are shared by every lookup on this file.
 
-    Status = Ext4ReadBlocks (Partition, Buffer, 1, Ext4ExtentIdxLeafBlock (Index));
+    Status = Ext4BlockCacheRead (Partition, Ext4ExtentIdxLeafBlock (Index), &CacheEntry);
     if (EFI_ERROR (Status)) {
-      FreePool (Buffer);
       return Status;
     }
 
-    ExtHeader = Buffer;
+    ExtHeader = (EXT4_EXTENT_HEADER *)CacheEntry->Data;
 
     if (!Ext4ExtentHeaderValid (ExtHeader)) {
-      FreePool (Buffer);
       return EFI_VOLUME_CORRUPTED;
     }
 
-    if (!Ext4CheckExtentChecksum (ExtHeader, File)) {
-      DEBUG ((DEBUG_ERROR, "[ext4] Invalid extent checksum\n"));
-      FreePool (Buffer);
-      return EFI_VOLUME_CORRUPTED;
+    if (!EXT4_BLOCK_CACHE_IS_VERIFIED (CacheEntry, 0)) {
+      if (!Ext4CheckExtentChecksum (ExtHeader, File)) {
+        DEBUG ((DEBUG_ERROR, "[ext4] Invalid extent checksum\n"));
+        return EFI_VOLUME_CORRUPTED;
+      }
+
+      EXT4_BLOCK_CACHE_SET_VERIFIED (CacheEntry, 0);
     }
 
     if (ExtHeader->eh_depth != CurrentDepth) {
-      FreePool (Buffer);
       return EFI_VOLUME_CORRUPTED;
     }
   }
@@ -332,28 +325,16 @@ Ext4GetExtent (
   Ext = Ext4BinsearchExtentExt (ExtHeader, LogicalBlock);
 
   if (!Ext) {
-    if (Buffer != NULL) {
-      FreePool (Buffer);
-    }
-
     return EFI_NO_MAPPING;
   }
 
   if (!((LogicalBlock >= Ext->ee_block) && (Ext->ee_block + Ext4GetExtentLength (Ext) > LogicalBlock))) {
     // This extent does not cover the block
-    if (Buffer != NULL) {
-      FreePool (Buffer);
-    }
-
     return EFI_NO_MAPPING;
   }
 
   *Extent = *Ext;
 
-  if (Buffer != NULL) {
-    FreePool (Buffer);
-  }
-
   return EFI_SUCCESS;
 }
 
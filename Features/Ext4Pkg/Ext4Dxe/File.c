@@ -318,6 +318,15 @@ Ext4CloseInternal (
   FreePool (File->Inode);
   Ext4FreeExtentsMap (File);
   Ext4UnrefDentry (File->Dentry);
+
+  if (File->ReadAheadBuffer != NULL) {
+    FreePool (File->ReadAheadBuffer);
+  }
+
+  if (File->DirBlock != NULL) {
+    FreePool (File->DirBlock);
+  }
+
   FreePool (File);
   return EFI_SUCCESS;
 }
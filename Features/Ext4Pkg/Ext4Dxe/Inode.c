@@ -69,6 +69,202 @@ Ext4CalculateInodeChecksum (
   return Crc;
 }
 
+/**
+   A physically contiguous piece of a read: either a range of the disk, or a
+   hole (or uninitialized extent) that reads as zeroes.
+**/
+typedef struct {
+  BOOLEAN    IsHole;
+  UINT64     DiskOffset;
+  UINT64     Length;
+} EXT4_READ_RUN;
+
+/**
+   Maps a file offset to the extent (or hole) that covers it.
+
+   @param[in]      Partition     Pointer to the opened EXT4 partition.
+   @param[in]      File          Pointer to the opened file.
+   @param[in]      Offset        File offset.
+   @param[out]     Run           Pointer to the run that starts at Offset and
+                                 goes up to the end of the extent or hole.
+
+   @return Status of the mapping.
+**/
+STATIC
+EFI_STATUS
+Ext4MapReadOffset (
+  IN  EXT4_PARTITION  *Partition,
+  IN  EXT4_FILE       *File,
+  IN  UINT64          Offset,
+  OUT EXT4_READ_RUN   *Run
+  )
+{
+  EXT4_EXTENT  Extent;
+  UINT32       BlockOff;
+  EFI_STATUS   Status;
+  UINT64       ExtentStartBytes;
+  UINT64       ExtentLengthBytes;
+  UINT64       ExtentOffset;
+
+  Status = Ext4GetExtent (
+             Partition,
+             File,
+             DivU64x32Remainder (Offset, Partition->BlockSize, &BlockOff),
+             &Extent
+             );
+
+  if (Status == EFI_NO_MAPPING) {
+    Run->IsHole     = TRUE;
+    Run->DiskOffset = 0;
+    Run->Length     = Partition->BlockSize - BlockOff;
+    return EFI_SUCCESS;
+  }
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  ExtentLengthBytes = MultU64x32 (Ext4GetExtentLength (&Extent), Partition->BlockSize);
+  ExtentOffset      = Offset - MultU64x32 (Extent.ee_block, Partition->BlockSize);
+  Run->Length       = ExtentLengthBytes - ExtentOffset;
+
+  // Uninitialized extents behave exactly the same as file holes, except they have
+  // blocks already allocated to them.
+  if (EXT4_EXTENT_IS_UNINITIALIZED (&Extent)) {
+    Run->IsHole     = TRUE;
+    Run->DiskOffset = 0;
+    return EFI_SUCCESS;
+  }
+
+  ExtentStartBytes = MultU64x32 (
+                       LShiftU64 (Extent.ee_start_hi, 32) |
+                       Extent.ee_start_lo,
+                       Partition->BlockSize
+                       );
+
+  Run->IsHole     = FALSE;
+  Run->DiskOffset = ExtentStartBytes + ExtentOffset;
+  return EFI_SUCCESS;
+}
+
+/**
+   Gets the longest run of a read that can be served by a single disk read
+   (or a single SetMem, for holes), merging logically and physically
+   contiguous extents.
+
+   @param[in]      Partition     Pointer to the opened EXT4 partition.
+   @param[in]      File          Pointer to the opened file.
+   @param[in]      Offset        File offset of the read.
+   @param[in]      Length        Remaining length of the read.
+   @param[out]     Run           Pointer to the run, at most Length long.
+
+   @return Status of the mapping of the first extent. Failures while looking
+           ahead just end the run early.
+**/
+STATIC
+EFI_STATUS
+Ext4GetReadRun (
+  IN  EXT4_PARTITION  *Partition,
+  IN  EXT4_FILE       *File,
+  IN  UINT64          Offset,
+  IN  UINTN           Length,
+  OUT EXT4_READ_RUN   *Run
+  )
+{
+  EFI_STATUS     Status;
+  EXT4_READ_RUN  Next;
+
+  Status = Ext4MapReadOffset (Partition, File, Offset, Run);
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  while (Run->Length < Length) {
+    Status = Ext4MapReadOffset (Partition, File, Offset + Run->Length, &Next);
+
+    if (EFI_ERROR (Status) || (Next.IsHole != Run->IsHole)) {
+      break;
+    }
+
+    if (!Run->IsHole && (Next.DiskOffset != Run->DiskOffset + Run->Length)) {
+      break;
+    }
+
+    Run->Length += Next.Length;
+  }
+
+  if (Run->Length > Length) {
+    Run->Length = Length;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+   Reads from an EXT4 inode, without going through the readahead window.
+   The read must be inside the file.
+
+   @param[in]      Partition     Pointer to the opened EXT4 partition.
+   @param[in]      File          Pointer to the opened file.
+   @param[out]     Buffer        Pointer to the buffer.
+   @param[in]      Offset        Offset of the read.
+   @param[in]      Length        Length of the read, in bytes.
+
+   @return Status of the read operation.
+**/
+STATIC
+EFI_STATUS
+Ext4ReadRuns (
+  IN  EXT4_PARTITION  *Partition,
+  IN  EXT4_FILE       *File,
+  OUT VOID            *Buffer,
+  IN  UINT64          Offset,
+  IN  UINTN           Length
+  )
+{
+  EFI_STATUS     Status;
+  EXT4_READ_RUN  Run;
+  UINTN          WasRead;
+  EXT4_IO_BATCH  Batch;
+
+  // Runs are read through a batch, so that with DiskIo2 several of them are
+  // in flight at once.
+  Ext4InitIoBatch (Partition, &Batch);
+
+  while (Length != 0) {
+    // The algorithm here is to get the longest contiguous run starting at the
+    // current offset, and then read all of it at once.
+    Status = Ext4GetReadRun (Partition, File, Offset, Length, &Run);
+
+    if (EFI_ERROR (Status)) {
+      // Don't leave reads into the caller's buffer behind
+      Ext4WaitIoBatch (Partition, &Batch);
+      return Status;
+    }
+
+    WasRead = (UINTN)Run.Length;
+
+    if (Run.IsHole) {
+      SetMem (Buffer, WasRead, 0);
+    } else {
+      Ext4SubmitIoBatchRead (Partition, &Batch, Buffer, WasRead, Run.DiskOffset);
+    }
+
+    Length -= WasRead;
+    Buffer  = (VOID *)((CHAR8 *)Buffer + WasRead);
+    Offset += WasRead;
+  }
+
+  Status = Ext4WaitIoBatch (Partition, &Batch);
+
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "[ext4] Error %r reading inode %lu\n", Status, File->InodeNum));
+  }
+
+  return Status;
+}
+
 /**
    Reads from an EXT4 inode.
    @param[in]      Partition     Pointer to the opened EXT4 partition.
@@ -89,31 +285,16 @@ Ext4Read (
   IN OUT UINTN           *Length
   )
 {
-  EXT4_INODE   *Inode;
-  UINT64       InodeSize;
-  UINT64       CurrentSeek;
-  UINTN        RemainingRead;
-  UINTN        BeenRead;
-  UINTN        WasRead;
-  EXT4_EXTENT  Extent;
-  UINT32       BlockOff;
-  EFI_STATUS   Status;
-  BOOLEAN      HasBackingExtent;
-  UINT32       HoleOff;
-  UINTN        HoleLen;
-  UINT64       ExtentStartBytes;
-  UINT64       ExtentLengthBytes;
-  UINT64       ExtentLogicalBytes;
-
-  // Our extent offset is the difference between CurrentSeek and ExtentLogicalBytes
-  UINT64  ExtentOffset;
-  UINTN   ExtentMayRead;
+  EXT4_INODE  *Inode;
+  UINT64      InodeSize;
+  UINTN       RemainingRead;
+  UINTN       WindowLength;
+  BOOLEAN     ReadAhead;
+  EFI_STATUS  Status;
 
   Inode         = File->Inode;
   InodeSize     = EXT4_INODE_SIZE (Inode);
-  CurrentSeek   = Offset;
   RemainingRead = *Length;
-  BeenRead      = 0;
 
   DEBUG ((DEBUG_FS, "[ext4] Ext4Read(%s, Offset %lu, Length %lu)\n", File->Dentry->Name, Offset, *Length));
 
@@ -125,74 +306,52 @@ Ext4Read (
     RemainingRead = (UINTN)(InodeSize - Offset);
   }
 
-  while (RemainingRead != 0) {
-    WasRead = 0;
-
-    // The algorithm here is to get the extent corresponding to the current block
-    // and then read as much as we can from the current extent.
-
-    Status = Ext4GetExtent (
-               Partition,
-               File,
-               DivU64x32Remainder (CurrentSeek, Partition->BlockSize, &BlockOff),
-               &Extent
-               );
+  if (RemainingRead == 0) {
+    *Length = 0;
+    return EFI_SUCCESS;
+  }
 
-    if ((Status != EFI_SUCCESS) && (Status != EFI_NO_MAPPING)) {
-      return Status;
+  if ((File->ReadAheadLength != 0) && (Offset >= File->ReadAheadOffset) &&
+      (Offset + RemainingRead <= File->ReadAheadOffset + File->ReadAheadLength))
+  {
+    // Served by the readahead window
+    CopyMem (Buffer, File->ReadAheadBuffer + (UINTN)(Offset - File->ReadAheadOffset), RemainingRead);
+  } else {
+    // Small sequential reads (directory entries, or loaders reading a file
+    // in chunks) get a whole window read ahead at once.
+    ReadAhead = (Offset != 0) && (Offset == File->LastReadEnd) &&
+                (RemainingRead <= EXT4_READAHEAD_SIZE / 4);
+
+    if (ReadAhead && (File->ReadAheadBuffer == NULL)) {
+      File->ReadAheadBuffer = AllocatePool (EXT4_READAHEAD_SIZE);
+      ReadAhead             = File->ReadAheadBuffer != NULL;
     }
 
-    HasBackingExtent = Status != EFI_NO_MAPPING;
+    if (ReadAhead) {
+      WindowLength          = (UINTN)MIN (EXT4_READAHEAD_SIZE, InodeSize - Offset);
+      File->ReadAheadLength = 0;
 
-    if (!HasBackingExtent || EXT4_EXTENT_IS_UNINITIALIZED (&Extent)) {
-      HoleOff = BlockOff;
+      Status = Ext4ReadRuns (Partition, File, File->ReadAheadBuffer, Offset, WindowLength);
 
-      if (!HasBackingExtent) {
-        HoleLen = Partition->BlockSize - HoleOff;
+      if (!EFI_ERROR (Status)) {
+        File->ReadAheadOffset = Offset;
+        File->ReadAheadLength = WindowLength;
+        CopyMem (Buffer, File->ReadAheadBuffer, RemainingRead);
       } else {
-        // Uninitialized extents behave exactly the same as file holes, except they have
-        // blocks already allocated to them.
-        HoleLen = (Ext4GetExtentLength (&Extent) * Partition->BlockSize) - HoleOff;
+        // Don't fail the caller's read over something past what it asked for
+        Status = Ext4ReadRuns (Partition, File, Buffer, Offset, RemainingRead);
       }
-
-      WasRead = HoleLen > RemainingRead ? RemainingRead : HoleLen;
-      // Potential improvement: In the future, we could get the file hole's total
-      // size and memset all that
-      SetMem (Buffer, WasRead, 0);
     } else {
-      ExtentStartBytes = MultU64x32 (
-                           LShiftU64 (Extent.ee_start_hi, 32) |
-                           Extent.ee_start_lo,
-                           Partition->BlockSize
-                           );
-      ExtentLengthBytes  = Extent.ee_len * Partition->BlockSize;
-      ExtentLogicalBytes = (UINT64)Extent.ee_block * Partition->BlockSize;
-      ExtentOffset       = CurrentSeek - ExtentLogicalBytes;
-      ExtentMayRead      = (UINTN)(ExtentLengthBytes - ExtentOffset);
-
-      WasRead = ExtentMayRead > RemainingRead ? RemainingRead : ExtentMayRead;
-
-      Status = Ext4ReadDiskIo (Partition, Buffer, WasRead, ExtentStartBytes + ExtentOffset);
-
-      if (EFI_ERROR (Status)) {
-        DEBUG ((
-          DEBUG_ERROR,
-          "[ext4] Error %r reading [%lu, %lu]\n",
-          Status,
-          ExtentStartBytes + ExtentOffset,
-          ExtentStartBytes + ExtentOffset + WasRead - 1
-          ));
-        return Status;
-      }
+      Status = Ext4ReadRuns (Partition, File, Buffer, Offset, RemainingRead);
     }
 
-    RemainingRead -= WasRead;
-    Buffer         = (VOID *)((CHAR8 *)Buffer + WasRead);
-    BeenRead      += WasRead;
-    CurrentSeek   += WasRead;
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
   }
 
-  *Length = BeenRead;
+  File->LastReadEnd = Offset + RemainingRead;
+  *Length           = RemainingRead;
 
   return EFI_SUCCESS;
 }
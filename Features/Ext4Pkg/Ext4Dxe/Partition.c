@@ -36,6 +36,7 @@ Ext4OpenPartition (
   }
 
   InitializeListHead (&Part->OpenFiles);
+  Ext4BlockCacheInit (Part);
 
   Part->BlockIo = BlockIo;
   Part->DiskIo  = DiskIo;
@@ -44,6 +45,7 @@ Ext4OpenPartition (
   Status = Ext4OpenSuperblock (Part);
 
   if (EFI_ERROR (Status)) {
+    Ext4BlockCacheFlush (Part);
     FreePool (Part);
     return Status;
   }
@@ -58,6 +60,7 @@ Ext4OpenPartition (
                                       );
 
   if (EFI_ERROR (Status)) {
+    Ext4BlockCacheFlush (Part);
     FreePool (Part);
     return Status;
   }
@@ -125,6 +128,7 @@ Ext4UnmountAndFreePartition (
     DEBUG ((DEBUG_ERROR, "[ext4] Failed to delete root dentry - resource leak present.\n"));
   }
 
+  Ext4BlockCacheFlush (Partition);
   FreePool (Partition->BlockGroups);
   FreePool (Partition);
 
@@ -340,7 +340,7 @@ Ext4CalculateChecksum (
   switch (Partition->SuperBlock.s_checksum_type) {
     case EXT4_CHECKSUM_CRC32C:
       // For some reason, EXT4 really likes non-inverted CRC32C checksums, so we stick to that here.
-      return ~CalculateCrc32c(Buffer, Length, ~InitialValue);
+      return Ext4CalculateCrc32c (InitialValue, Buffer, Length);
     default:
       UNREACHABLE ();
       return 0;
@@ -0,0 +1,349 @@
+/** @file
+  Host based unit tests for the ext4 CRC32C and CRC16 routines
+
+  Copyright (c) 2021 Pedro Falcato All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include "../Ext4Dxe.h"
+
+#include <Library/UnitTestLib.h>
+
+#if defined (MDE_CPU_X64)
+  #if defined (_MSC_VER)
+#include <intrin.h>
+  #else
+#include <cpuid.h>
+  #endif
+#endif
+
+#define UNIT_TEST_NAME     "Ext4 CRC Unit Tests"
+#define UNIT_TEST_VERSION  "1.0"
+
+//
+// Large enough for every offset and length combination below
+//
+#define TEST_BUFFER_SIZE  4200
+
+STATIC CONST CHAR8  mCheckString[] = "123456789";
+
+//
+// Block group 0 and 1 descriptors of a 64 MiB gdt_csum (uninit_bg, no 64bit)
+// filesystem made by mkfs.ext4 -b 4096 -g 8192, and its UUID. dumpe2fs
+// reports their checksums as 0xbbbe and 0xa753.
+//
+STATIC CONST UINT8  mGdtCsumUuid[16] = {
+  0x5b, 0x1d, 0x3c, 0x4e, 0x9a, 0x8f, 0x4e, 0x2b,
+  0xb7, 0xc6, 0x1d, 0x2e, 0x3f, 0x40, 0x51, 0x62
+};
+
+STATIC CONST UINT8  mGdtCsumDesc[2][EXT4_OLD_BLOCK_DESC_SIZE] = {
+  {
+    0x11, 0x00, 0x00, 0x00, 0x13, 0x00, 0x00, 0x00,
+    0x15, 0x00, 0x00, 0x00, 0xe5, 0x1b, 0xf5, 0x1f,
+    0x02, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xf5, 0x1f, 0xbe, 0xbb
+  },
+  {
+    0x12, 0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00,
+    0x15, 0x02, 0x00, 0x00, 0xef, 0x1b, 0x00, 0x20,
+    0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x53, 0xa7
+  }
+};
+
+STATIC CONST UINT16  mGdtCsumExpected[2] = { 0xbbbe, 0xa753 };
+
+/**
+   Checks if the host CPU implements the CRC32C instructions used by
+   Ext4Crc32cHw. The host BaseLib doesn't execute CPUID, so ask the compiler.
+
+   @return TRUE if Ext4Crc32cHw can be called, else FALSE.
+**/
+STATIC
+BOOLEAN
+HostHasCrc32cInstructions (
+  VOID
+  )
+{
+ #if defined (MDE_CPU_X64)
+  #if defined (_MSC_VER)
+  INT32  Info[4];
+
+  __cpuid (Info, 1);
+  return (Info[2] & BIT20) != 0;
+  #else
+  UINT32  Eax;
+  UINT32  Ebx;
+  UINT32  Ecx;
+  UINT32  Edx;
+
+  if (__get_cpuid (1, &Eax, &Ebx, &Ecx, &Edx) == 0) {
+    return FALSE;
+  }
+
+  return (Ecx & BIT20) != 0;
+  #endif
+ #else
+  return FALSE;
+ #endif
+}
+
+/**
+   Fills a buffer with a repeatable pseudo-random pattern.
+
+   @param[out] Buffer         Pointer to the buffer.
+   @param[in]  Length         Length of the buffer, in bytes.
+**/
+STATIC
+VOID
+FillPattern (
+  OUT UINT8  *Buffer,
+  IN  UINTN  Length
+  )
+{
+  UINT32  Seed;
+  UINTN   Index;
+
+  Seed = 0x12345678;
+  for (Index = 0; Index < Length; Index++) {
+    Seed          = Seed * 1103515245 + 12345;
+    Buffer[Index] = (UINT8)(Seed >> 16);
+  }
+}
+
+/**
+   Builds the CRC tables once for every test.
+
+   @param[in]  Context        Unused.
+
+   @retval UNIT_TEST_PASSED   Always.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+InitialiseCrc (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  Ext4InitialiseCrc ();
+  return UNIT_TEST_PASSED;
+}
+
+/**
+   Checks the table CRC32C, and Ext4CalculateCrc32c, against known vectors.
+
+   @param[in]  Context        Unused.
+
+   @retval UNIT_TEST_PASSED   The CRCs matched.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+Crc32cKnownVectors (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8  Buffer[32];
+  UINTN  Index;
+
+  UT_ASSERT_EQUAL (Ext4CalculateCrc32cTable (~0U, mCheckString, AsciiStrLen (mCheckString)) ^ ~0U, 0xE3069283);
+  UT_ASSERT_EQUAL (Ext4CalculateCrc32c (~0U, mCheckString, AsciiStrLen (mCheckString)) ^ ~0U, 0xE3069283);
+
+  //
+  // RFC 3720 (iSCSI) B.4 vectors
+  //
+  SetMem (Buffer, sizeof (Buffer), 0x00);
+  UT_ASSERT_EQUAL (Ext4CalculateCrc32cTable (~0U, Buffer, sizeof (Buffer)) ^ ~0U, 0x8A9136AA);
+  SetMem (Buffer, sizeof (Buffer), 0xFF);
+  UT_ASSERT_EQUAL (Ext4CalculateCrc32cTable (~0U, Buffer, sizeof (Buffer)) ^ ~0U, 0x62A8AB43);
+  for (Index = 0; Index < sizeof (Buffer); Index++) {
+    Buffer[Index] = (UINT8)Index;
+  }
+
+  UT_ASSERT_EQUAL (Ext4CalculateCrc32cTable (~0U, Buffer, sizeof (Buffer)) ^ ~0U, 0x46DD794E);
+
+  //
+  // Chaining must give the same result as one call
+  //
+  UT_ASSERT_EQUAL (
+    Ext4CalculateCrc32cTable (Ext4CalculateCrc32cTable (~0U, Buffer, 13), Buffer + 13, sizeof (Buffer) - 13),
+    Ext4CalculateCrc32cTable (~0U, Buffer, sizeof (Buffer))
+    );
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+   Checks Ext4Crc32cHw against the table on unaligned, odd-length buffers.
+
+   @param[in]  Context        Unused.
+
+   @retval UNIT_TEST_PASSED   Both paths agreed.
+   @retval UNIT_TEST_SKIPPED  The host CPU lacks the CRC32C instructions.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+Crc32cHwMatchesTable (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+ #if defined (MDE_CPU_X64) || defined (MDE_CPU_AARCH64)
+  STATIC CONST UINTN  Lengths[] = {
+    0, 1, 2, 3, 5, 7, 8, 9, 15, 16, 17, 31, 63, 64, 65, 255, 1021, 4093, 4096
+  };
+  UINT8               *Buffer;
+  UINTN               Offset;
+  UINTN               Index;
+  UINT32              Seed;
+
+  if (!HostHasCrc32cInstructions ()) {
+    return UNIT_TEST_SKIPPED;
+  }
+
+  Buffer = AllocatePool (TEST_BUFFER_SIZE);
+  UT_ASSERT_NOT_NULL (Buffer);
+  FillPattern (Buffer, TEST_BUFFER_SIZE);
+
+  UT_ASSERT_EQUAL (Ext4Crc32cHw (~0U, mCheckString, AsciiStrLen (mCheckString)) ^ ~0U, 0xE3069283);
+
+  for (Offset = 0; Offset < 8; Offset++) {
+    for (Index = 0; Index < ARRAY_SIZE (Lengths); Index++) {
+      for (Seed = 0; Seed < 2; Seed++) {
+        UT_ASSERT_EQUAL (
+          Ext4Crc32cHw (Seed == 0 ? ~0U : 0x5A5AA5A5, Buffer + Offset, Lengths[Index]),
+          Ext4CalculateCrc32cTable (Seed == 0 ? ~0U : 0x5A5AA5A5, Buffer + Offset, Lengths[Index])
+          );
+      }
+    }
+  }
+
+  FreePool (Buffer);
+  return UNIT_TEST_PASSED;
+ #else
+  return UNIT_TEST_SKIPPED;
+ #endif
+}
+
+/**
+   Checks the CRC16 against known vectors.
+
+   @param[in]  Context        Unused.
+
+   @retval UNIT_TEST_PASSED   The CRCs matched.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+Crc16KnownVectors (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  //
+  // CRC-16/ARC, and CRC-16/MODBUS which starts at ~0 like gdt_csum
+  //
+  UT_ASSERT_EQUAL (Ext4CalculateCrc16 (0, mCheckString, AsciiStrLen (mCheckString)), 0xBB3D);
+  UT_ASSERT_EQUAL (Ext4CalculateCrc16 (0xFFFF, mCheckString, AsciiStrLen (mCheckString)), 0x4B37);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+   Checks the gdt_csum group descriptor checksum, computed the way
+   Ext4CalculateBlockGroupDescChecksumGdtCsum does, against mkfs.ext4.
+
+   @param[in]  Context        Unused.
+
+   @retval UNIT_TEST_PASSED   The checksums matched.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+GdtCsumKnownDescriptors (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CONST EXT4_BLOCK_GROUP_DESC  *Desc;
+  UINT32                       BlockGroupNum;
+  UINT16                       Csum;
+
+  for (BlockGroupNum = 0; BlockGroupNum < ARRAY_SIZE (mGdtCsumDesc); BlockGroupNum++) {
+    Desc = (CONST EXT4_BLOCK_GROUP_DESC *)mGdtCsumDesc[BlockGroupNum];
+    UT_ASSERT_EQUAL (Desc->bg_checksum, mGdtCsumExpected[BlockGroupNum]);
+
+    Csum = Ext4CalculateCrc16 (0xFFFF, mGdtCsumUuid, sizeof (mGdtCsumUuid));
+    Csum = Ext4CalculateCrc16 (Csum, &BlockGroupNum, sizeof (BlockGroupNum));
+    Csum = Ext4CalculateCrc16 (Csum, Desc, OFFSET_OF (EXT4_BLOCK_GROUP_DESC, bg_checksum));
+    Csum = Ext4CalculateCrc16 (
+             Csum,
+             &Desc->bg_block_bitmap_hi,
+             EXT4_OLD_BLOCK_DESC_SIZE - OFFSET_OF (EXT4_BLOCK_GROUP_DESC, bg_block_bitmap_hi)
+             );
+    UT_ASSERT_EQUAL (Csum, mGdtCsumExpected[BlockGroupNum]);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+   Initializes the unit test framework, suite, and unit tests and runs them.
+
+   @retval  EFI_SUCCESS           All test cases were dispatched.
+   @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                  initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      CrcTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto Exit;
+  }
+
+  Status = CreateUnitTestSuite (&CrcTests, Framework, "Ext4 CRC32C and CRC16", "Ext4Pkg.Ext4Dxe.Crc", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for CrcTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+
+  AddTestCase (CrcTests, "CRC32C known vectors", "Crc32cKnownVectors", Crc32cKnownVectors, InitialiseCrc, NULL, NULL);
+  AddTestCase (CrcTests, "CRC32C instructions match the table", "Crc32cHwMatchesTable", Crc32cHwMatchesTable, InitialiseCrc, NULL, NULL);
+  AddTestCase (CrcTests, "CRC16 known vectors", "Crc16KnownVectors", Crc16KnownVectors, InitialiseCrc, NULL, NULL);
+  AddTestCase (CrcTests, "gdt_csum of mkfs.ext4 descriptors", "GdtCsumKnownDescriptors", GdtCsumKnownDescriptors, InitialiseCrc, NULL, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+Exit:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -10,6 +10,7 @@
 #include <Library/IoLib.h>
 #include <Library/PcdLib.h>
 #include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
 #include <Library/UefiRuntimeServicesTableLib.h>
 #include <Library/ArmSmcLib.h>
 #include <Library/ParameterTable.h>
@@ -57,8 +58,14 @@ MacReadHwaddr (
 }
 
 /**
+  Persist the DDR training information handed over by PEI into SPI flash so
+  that the next boot can skip full training.
 
+  The flash block is only erased and rewritten when its content differs from
+  the current training data.
 
+  @retval    EFI_SUCCESS     The training information is stored in flash.
+  @retval    EFI_NOT_FOUND   No flash protocol, no training HOB or no memory.
 **/
 EFI_STATUS
 StoreDdrTrainInfo (
@@ -70,7 +77,10 @@ StoreDdrTrainInfo (
   UINT64                    *Temp;
   UINT64                    DdrInfoAddr;
   UINT8                     *DdrInfo;
+  UINT8                     *FlashInfo;
   UINT64                    DdrInfoFlashAddr;
+  UINTN                     DdrInfoPages;
+  UINT32                    DdrInfoLength;
   EFI_STATUS                Status;
   EFI_NORFLASH_DRV_PROTOCOL *FlashHandle;
 
@@ -90,16 +100,28 @@ StoreDdrTrainInfo (
     CopyMem (&DdrInfoAddr, Temp, 8);
     DdrInfoSize = MmioRead64 (DdrInfoAddr);
     DEBUG ((DEBUG_ERROR,"DdrInfoAddr : %x, DdrInfoSize : %x\n", DdrInfoAddr, DdrInfoSize));
-    DdrInfo = AllocatePages ((DdrInfoSize + 4) / 4096 + 1);
+    DdrInfoPages = (UINTN)((DdrInfoSize + 4) / 4096 + 1);
+    DdrInfoLength = (UINT32)(DdrInfoSize + 4 + 8);
+    DdrInfo = AllocatePages (2 * DdrInfoPages);
     if (DdrInfo == NULL) {
       DEBUG ((DEBUG_ERROR, "DdrInfo allcate failed!\n"));
       return EFI_NOT_FOUND;
     }
+    FlashInfo = DdrInfo + EFI_PAGES_TO_SIZE (DdrInfoPages);
     SetMem32 (DdrInfo, 4, DDR_TRAIN_INFO_CHECK);
     CopyMem (DdrInfo +4, (VOID*)DdrInfoAddr, DdrInfoSize + 8);
-    FlashHandle->Erase (DdrInfoFlashAddr, SIZE_64KB);
-    FlashHandle->Write (DdrInfoFlashAddr, DdrInfo, DdrInfoSize + 4 + 8);
-    FreePages (DdrInfo, (DdrInfoSize + 4) / 4096 + 1);
+    //
+    // Skip the 64KB erase and rewrite when flash already holds this data.
+    //
+    Status = FlashHandle->Read (DdrInfoFlashAddr, FlashInfo, DdrInfoLength);
+    if (EFI_ERROR (Status) ||
+        (CompareMem (DdrInfo, FlashInfo, DdrInfoLength) != 0)) {
+      FlashHandle->Erase (DdrInfoFlashAddr, SIZE_64KB);
+      FlashHandle->Write (DdrInfoFlashAddr, DdrInfo, DdrInfoLength);
+    } else {
+      DEBUG ((DEBUG_INFO, "Ddr Info unchanged, skip flash update\n"));
+    }
+    FreePages (DdrInfo, 2 * DdrInfoPages);
     DEBUG ((DEBUG_INFO, "%a(), %d\n", __FUNCTION__, __LINE__));
     return EFI_SUCCESS;
   }
@@ -109,104 +131,168 @@ StoreDdrTrainInfo (
   }
 }
 
+/**
+  ReadyToBoot callback that persists the DDR training information.
+
+  @param[in]  Event    Event whose notification function is being invoked.
+  @param[in]  Context  Pointer to the notification function's context.
+**/
+STATIC
+VOID
+EFIAPI
+StoreDdrTrainInfoOnReadyToBoot (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  gBS->CloseEvent (Event);
+  StoreDdrTrainInfo ();
+}
 
 /**
-  Register non-discovery device with devicepath.
+  Check whether the resource initialization of a device class is deferred.
 
-  @param[in]  TypeGuid    Device Guid.
-  @param[in]  Desc        Device description.
-  @param[in]  DevicePath  Device Path.
-  @param[out] Handle      Handle after register
+  @param[in]  Policy    PLATFORM_DEVICE_INIT_* bit of the device class.
 
-  @retval     EFI_OUT_OF_RESOURCES
-              EFI_SUCCESS
+  @retval     TRUE      Deferred until the device is started or ReadyToBoot.
+  @retval     FALSE     Done while registering the device.
+**/
+STATIC
+BOOLEAN
+IsDeviceInitDeferred (
+  IN UINT32  Policy
+  )
+{
+  return (BOOLEAN)((PcdGet32 (PcdPhytiumDeviceDeferredInitMask) & Policy) != 0);
+}
+
+/**
+  Initialize the resources of a registered non-discovery device.
+
+  This is installed as NON_DISCOVERABLE_DEVICE.Initialize, so the driver that
+  binds the device calls it from its Start() function. It allocates the share
+  memory page on first use, hands it to the device specific setup routine and
+  publishes it in the resource descriptor list. Later calls do nothing.
+
+  @param[in]  This    A pointer to NON_DISCOVERABLE_DEVICE.
+
+  @retval     EFI_SUCCESS
+              EFI_OUT_OF_RESOURCES
 **/
 STATIC
 EFI_STATUS
-RegisterDevice (
-  IN  EFI_GUID                            *TypeGuid,
-  IN  EFI_ACPI_ADDRESS_SPACE_DESCRIPTOR   *Desc,
-  IN  HII_VENDOR_DEVICE_PATH              *DevicePath,
-  OUT EFI_HANDLE                          *Handle
+EFIAPI
+PlatformDeviceInitialize (
+  IN NON_DISCOVERABLE_DEVICE  *This
   )
 {
-  NON_DISCOVERABLE_DEVICE             *Device;
-  EFI_STATUS                          Status;
+  PLATFORM_DEVICE       *Private;
+  EFI_PHYSICAL_ADDRESS  Address;
+  EFI_STATUS            Status;
 
-  Device = (NON_DISCOVERABLE_DEVICE *)AllocateZeroPool (sizeof (*Device));
-  if (Device == NULL) {
-    return EFI_OUT_OF_RESOURCES;
+  Private = PLATFORM_DEVICE_FROM_THIS (This);
+  if (Private->Initialized) {
+    return EFI_SUCCESS;
   }
 
-  Device->Type = TypeGuid;
-  Device->DmaType = NonDiscoverableDeviceDmaTypeNonCoherent;
-  Device->Resources = Desc;
-
-  Status = gBS->InstallMultipleProtocolInterfaces (
-                  Handle,
-                  &gEdkiiNonDiscoverableDeviceProtocolGuid,
-                  Device,
-                  &gEfiDevicePathProtocolGuid,
-                  DevicePath,
-                  NULL
-                  );
-  if (EFI_ERROR (Status)) {
-    goto FreeDevice;
+  if (Private->ResourceInit != NULL) {
+    Status = gBS->AllocatePages (
+                    AllocateAnyPages,
+                    EfiBootServicesData,
+                    1,
+                    &Address
+                    );
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+    DEBUG ((DEBUG_INFO, "Share Memory Address : %llx\n", Address));
+    Private->ResourceInit (Address, Private->Context);
+    This->Resources[Private->ShareMemIndex].AddrRangeMin = Address;
+    This->Resources[Private->ShareMemIndex].AddrRangeMax = Address + 4096;
   }
-  return EFI_SUCCESS;
-
-FreeDevice:
-  FreePool (Device);
 
-  return Status;
+  Private->Initialized = TRUE;
+  return EFI_SUCCESS;
 }
 
 /**
-  Register non-discovery device without devicepath.
+  Register non-discovery device.
 
-  @param[in]  TypeGuid    Device Guid.
-  @param[in]  Desc        Device description.
-  @param[out] Handle      Handle after register
+  @param[in]  TypeGuid       Device Guid.
+  @param[in]  Desc           Device description.
+  @param[in]  DevicePath     Device Path, NULL if the device has none.
+  @param[in]  ResourceInit   Share memory setup routine, or NULL.
+  @param[in]  ShareMemIndex  Index of the share memory entry in Desc.
+  @param[in]  Context        Context passed to ResourceInit.
+  @param[in]  Policy         PLATFORM_DEVICE_INIT_* bit of the device class.
+  @param[out] Handle         Handle after register
 
   @retval     EFI_OUT_OF_RESOURCES
               EFI_SUCCESS
 **/
 STATIC
 EFI_STATUS
-RegisterNoDevicepath (
+RegisterDevice (
   IN  EFI_GUID                            *TypeGuid,
   IN  EFI_ACPI_ADDRESS_SPACE_DESCRIPTOR   *Desc,
+  IN  HII_VENDOR_DEVICE_PATH              *DevicePath,   OPTIONAL
+  IN  PLATFORM_DEVICE_RESOURCE_INIT       ResourceInit,  OPTIONAL
+  IN  UINTN                               ShareMemIndex,
+  IN  UINTN                               Context,
+  IN  UINT32                              Policy,
   OUT EFI_HANDLE                          *Handle
   )
 {
-  NON_DISCOVERABLE_DEVICE             *Device;
+  PLATFORM_DEVICE                     *Private;
   EFI_STATUS                          Status;
 
-  Device = (NON_DISCOVERABLE_DEVICE *)AllocateZeroPool (sizeof (*Device));
-  if (Device == NULL) {
+  Private = (PLATFORM_DEVICE *)AllocateZeroPool (sizeof (*Private));
+  if (Private == NULL) {
     return EFI_OUT_OF_RESOURCES;
   }
 
-  Device->Type = TypeGuid;
-  Device->DmaType = NonDiscoverableDeviceDmaTypeNonCoherent;
-  Device->Resources = Desc;
+  Private->Signature = PLATFORM_DEVICE_SIGNATURE;
+  Private->ResourceInit = ResourceInit;
+  Private->ShareMemIndex = ShareMemIndex;
+  Private->Context = Context;
+  Private->Device.Type = TypeGuid;
+  Private->Device.DmaType = NonDiscoverableDeviceDmaTypeNonCoherent;
+  Private->Device.Resources = Desc;
+  Private->Device.Initialize = PlatformDeviceInitialize;
+
+  if (!IsDeviceInitDeferred (Policy)) {
+    Status = PlatformDeviceInitialize (&Private->Device);
+    if (EFI_ERROR (Status)) {
+      goto FreeDevice;
+    }
+  }
 
-  Status = gBS->InstallMultipleProtocolInterfaces (
-                  Handle,
-                  &gEdkiiNonDiscoverableDeviceProtocolGuid,
-                  Device,
-                  NULL
-                  );
+  if (DevicePath != NULL) {
+    Status = gBS->InstallMultipleProtocolInterfaces (
+                    Handle,
+                    &gEdkiiNonDiscoverableDeviceProtocolGuid,
+                    &Private->Device,
+                    &gEfiDevicePathProtocolGuid,
+                    DevicePath,
+                    NULL
+                    );
+  } else {
+    Status = gBS->InstallMultipleProtocolInterfaces (
+                    Handle,
+                    &gEdkiiNonDiscoverableDeviceProtocolGuid,
+                    &Private->Device,
+                    NULL
+                    );
+  }
   if (EFI_ERROR (Status)) {
     goto FreeDevice;
   }
   return EFI_SUCCESS;
 
 FreeDevice:
-  FreePool (Device);
+  FreePool (Private);
 
   return Status;
-
 }
 
 /**
@@ -263,73 +349,134 @@ ConfigGmuSharedMem (
               Mac->Addr[4], Mac->Addr[5]));
 }
 
+/**
+  Gmu share memory setup, the deferred part of Gmu registration.
+
+  @param[in]  Addr       Share memory address.
+  @param[in]  Gmu        Gmu controller index, 0 - 3.
+
+  @retval     Null
+**/
+STATIC
+VOID
+GmuShareMemInit (
+  IN EFI_PHYSICAL_ADDRESS  Addr,
+  IN UINTN                 Gmu
+  )
+{
+  EFI_MAC_ADDRESS       MacAddr;
+  UINT32                Index;
+  UINT8                 *Mac;
+  UINT32                MacTemp;
+  UINTN                 Base;
+
+  switch (Gmu) {
+  case 0:
+    Base = GMAC0_BASE_ADDR;
+    Mac = PcdGetPtr (PcdPhytiumGmu0Mac);
+    break;
+  case 1:
+    Base = GMAC1_BASE_ADDR;
+    Mac = PcdGetPtr (PcdPhytiumGmu1Mac);
+    break;
+  case 2:
+    Base = GMAC2_BASE_ADDR;
+    Mac = PcdGetPtr (PcdPhytiumGmu2Mac);
+    break;
+  default:
+    Base = GMAC3_BASE_ADDR;
+    Mac = PcdGetPtr (PcdPhytiumGmu3Mac);
+    break;
+  }
+
+  MacReadHwaddr (Base, &MacAddr);
+  MacTemp = MmioRead32(Base + GMU_SA1B);
+  if(0 == MacTemp)
+  {
+    for (Index = 0; Index < 6; Index++) {
+      MacAddr.Addr[Index] = Mac[Index];
+    }
+  }
+  else
+  {
+    for (Index = 0; Index < 6; Index++) {
+      MacAddr.Addr[Index] = MmioRead8((Base + GMU_SA1B) + Index);
+      if(Index > 3)
+        MacAddr.Addr[Index] = MmioRead8((Base + GMU_SA1T) + (Index-4));
+    }
+  }
+
+  switch (Gmu) {
+  case 0:
+    ConfigGmuSharedMem (
+      Addr,
+      PcdGet32 (PcdPhytiumGmu0Interface),
+      PcdGet32 (PcdPhytiumGmu0Autoeng),
+      PcdGet32 (PcdPhytiumGmu0Speed),
+      PcdGet32 (PcdPhytiumGmu0Duplex),
+      &MacAddr);
+    break;
+  case 1:
+    ConfigGmuSharedMem (
+      Addr,
+      PcdGet32 (PcdPhytiumGmu1Interface),
+      PcdGet32 (PcdPhytiumGmu1Autoeng),
+      PcdGet32 (PcdPhytiumGmu1Speed),
+      PcdGet32 (PcdPhytiumGmu1Duplex),
+      &MacAddr);
+    break;
+  case 2:
+    ConfigGmuSharedMem (
+      Addr,
+      PcdGet32 (PcdPhytiumGmu2Interface),
+      PcdGet32 (PcdPhytiumGmu2Autoeng),
+      PcdGet32 (PcdPhytiumGmu2Speed),
+      PcdGet32 (PcdPhytiumGmu2Duplex),
+      &MacAddr);
+    break;
+  default:
+    ConfigGmuSharedMem (
+      Addr,
+      PcdGet32 (PcdPhytiumGmu3Interface),
+      PcdGet32 (PcdPhytiumGmu3Autoeng),
+      PcdGet32 (PcdPhytiumGmu3Speed),
+      PcdGet32 (PcdPhytiumGmu3Duplex),
+      &MacAddr);
+    break;
+  }
+}
+
 /*
   Gmu device regist.
 
+  @param[in]  BoardConfig  A pointer to the board parameter table.
+
   @retval    Null.
 **/
 VOID
 GmuRegister (
-  VOID
+  IN BOARD_CONFIG  *BoardConfig
   )
 {
   EFI_HANDLE            Handle;
   EFI_STATUS            Status;
-  EFI_PHYSICAL_ADDRESS  Address[4];
-  EFI_MAC_ADDRESS       MacAddr;
   UINT8                 PhyMode;
-  UINT8                 Buffer[1024];
-  BOARD_CONFIG          *BoardConfig;
-  UINT32                Index;
-  UINT8                 *Mac;
-  UINT32                MacTemp;
 
-  Status = EFI_NOT_FOUND;
-  GetParameterInfo (PM_BOARD, Buffer, sizeof(Buffer));
-  BoardConfig = (BOARD_CONFIG *)Buffer;
   //
   //Mac 0
   //
   PhyMode = (BoardConfig->PhySelMode >> (2 * 2)) & 0x3;
   if ((PhyMode == 0) && (PcdGetBool (PcdPhytiumGmu0Enable))) {
     DEBUG ((DEBUG_INFO, "Gmu 0 Existed.\n"));
-    Status = gBS->AllocatePages (
-                    AllocateAnyPages,
-                    EfiBootServicesData,
-                    1,
-                    &Address[0]
-                    );
-    DEBUG ((DEBUG_INFO, "Share Memory Address : %llx\n", Address[0]));
-    MacReadHwaddr (GMAC0_BASE_ADDR, &MacAddr);
-    MacTemp = MmioRead32(GMAC0_BASE_ADDR + GMU_SA1B);
-    if(0 == MacTemp)
-    {
-      Mac = PcdGetPtr (PcdPhytiumGmu0Mac);
-      for (Index = 0; Index < 6; Index++) {
-        MacAddr.Addr[Index] = Mac[Index];
-      }
-    }
-    else
-    {
-      for (Index = 0; Index < 6; Index++) {
-        MacAddr.Addr[Index] = MmioRead8((GMAC0_BASE_ADDR + GMU_SA1B) + Index);
-        if(Index > 3)
-          MacAddr.Addr[Index] = MmioRead8((GMAC0_BASE_ADDR + GMU_SA1T) + (Index-4));
-      }
-    }
-    ConfigGmuSharedMem (
-      Address[0],
-      PcdGet32 (PcdPhytiumGmu0Interface),
-      PcdGet32 (PcdPhytiumGmu0Autoeng),
-      PcdGet32 (PcdPhytiumGmu0Speed),
-      PcdGet32 (PcdPhytiumGmu0Duplex),
-      &MacAddr);
-    mGmu0Desc[1].AddrRangeMin = Address[0];
-    mGmu0Desc[1].AddrRangeMax = Address[0] + 4096;
     Handle = NULL;
-    Status = RegisterNoDevicepath (
+    Status = RegisterDevice (
                &gGmuNonDiscoverableDeviceGuid,
                mGmu0Desc,
+               NULL,
+               GmuShareMemInit,
+               1,
+               0,
+               PLATFORM_DEVICE_INIT_GMU,
                &Handle);
     ASSERT_EFI_ERROR (Status);
   }
@@ -339,43 +486,15 @@ GmuRegister (
   PhyMode = (BoardConfig->PhySelMode >> (3 * 2)) & 0x3;
   if ((PhyMode == 0) && (PcdGetBool (PcdPhytiumGmu1Enable))) {
     DEBUG ((DEBUG_INFO, "Gmu 1 Existed.\n"));
-    Status = gBS->AllocatePages (
-                    AllocateAnyPages,
-                    EfiBootServicesData,
-                    1,
-                    &Address[1]
-                    );
-    DEBUG ((DEBUG_INFO, "Share Memory Address : %llx\n", Address[1]));
-    MacReadHwaddr (GMAC1_BASE_ADDR, &MacAddr);
-    MacTemp = MmioRead32(GMAC1_BASE_ADDR + GMU_SA1B);
-    if(0 == MacTemp)
-    {
-      Mac = PcdGetPtr (PcdPhytiumGmu1Mac);
-      for (Index = 0; Index < 6; Index++) {
-        MacAddr.Addr[Index] = Mac[Index];
-      }
-    }
-    else
-    {
-      for (Index = 0; Index < 6; Index++) {
-        MacAddr.Addr[Index] = MmioRead8((GMAC1_BASE_ADDR + GMU_SA1B) + Index);
-        if(Index > 3)
-          MacAddr.Addr[Index] = MmioRead8((GMAC1_BASE_ADDR + GMU_SA1T) + (Index-4));
-      }
-    }
-    ConfigGmuSharedMem (
-      Address[1],
-      PcdGet32 (PcdPhytiumGmu1Interface),
-      PcdGet32 (PcdPhytiumGmu1Autoeng),
-      PcdGet32 (PcdPhytiumGmu1Speed),
-      PcdGet32 (PcdPhytiumGmu1Duplex),
-      &MacAddr);
-    mGmu1Desc[1].AddrRangeMin = Address[1];
-    mGmu1Desc[1].AddrRangeMax = Address[1] + 4096;
     Handle = NULL;
-    Status = RegisterNoDevicepath (
+    Status = RegisterDevice (
                &gGmuNonDiscoverableDeviceGuid,
                mGmu1Desc,
+               NULL,
+               GmuShareMemInit,
+               1,
+               1,
+               PLATFORM_DEVICE_INIT_GMU,
                &Handle);
     ASSERT_EFI_ERROR (Status);
   }
@@ -384,43 +503,15 @@ GmuRegister (
   //
   if (PcdGetBool (PcdPhytiumGmu2Enable)) {
     DEBUG ((DEBUG_INFO, "Gmu 2 Existed.\n"));
-    Status = gBS->AllocatePages (
-                    AllocateAnyPages,
-                    EfiBootServicesData,
-                    1,
-                    &Address[2]
-                    );
-    DEBUG ((DEBUG_INFO, "Share Memory Address : %llx\n", Address[2]));
-    MacReadHwaddr (GMAC2_BASE_ADDR, &MacAddr);
-    MacTemp = MmioRead32(GMAC2_BASE_ADDR + GMU_SA1B);
-    if(0 == MacTemp)
-    {
-      Mac = PcdGetPtr (PcdPhytiumGmu2Mac);
-      for (Index = 0; Index < 6; Index++) {
-        MacAddr.Addr[Index] = Mac[Index];
-      }
-    }
-    else
-    {
-      for (Index = 0; Index < 6; Index++) {
-        MacAddr.Addr[Index] = MmioRead8((GMAC2_BASE_ADDR + GMU_SA1B) + Index);
-        if(Index > 3)
-          MacAddr.Addr[Index] = MmioRead8((GMAC2_BASE_ADDR + GMU_SA1T) + (Index-4));
-      }
-    }
-    ConfigGmuSharedMem (
-      Address[2],
-      PcdGet32 (PcdPhytiumGmu2Interface),
-      PcdGet32 (PcdPhytiumGmu2Autoeng),
-      PcdGet32 (PcdPhytiumGmu2Speed),
-      PcdGet32 (PcdPhytiumGmu2Duplex),
-      &MacAddr);
-    mGmu2Desc[1].AddrRangeMin = Address[2];
-    mGmu2Desc[1].AddrRangeMax = Address[2] + 4096;
     Handle = NULL;
-    Status = RegisterNoDevicepath (
+    Status = RegisterDevice (
                &gGmuNonDiscoverableDeviceGuid,
                mGmu2Desc,
+               NULL,
+               GmuShareMemInit,
+               1,
+               2,
+               PLATFORM_DEVICE_INIT_GMU,
                &Handle);
     ASSERT_EFI_ERROR (Status);
   }
@@ -429,43 +520,15 @@ GmuRegister (
   //
   if (PcdGetBool (PcdPhytiumGmu3Enable)) {
     DEBUG ((DEBUG_INFO, "Gmu 3 Existed.\n"));
-    Status = gBS->AllocatePages (
-                    AllocateAnyPages,
-                    EfiBootServicesData,
-                    1,
-                    &Address[3]
-                    );
-    DEBUG ((DEBUG_INFO, "Share Memory Address : %llx\n", Address[3]));
-    MacReadHwaddr (GMAC3_BASE_ADDR, &MacAddr);
-    MacTemp = MmioRead32(GMAC3_BASE_ADDR + GMU_SA1B);
-    if(0 == MacTemp)
-    {
-      Mac = PcdGetPtr (PcdPhytiumGmu3Mac);
-      for (Index = 0; Index < 6; Index++) {
-        MacAddr.Addr[Index] = Mac[Index];
-      }
-    }
-    else
-    {
-      for (Index = 0; Index < 6; Index++) {
-        MacAddr.Addr[Index] = MmioRead8((GMAC3_BASE_ADDR + GMU_SA1B) + Index);
-        if(Index > 3)
-          MacAddr.Addr[Index] = MmioRead8((GMAC3_BASE_ADDR + GMU_SA1T) + (Index-4));
-      }
-    }
-    ConfigGmuSharedMem (
-      Address[3],
-      PcdGet32 (PcdPhytiumGmu3Interface),
-      PcdGet32 (PcdPhytiumGmu3Autoeng),
-      PcdGet32 (PcdPhytiumGmu3Speed),
-      PcdGet32 (PcdPhytiumGmu3Duplex),
-      &MacAddr);
-    mGmu3Desc[1].AddrRangeMin = Address[3];
-    mGmu3Desc[1].AddrRangeMax = Address[3] + 4096;
     Handle = NULL;
-    Status = RegisterNoDevicepath (
+    Status = RegisterDevice (
                &gGmuNonDiscoverableDeviceGuid,
                mGmu3Desc,
+               NULL,
+               GmuShareMemInit,
+               1,
+               3,
+               PLATFORM_DEVICE_INIT_GMU,
                &Handle);
     ASSERT_EFI_ERROR (Status);
   }
@@ -526,38 +589,53 @@ ConfigDpSharedMem (
   MmioWrite32 (Addr, 0);
 }
 
+/**
+  Dcdp share memory setup, the deferred part of dcdp registration.
+
+  @param[in]  Addr       Share memory address.
+  @param[in]  DpUsed     Dp Used bit mask
+
+  @retval     Null
+**/
+STATIC
+VOID
+DcDpShareMemInit (
+  IN EFI_PHYSICAL_ADDRESS  Addr,
+  IN UINTN                 DpUsed
+  )
+{
+  ConfigDpSharedMem (
+    Addr,
+    (UINT32)DpUsed,
+    0,
+    PcdGet32 (PcdVideoHorizontalResolution),
+    PcdGet32 (PcdVideoVerticalResolution),
+    0
+    );
+}
+
 /**
   Initialize dcdp resource.
   1.Set dcdp config variable. Driver can get configuration(each path enable state)
     from this variable.
   2.Regitst device.
 
+  @param[in]  BoardConfig  A pointer to the board parameter table.
+
   @retval    NULL.
 **/
 STATIC
 VOID
 DcDpResourceInit (
-  VOID
+  IN BOARD_CONFIG  *BoardConfig
   )
 {
   EFI_STATUS            Status;
   EFI_HANDLE            Handle;
   UINT32                DpUsed;
-  EFI_PHYSICAL_ADDRESS  Address;
-  UINT8                 Buffer[1024];
-  BOARD_CONFIG          *BoardConfig;
   UINT8                 PhyMode0;
   UINT8                 PhyMode1;
 
-  GetParameterInfo (PM_BOARD, Buffer, sizeof(Buffer));
-  BoardConfig = (BOARD_CONFIG *)Buffer;
-  Status = gBS->AllocatePages (
-                  AllocateAnyPages,
-                  EfiBootServicesData,
-                  1,
-                  &Address
-                  );
-  ASSERT_EFI_ERROR (Status);
   //
   //Dp Used
   //
@@ -570,17 +648,6 @@ DcDpResourceInit (
   if ((PhyMode1 == 1) && PcdGetBool (PcdDcDpChanel1Enable)) {
     DpUsed |= 0x2;
   }
-  ConfigDpSharedMem (
-    Address,
-    DpUsed,
-    0,
-    PcdGet32 (PcdVideoHorizontalResolution),
-    PcdGet32 (PcdVideoVerticalResolution),
-    0
-    );
-
-  mDcDpDesc[2].AddrRangeMin = Address;
-  mDcDpDesc[2].AddrRangeMax = Address + 4096;
   //
   //dc dp
   //
@@ -589,6 +656,10 @@ DcDpResourceInit (
              &gSocDcDpNonDiscoverableDeviceGuid,
              mDcDpDesc,
              &mDcDpDevicePath,
+             DcDpShareMemInit,
+             2,
+             DpUsed,
+             PLATFORM_DEVICE_INIT_DCDP,
              &Handle
              );
   ASSERT_EFI_ERROR (Status);
@@ -609,14 +680,14 @@ STATIC
 VOID
 ConfigUsb2SharedMem (
   IN EFI_PHYSICAL_ADDRESS  Addr,
-  IN UINT32                IntNum
+  IN UINTN                 IntNum
   )
 {
   //version
   MmioWrite32 (Addr, 0x100);
   //Interrupt Number
   Addr += 4;
-  MmioWrite32 (Addr, IntNum);
+  MmioWrite32 (Addr, (UINT32)IntNum);
   DEBUG ((DEBUG_INFO, "Interrupt Number  : %d\n", IntNum));
 }
 
@@ -633,7 +704,6 @@ UsbDeviceRegister (
 {
   EFI_HANDLE            Handle;
   EFI_STATUS            Status;
-  EFI_PHYSICAL_ADDRESS  Address;
 
   //
   //Usb3-0
@@ -649,6 +719,10 @@ UsbDeviceRegister (
                &gPsuUsb3NonDiscoverableDeviceGuid,
                mPsuUsb30Desc,
                &mPsuUsb30DevicePath,
+               NULL,
+               0,
+               0,
+               0,
                &Handle);
     ASSERT_EFI_ERROR (Status);
   }
@@ -666,6 +740,10 @@ UsbDeviceRegister (
                &gPsuUsb3NonDiscoverableDeviceGuid,
                mPsuUsb31Desc,
                &mPsuUsb31DevicePath,
+               NULL,
+               0,
+               0,
+               0,
                &Handle);
     ASSERT_EFI_ERROR (Status);
   }
@@ -674,21 +752,15 @@ UsbDeviceRegister (
   //
   if (PcdGetBool (PcdUsb2P20Enable)) {
     DEBUG ((DEBUG_INFO, "Usb2.0 p2-0 Register!\n"));
-    Status = gBS->AllocatePages (
-                    AllocateAnyPages,
-                    EfiBootServicesData,
-                    1,
-                    &Address
-                    );
-    DEBUG ((DEBUG_INFO, "Share Memory Address : %llx\n", Address));
-    ConfigUsb2SharedMem (Address, 64);
-    mUsb2P20Desc[2].AddrRangeMin = Address;
-    mUsb2P20Desc[2].AddrRangeMax = Address + 4096;
     Handle = NULL;
     Status = RegisterDevice (
                &gPhytiumUsb2NonDiscoverableDeviceGuid,
                mUsb2P20Desc,
                &mUsb2P20DevicePath,
+               ConfigUsb2SharedMem,
+               2,
+               64,
+               PLATFORM_DEVICE_INIT_USB2,
                &Handle);
     ASSERT_EFI_ERROR (Status);
   }
@@ -697,21 +769,15 @@ UsbDeviceRegister (
   //
   if (PcdGetBool (PcdUsb2P3Enable)) {
     DEBUG ((DEBUG_INFO, "Usb2.0 p3 Register!\n"));
-    Status = gBS->AllocatePages (
-                    AllocateAnyPages,
-                    EfiBootServicesData,
-                    1,
-                    &Address
-                    );
-    DEBUG ((DEBUG_INFO, "Share Memory Address : %llx\n", Address));
-    ConfigUsb2SharedMem (Address, 46);
-    mUsb2P3Desc[2].AddrRangeMin = Address;
-    mUsb2P3Desc[2].AddrRangeMax = Address + 4096;
     Handle = NULL;
     Status = RegisterDevice (
                &gPhytiumUsb2NonDiscoverableDeviceGuid,
                mUsb2P3Desc,
                &mUsb2P3DevicePath,
+               ConfigUsb2SharedMem,
+               2,
+               46,
+               PLATFORM_DEVICE_INIT_USB2,
                &Handle);
     ASSERT_EFI_ERROR (Status);
   }
@@ -720,21 +786,15 @@ UsbDeviceRegister (
   //
   if (PcdGetBool (PcdUsb2P4Enable)) {
     DEBUG ((DEBUG_INFO, "Usb2.0 p4 Register!\n"));
-    Status = gBS->AllocatePages (
-                    AllocateAnyPages,
-                    EfiBootServicesData,
-                    1,
-                    &Address
-                    );
-    DEBUG ((DEBUG_INFO, "Share Memory Address : %llx\n", Address));
-    ConfigUsb2SharedMem (Address, 47);
-    mUsb2P4Desc[2].AddrRangeMin = Address;
-    mUsb2P4Desc[2].AddrRangeMax = Address + 4096;
     Handle = NULL;
     Status = RegisterDevice (
                &gPhytiumUsb2NonDiscoverableDeviceGuid,
                mUsb2P4Desc,
                &mUsb2P4DevicePath,
+               ConfigUsb2SharedMem,
+               2,
+               47,
+               PLATFORM_DEVICE_INIT_USB2,
                &Handle);
     ASSERT_EFI_ERROR (Status);
   }
@@ -743,23 +803,21 @@ UsbDeviceRegister (
 /**
   Sata device register.
 
+  @param[in]  BoardConfig  A pointer to the board parameter table.
+
   @retval    Null.
 **/
 STATIC
 VOID
 GsdDeviceRegister (
-  VOID
+  IN BOARD_CONFIG  *BoardConfig
   )
 {
   EFI_HANDLE       Handle;
   EFI_STATUS       Status;
-  UINT8            Buffer[1024];
-  BOARD_CONFIG     *BoardConfig;
   UINT8            Type;
 
   Status = EFI_NOT_FOUND;
-  GetParameterInfo (PM_BOARD, Buffer, sizeof(Buffer));
-  BoardConfig = (BOARD_CONFIG *)Buffer;
 
   //sata 0 - psu sata
   Type = (BoardConfig->PhySelMode >> (1 * 2)) & 0x3;
@@ -769,6 +827,10 @@ GsdDeviceRegister (
                &gSocSataNonDiscoverableDeviceGuid,
                mPsuSataDesc,
                &mPsuSataDevicePath,
+               NULL,
+               0,
+               0,
+               0,
                &Handle
                );
     ASSERT_EFI_ERROR (Status);
@@ -781,6 +843,10 @@ GsdDeviceRegister (
                &gSocSataNonDiscoverableDeviceGuid,
                mGsdSataDesc,
                &mGsdSataDevicePath,
+               NULL,
+               0,
+               0,
+               0,
                &Handle
                );
     ASSERT_EFI_ERROR (Status);
@@ -796,14 +862,30 @@ PlatformDxeInitialise (
   )
 {
   EFI_STATUS          Status;
+  EFI_EVENT           Event;
+  UINT8               Buffer[1024];
+  BOARD_CONFIG        *BoardConfig;
 
   Status = EFI_SUCCESS;
 
-  StoreDdrTrainInfo ();
+  if (IsDeviceInitDeferred (PLATFORM_DEVICE_INIT_DDR_INFO)) {
+    Status = EfiCreateEventReadyToBootEx (
+               TPL_CALLBACK,
+               StoreDdrTrainInfoOnReadyToBoot,
+               NULL,
+               &Event
+               );
+    ASSERT_EFI_ERROR (Status);
+  } else {
+    StoreDdrTrainInfo ();
+  }
+
+  GetParameterInfo (PM_BOARD, Buffer, sizeof(Buffer));
+  BoardConfig = (BOARD_CONFIG *)Buffer;
   //PhyConfigWithParTable ();
   UsbDeviceRegister ();
-  GsdDeviceRegister ();
-  GmuRegister ();
-  DcDpResourceInit ();
-  return Status;
+  GsdDeviceRegister (BoardConfig);
+  GmuRegister (BoardConfig);
+  DcDpResourceInit (BoardConfig);
+  return EFI_SUCCESS;
 }
@@ -20,6 +20,35 @@ typedef struct {
   EFI_DEVICE_PATH_PROTOCOL        End;
 } HII_VENDOR_DEVICE_PATH;
 
+//
+// PcdPhytiumDeviceDeferredInitMask bits
+//
+#define PLATFORM_DEVICE_INIT_GMU        BIT0
+#define PLATFORM_DEVICE_INIT_DCDP       BIT1
+#define PLATFORM_DEVICE_INIT_USB2       BIT2
+#define PLATFORM_DEVICE_INIT_DDR_INFO   BIT3
+
+typedef
+VOID
+(*PLATFORM_DEVICE_RESOURCE_INIT) (
+  IN EFI_PHYSICAL_ADDRESS  ShareMem,
+  IN UINTN                 Context
+  );
+
+#define PLATFORM_DEVICE_SIGNATURE  SIGNATURE_32 ('P', 'D', 'E', 'V')
+
+typedef struct {
+  UINT32                          Signature;
+  NON_DISCOVERABLE_DEVICE         Device;
+  PLATFORM_DEVICE_RESOURCE_INIT   ResourceInit;
+  UINTN                           ShareMemIndex;
+  UINTN                           Context;
+  BOOLEAN                         Initialized;
+} PLATFORM_DEVICE;
+
+#define PLATFORM_DEVICE_FROM_THIS(a) \
+  CR (a, PLATFORM_DEVICE, Device, PLATFORM_DEVICE_SIGNATURE)
+
 extern HII_VENDOR_DEVICE_PATH  mPsuUsb30DevicePath;
 extern EFI_ACPI_ADDRESS_SPACE_DESCRIPTOR mPsuUsb30Desc[];
 extern HII_VENDOR_DEVICE_PATH  mPsuUsb31DevicePath;
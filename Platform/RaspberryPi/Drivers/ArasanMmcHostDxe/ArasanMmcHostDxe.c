@@ -18,6 +18,18 @@ UINT32 LastExecutedCommand = (UINT32) -1;
 STATIC RASPBERRY_PI_FIRMWARE_PROTOCOL *mFwProtocol;
 STATIC UINTN mMmcHsBase;
 
+//
+// ADMA2 state. Block read/write commands are held back by MMCSendCommand
+// until the data buffer is known, so that the descriptors can be set up
+// before the command is issued.
+//
+STATIC ADMA2_DESCRIPTOR *mAdmaDescriptors;
+STATIC EFI_PHYSICAL_ADDRESS mAdmaDescriptorsBusAddress;
+STATIC BOOLEAN mDmaEnabled;
+STATIC BOOLEAN mCommandPending;
+STATIC UINT32 mPendingCommand;
+STATIC UINT32 mPendingArgument;
+
 STATIC
 UINT32
 EFIAPI
@@ -325,32 +337,27 @@ MMCBuildDevicePath (
   return EFI_SUCCESS;
 }
 
+/**
+   Issues a translated command to the controller and waits for its completion.
+
+   A non-zero DmaBlockCount sets up an ADMA2 transfer of that many blocks,
+   using the descriptor table already programmed into the controller.
+**/
+STATIC
 EFI_STATUS
-MMCSendCommand (
-  IN EFI_MMC_HOST_PROTOCOL    *This,
-  IN MMC_CMD                  MmcCmd,
-  IN UINT32                   Argument
+SdIssueCommand (
+  IN UINT32  MmcCmd,
+  IN UINT32  Argument,
+  IN BOOLEAN IsAppCmd,
+  IN UINT32  DmaBlockCount
   )
 {
   UINTN MmcStatus;
   UINTN RetryCount = 0;
   UINTN CmdSendOKMask;
-  EFI_STATUS Status = EFI_SUCCESS;
-  BOOLEAN IsAppCmd = (LastExecutedCommand == CMD55);
   BOOLEAN IsDATCmd = FALSE;
   BOOLEAN IsADTCCmd = FALSE;
 
-  DEBUG ((DEBUG_MMCHOST_SD, "ArasanMMCHost: MMCSendCommand(MmcCmd: %08x, Argument: %08x)\n", MmcCmd, Argument));
-
-  if (IgnoreCommand (MmcCmd)) {
-    return EFI_SUCCESS;
-  }
-
-  MmcCmd = TranslateCommand (MmcCmd, Argument);
-  if (MmcCmd == 0xffffffff) {
-    return EFI_UNSUPPORTED;
-  }
-
   if ((MmcCmd & CMD_R1_ADTC) == CMD_R1_ADTC) {
     IsADTCCmd = TRUE;
   }
@@ -377,11 +384,13 @@ MMCSendCommand (
     DEBUG ((DEBUG_ERROR, "%a(%u): not ready for MMC_CMD%u PresState 0x%x MmcStatus 0x%x\n",
       __FUNCTION__, __LINE__, MMC_CMD_NUM (MmcCmd),
       MmioRead32 (MMCHS_PRES_STATE), MmioRead32 (MMCHS_INT_STAT)));
-    Status = EFI_TIMEOUT;
-    goto Exit;
+    return EFI_TIMEOUT;
   }
 
-  if (IsAppCmd && MmcCmd == ACMD22) {
+  if (DmaBlockCount != 0) {
+    SdMmioWrite32 (MMCHS_BLK, BLEN_512BYTES | (DmaBlockCount << BLOCK_COUNT_SHIFT));
+    MmcCmd |= DE_ENABLE | BCE_ENABLE;
+  } else if (IsAppCmd && MmcCmd == ACMD22) {
     SdMmioWrite32 (MMCHS_BLK, 4);
   } else if (IsAppCmd && MmcCmd == ACMD51) {
     SdMmioWrite32 (MMCHS_BLK, 8);
@@ -423,8 +432,7 @@ MMCSendCommand (
 
       SoftReset (SRC);
 
-      Status = EFI_DEVICE_ERROR;
-      goto Exit;
+      return EFI_DEVICE_ERROR;
     }
 
     // Check if command is completed.
@@ -437,17 +445,60 @@ MMCSendCommand (
     gBS->Stall (STALL_AFTER_RETRY_US);
   }
 
-  gBS->Stall (STALL_AFTER_SEND_CMD_US);
+  //
+  // A DMA transfer is followed by a wait on its completion status instead.
+  //
+  if (DmaBlockCount == 0) {
+    gBS->Stall (STALL_AFTER_SEND_CMD_US);
+  }
 
   if (RetryCount == MAX_RETRY_COUNT) {
     DEBUG ((DEBUG_ERROR, "%a(%u): MMC_CMD%u completion TIMEOUT PresState 0x%x MmcStatus 0x%x\n",
       __FUNCTION__, __LINE__, MMC_CMD_NUM (MmcCmd),
       MmioRead32 (MMCHS_PRES_STATE), MmcStatus));
-    Status = EFI_TIMEOUT;
-    goto Exit;
+    return EFI_TIMEOUT;
+  }
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+MMCSendCommand (
+  IN EFI_MMC_HOST_PROTOCOL    *This,
+  IN MMC_CMD                  MmcCmd,
+  IN UINT32                   Argument
+  )
+{
+  EFI_STATUS Status;
+  BOOLEAN IsAppCmd = (LastExecutedCommand == CMD55);
+
+  DEBUG ((DEBUG_MMCHOST_SD, "ArasanMMCHost: MMCSendCommand(MmcCmd: %08x, Argument: %08x)\n", MmcCmd, Argument));
+
+  if (IgnoreCommand (MmcCmd)) {
+    return EFI_SUCCESS;
   }
 
-Exit:
+  MmcCmd = TranslateCommand (MmcCmd, Argument);
+  if (MmcCmd == 0xffffffff) {
+    return EFI_UNSUPPORTED;
+  }
+
+  mCommandPending = FALSE;
+  if (mDmaEnabled &&
+      (MmcCmd == CMD17 || MmcCmd == CMD18 ||
+       MmcCmd == CMD24 || MmcCmd == CMD25)) {
+    //
+    // Issued by MMCReadBlockData/MMCWriteBlockData, once the buffer is known.
+    //
+    mCommandPending = TRUE;
+    mPendingCommand = MmcCmd;
+    mPendingArgument = Argument;
+    LastExecutedCommand = MmcCmd;
+    return EFI_SUCCESS;
+  }
+
+  Status = SdIssueCommand (MmcCmd, Argument, IsAppCmd, 0);
+
   if (EFI_ERROR (Status)) {
     LastExecutedCommand = (UINT32) -1;
   } else {
@@ -516,6 +567,15 @@ MMCNotifyState (
 
       // Enable interrupts
       SdMmioWrite32 (MMCHS_IE, ALL_EN);
+
+      // Use ADMA2 for block transfers if the controller supports it
+      mDmaEnabled = (mAdmaDescriptors != NULL) &&
+                    ((MmioRead32 (MMCHS_CAPA) & ADMA2S) != 0);
+      if (mDmaEnabled) {
+        SdMmioAndThenOr32 (MMCHS_HCTL, (UINT32) ~DMAS_MASK, DMAS_ADMA2_32);
+      }
+      DEBUG ((DEBUG_INFO, "ArasanMMCHost: using %a for block transfers\n",
+        mDmaEnabled ? "ADMA2" : "PIO"));
     }
     break;
   case MmcIdleState:
@@ -678,6 +738,98 @@ MMCReceiveResponse (
   return EFI_SUCCESS;
 }
 
+/**
+   Issues the pending block read/write command and moves its data with ADMA2,
+   waiting for the transfer complete status.
+
+   @retval EFI_UNSUPPORTED  The buffer can't be used for DMA. The command has
+                            not been issued.
+**/
+STATIC
+EFI_STATUS
+SdDmaTransfer (
+  IN BOOLEAN IsRead,
+  IN UINTN   Length,
+  IN VOID    *Buffer
+  )
+{
+  EFI_STATUS Status;
+  EFI_PHYSICAL_ADDRESS BusAddress;
+  VOID *Mapping;
+  UINTN MappedLength;
+  UINTN BlockCount;
+  UINTN Index;
+  UINTN Offset;
+  UINTN Timeout;
+  UINTN Elapsed;
+  UINTN MmcStatus;
+
+  BlockCount = Length / BLEN_512BYTES;
+  if ((Length % BLEN_512BYTES) != 0 || BlockCount == 0 ||
+      BlockCount > ADMA2_MAX_BLOCKS) {
+    return EFI_UNSUPPORTED;
+  }
+
+  MappedLength = Length;
+  Status = DmaMap (IsRead ? MapOperationBusMasterWrite : MapOperationBusMasterRead,
+             Buffer, &MappedLength, &BusAddress, &Mapping);
+  if (EFI_ERROR (Status)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  if (MappedLength != Length || (BusAddress & 0x3) != 0 ||
+      BusAddress + Length - 1 > MAX_UINT32) {
+    DmaUnmap (Mapping);
+    return EFI_UNSUPPORTED;
+  }
+
+  for (Index = 0, Offset = 0; Offset < Length; Index++, Offset += ADMA2_MAX_LENGTH) {
+    mAdmaDescriptors[Index].Attributes = ADMA2_VALID | ADMA2_ACT_TRAN;
+    mAdmaDescriptors[Index].Length = (UINT16)MIN (Length - Offset, ADMA2_MAX_LENGTH);
+    mAdmaDescriptors[Index].Address = (UINT32)(BusAddress + Offset);
+  }
+  mAdmaDescriptors[Index - 1].Attributes |= ADMA2_END;
+
+  MemoryFence ();
+  SdMmioWrite32 (MMCHS_ADMA_ADDR, (UINT32)mAdmaDescriptorsBusAddress);
+
+  mFwProtocol->SetLed (TRUE);
+
+  Status = SdIssueCommand (mPendingCommand, mPendingArgument, FALSE, (UINT32)BlockCount);
+  if (!EFI_ERROR (Status)) {
+    Status = EFI_TIMEOUT;
+    MmcStatus = 0;
+    Timeout = DMA_TIMEOUT_US + BlockCount * DMA_BLOCK_TIMEOUT_US;
+    for (Elapsed = 0; Elapsed < Timeout; Elapsed += DMA_POLL_INTERVAL_US) {
+      MmcStatus = MmioRead32 (MMCHS_INT_STAT);
+      if ((MmcStatus & ERRI) != 0) {
+        Status = EFI_DEVICE_ERROR;
+        break;
+      }
+
+      if ((MmcStatus & TC) != 0) {
+        SdMmioWrite32 (MMCHS_INT_STAT, TC);
+        Status = EFI_SUCCESS;
+        break;
+      }
+
+      gBS->Stall (DMA_POLL_INTERVAL_US);
+    }
+
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a(%u): MMC_CMD%u %r after %lu blocks, MMCHS_INT_STAT: %08x\n",
+        __FUNCTION__, __LINE__, MMC_CMD_NUM (mPendingCommand), Status,
+        BlockCount, MmcStatus));
+      SoftReset (SRC | SRD);
+    }
+  }
+
+  mFwProtocol->SetLed (FALSE);
+
+  DmaUnmap (Mapping);
+  return Status;
+}
+
 EFI_STATUS
 MMCReadBlockData (
   IN EFI_MMC_HOST_PROTOCOL    *This,
@@ -686,6 +838,7 @@ MMCReadBlockData (
   IN UINT32*                  Buffer
   )
 {
+  EFI_STATUS Status;
   UINTN MmcStatus;
   UINTN RemLength;
   UINTN Count;
@@ -703,6 +856,22 @@ MMCReadBlockData (
     return EFI_INVALID_PARAMETER;
   }
 
+  if (mCommandPending) {
+    mCommandPending = FALSE;
+    Status = SdDmaTransfer (TRUE, Length, Buffer);
+    if (Status != EFI_UNSUPPORTED) {
+      return Status;
+    }
+
+    //
+    // Can't DMA into this buffer, fall back to PIO.
+    //
+    Status = SdIssueCommand (mPendingCommand, mPendingArgument, FALSE, 0);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
   RemLength = Length;
   while (RemLength != 0) {
     UINTN RetryCount = 0;
@@ -750,6 +919,7 @@ MMCWriteBlockData (
   IN UINT32*                  Buffer
   )
 {
+  EFI_STATUS Status;
   UINTN MmcStatus;
   UINTN RemLength;
   UINTN Count;
@@ -767,6 +937,22 @@ MMCWriteBlockData (
     return EFI_INVALID_PARAMETER;
   }
 
+  if (mCommandPending) {
+    mCommandPending = FALSE;
+    Status = SdDmaTransfer (FALSE, Length, Buffer);
+    if (Status != EFI_UNSUPPORTED) {
+      return Status;
+    }
+
+    //
+    // Can't DMA from this buffer, fall back to PIO.
+    //
+    Status = SdIssueCommand (mPendingCommand, mPendingArgument, FALSE, 0);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
   RemLength = Length;
   while (RemLength != 0) {
     UINTN RetryCount = 0;
@@ -829,6 +1015,47 @@ EFI_MMC_HOST_PROTOCOL gMMCHost =
   MMCIsMultiBlock
 };
 
+/**
+   Allocates the ADMA2 descriptor table, which must be addressable by the
+   controller with 32 bits.
+**/
+STATIC
+EFI_STATUS
+AdmaInitialize (
+  VOID
+  )
+{
+  EFI_STATUS Status;
+  VOID *Buffer;
+  VOID *Mapping;
+  UINTN Length;
+
+  ASSERT (EFI_PAGES_TO_SIZE (ADMA2_DESCRIPTOR_PAGES) / sizeof (ADMA2_DESCRIPTOR) *
+    ADMA2_MAX_LENGTH >= ADMA2_MAX_BLOCKS * BLEN_512BYTES);
+
+  Status = DmaAllocateBuffer (EfiBootServicesData, ADMA2_DESCRIPTOR_PAGES, &Buffer);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Length = EFI_PAGES_TO_SIZE (ADMA2_DESCRIPTOR_PAGES);
+  Status = DmaMap (MapOperationBusMasterCommonBuffer, Buffer, &Length,
+             &mAdmaDescriptorsBusAddress, &Mapping);
+  if (EFI_ERROR (Status)) {
+    DmaFreeBuffer (ADMA2_DESCRIPTOR_PAGES, Buffer);
+    return Status;
+  }
+
+  if (mAdmaDescriptorsBusAddress + Length - 1 > MAX_UINT32) {
+    DmaUnmap (Mapping);
+    DmaFreeBuffer (ADMA2_DESCRIPTOR_PAGES, Buffer);
+    return EFI_UNSUPPORTED;
+  }
+
+  mAdmaDescriptors = Buffer;
+  return EFI_SUCCESS;
+}
+
 EFI_STATUS
 MMCInitialize (
   IN EFI_HANDLE          ImageHandle,
@@ -858,6 +1085,21 @@ MMCInitialize (
     return Status;
   }
 
+  //
+  // The legacy Arasan controller has no usable DMA, but EMMC2 does, on
+  // the steppings whose bus addresses match our DMA window.
+  //
+  if (!PcdGet32 (PcdSdIsArasan)) {
+    if ((MmioRead32 (ID_CHIPREV) & CHIPREV_STEPPING_MASK) < CHIPREV_STEPPING_C0) {
+      DEBUG ((DEBUG_INFO, "ArasanMMCHost: EMMC2 DMA is translated on this stepping, using PIO\n"));
+    } else {
+      Status = AdmaInitialize ();
+      if (EFI_ERROR (Status)) {
+        DEBUG ((DEBUG_WARN, "ArasanMMCHost: no ADMA2 descriptors (%r), using PIO\n", Status));
+      }
+    }
+  }
+
   Status = gBS->InstallMultipleProtocolInterfaces (
                   &Handle,
                   &gRaspberryPiMmcHostProtocolGuid,
@@ -27,6 +27,7 @@
 #include <Protocol/RpiMmcHost.h>
 #include <Protocol/RpiFirmware.h>
 
+#include <IndustryStandard/Bcm2711.h>
 #include <IndustryStandard/Bcm2836.h>
 #include <IndustryStandard/Bcm2836Sdio.h>
 #include <IndustryStandard/RpiMbox.h>
@@ -42,4 +43,34 @@
 
 #define MAX_DIVISOR_VALUE 1023
 
+//
+// ADMA2 (32-bit) descriptor table, used for block reads and writes when the
+// controller supports it. A transfer is limited by the 16-bit block count
+// register, which the table is sized to cover.
+//
+#define ADMA2_VALID            BIT0
+#define ADMA2_END              BIT1
+#define ADMA2_ACT_TRAN         (0x2 << 4)
+#define ADMA2_MAX_LENGTH       (SIZE_64KB - BLEN_512BYTES)
+#define ADMA2_DESCRIPTOR_PAGES 2
+#define ADMA2_MAX_BLOCKS       0xFFFF
+
+#define DMA_POLL_INTERVAL_US   (2)
+#define DMA_TIMEOUT_US         (1000 * 1000)
+#define DMA_BLOCK_TIMEOUT_US   (250)
+
+//
+// BCM2711 steppings older than C0 see RAM through EMMC2 at 0xC0000000, C0
+// and newer see it untranslated, like the DMA window this driver is built
+// with (see _DMA in Emmc.asl).
+//
+#define CHIPREV_STEPPING_MASK  0xFF
+#define CHIPREV_STEPPING_C0    0x20
+
+typedef struct {
+  UINT16 Attributes;
+  UINT16 Length;
+  UINT32 Address;
+} ADMA2_DESCRIPTOR;
+
 #endif
@@ -94,7 +94,6 @@ Wait4Chhltd (
   UINT32  Hcint, Hctsiz;
   UINT32  HcintCompHltAck = DWC2_HCINT_XFERCOMP;
 
-  MicroSecondDelay (100);
   Status = Wait4Bit (Timeout, DwHc->DwUsbBase + HCINT (Channel),
                      DWC2_HCINT_CHHLTD, 1);
   if (EFI_ERROR (Status)) {
@@ -223,12 +222,58 @@ DwCoreReset (
   return EFI_SUCCESS;
 }
 
+/*
+ * Claim a free host channel. Transfers run at the caller's TPL, so
+ * one can be preempted by another at a higher TPL (e.g. a bulk
+ * transfer by the TPL_NOTIFY periodic interrupt polls), which then
+ * runs on its own channel and bounce buffer slice. Claim and release
+ * are done at TPL_HIGH_LEVEL, so a preempting transfer never sees a
+ * half-updated BusyChannels. One channel per TPL level a transfer
+ * can be issued at is enough; DWC2_MAX_HC_CHANNELS leaves a spare.
+ */
+STATIC
+EFI_STATUS
+DwHcAllocateChannel (
+  IN  DWUSB_OTGHC_DEV *DwHc,
+  OUT UINT32          *Channel
+  )
+{
+  EFI_TPL Tpl;
+  UINT32  Index;
+
+  Tpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  for (Index = 0; Index < DwHc->NumChannels; Index++) {
+    if ((DwHc->BusyChannels & (1U << Index)) == 0) {
+      DwHc->BusyChannels |= 1U << Index;
+      gBS->RestoreTPL (Tpl);
+      *Channel = Index;
+      return EFI_SUCCESS;
+    }
+  }
+  gBS->RestoreTPL (Tpl);
+
+  return EFI_OUT_OF_RESOURCES;
+}
+
+STATIC
+VOID
+DwHcFreeChannel (
+  IN  DWUSB_OTGHC_DEV *DwHc,
+  IN  UINT32          Channel
+  )
+{
+  EFI_TPL Tpl;
+
+  Tpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  DwHc->BusyChannels &= ~(1U << Channel);
+  gBS->RestoreTPL (Tpl);
+}
+
 STATIC
 EFI_STATUS
 DwHcTransfer (
   IN      DWUSB_OTGHC_DEV        *DwHc,
   IN      EFI_EVENT              Timeout,
-  IN      UINT32                 Channel,
   IN      EFI_USB2_HC_TRANSACTION_TRANSLATOR *Translator,
   IN      UINT8                  DeviceSpeed,
   IN      UINT8                  DeviceAddress,
@@ -243,6 +288,9 @@ DwHcTransfer (
   IN      BOOLEAN                IgnoreAck
   )
 {
+  UINT32                          Channel;
+  UINT8                           *ChannelBuffer;
+  UINTN                           ChannelBufferBusAddress;
   UINT32                          TxferLen;
   UINT32                          Done = 0;
   UINT32                          NumPackets;
@@ -251,11 +299,53 @@ DwHcTransfer (
   UINT32                          StopTransfer = 0;
   EFI_STATUS                      Status = EFI_SUCCESS;
   SPLIT_CONTROL                   Split = { 0 };
-
-  EFI_TPL Tpl = gBS->RaiseTPL (TPL_NOTIFY);
+  UINTN                           DirectLength = 0;
+  EFI_PHYSICAL_ADDRESS            DirectBusAddress;
+  VOID                            *DirectMapping = NULL;
+  BOOLEAN                         Direct;
 
   *TransferResult = EFI_USB_NOERROR;
 
+  Status = DwHcAllocateChannel (DwHc, &Channel);
+  if (EFI_ERROR (Status)) {
+    *TransferResult = EFI_USB_ERR_SYSTEM;
+    *DataLength = 0;
+    return Status;
+  }
+
+  ChannelBuffer = DwHc->AlignedBuffer + Channel * DWC2_DATA_BUF_SIZE;
+  ChannelBufferBusAddress = DwHc->AlignedBufferBusAddress +
+    Channel * DWC2_DATA_BUF_SIZE;
+
+  /*
+   * High speed bulk data is DMA'd straight to or from the caller's
+   * buffer, in runs as long as the channel counters allow, instead
+   * of 64K at a time through the bounce buffer. IN transfers can
+   * only do that for whole packets (the device may send a full
+   * one), so any tail still goes through the bounce buffer.
+   */
+  if (EpType == DWC2_HCCHAR_EPTYPE_BULK &&
+      DeviceSpeed == EFI_USB_SPEED_HIGH &&
+      ((UINTN)Data & (sizeof (UINT32) - 1)) == 0) {
+    DirectLength = *DataLength;
+    if (TransferDirection) { // in
+      DirectLength -= DirectLength % MaximumPacketLength;
+    }
+
+    if (DirectLength != 0) {
+      Status = DmaMap (TransferDirection ? MapOperationBusMasterWrite :
+                         MapOperationBusMasterRead,
+                 Data, &DirectLength, &DirectBusAddress, &DirectMapping);
+      if (EFI_ERROR (Status)) {
+        DirectLength = 0;
+        DirectMapping = NULL;
+        Status = EFI_SUCCESS;
+      } else if (TransferDirection) {
+        DirectLength -= DirectLength % MaximumPacketLength;
+      }
+    }
+  }
+
   do {
   RestartXfer:
     if (DeviceSpeed == EFI_USB_SPEED_LOW ||
@@ -265,36 +355,54 @@ DwHcTransfer (
       Split.Tries = 0;
     }
 
-    TxferLen = *DataLength - Done;
+    Direct = Done < DirectLength;
 
-    if (TxferLen > DWC2_MAX_TRANSFER_SIZE) {
-      TxferLen = DWC2_MAX_TRANSFER_SIZE - MaximumPacketLength + 1;
-    }
+    if (Direct) {
+      TxferLen = (UINT32)(DirectLength - Done);
 
-    if (TxferLen > DWC2_DATA_BUF_SIZE) {
-      TxferLen = DWC2_DATA_BUF_SIZE - MaximumPacketLength + 1;
-    }
+      if (TxferLen > DwHc->MaxTransferSize) {
+        TxferLen = DwHc->MaxTransferSize -
+          (UINT32)(DwHc->MaxTransferSize % MaximumPacketLength);
+      }
 
-    if (Split.Splitting || TxferLen == 0) {
-      NumPackets = 1;
-    } else {
       NumPackets = (TxferLen + MaximumPacketLength - 1) / MaximumPacketLength;
-      if (NumPackets > DWC2_MAX_PACKET_COUNT) {
-        NumPackets = DWC2_MAX_PACKET_COUNT;
+      if (NumPackets > DwHc->MaxPacketCount) {
+        NumPackets = DwHc->MaxPacketCount;
         TxferLen = NumPackets * MaximumPacketLength;
       }
-    }
-
-    if (TransferDirection) { // in
-      TxferLen = NumPackets * MaximumPacketLength;
     } else {
-      CopyMem (DwHc->AlignedBuffer, Data + Done, TxferLen);
-      ArmDataSynchronizationBarrier ();
+      TxferLen = *DataLength - Done;
+
+      if (TxferLen > DwHc->MaxTransferSize) {
+        TxferLen = DwHc->MaxTransferSize - MaximumPacketLength + 1;
+      }
+
+      if (TxferLen > DWC2_DATA_BUF_SIZE) {
+        TxferLen = DWC2_DATA_BUF_SIZE - MaximumPacketLength + 1;
+      }
+
+      if (Split.Splitting || TxferLen == 0) {
+        NumPackets = 1;
+      } else {
+        NumPackets = (TxferLen + MaximumPacketLength - 1) / MaximumPacketLength;
+        if (NumPackets > DwHc->MaxPacketCount) {
+          NumPackets = DwHc->MaxPacketCount;
+          TxferLen = NumPackets * MaximumPacketLength;
+        }
+      }
+
+      if (TransferDirection) { // in
+        TxferLen = NumPackets * MaximumPacketLength;
+      } else {
+        CopyMem (ChannelBuffer, Data + Done, TxferLen);
+        ArmDataSynchronizationBarrier ();
+      }
     }
 
   RestartChannel:
     MmioWrite32 (DwHc->DwUsbBase + HCDMA (Channel),
-      (UINTN)DwHc->AlignedBufferBusAddress);
+      Direct ? (UINT32)(DirectBusAddress + Done) :
+               (UINT32)ChannelBufferBusAddress);
 
     DwOtgHcInit (DwHc, Channel, Translator, DeviceSpeed,
       DeviceAddress, EpAddress,
@@ -369,7 +477,9 @@ DwHcTransfer (
     if (TransferDirection) { // in
       ArmDataSynchronizationBarrier ();
       TxferLen -= Sub;
-      CopyMem (Data + Done, DwHc->AlignedBuffer, TxferLen);
+      if (!Direct) {
+        CopyMem (Data + Done, ChannelBuffer, TxferLen);
+      }
       if (Sub) {
         StopTransfer = 1;
       }
@@ -381,9 +491,13 @@ DwHcTransfer (
   MmioWrite32 (DwHc->DwUsbBase + HCINTMSK (Channel), 0);
   MmioWrite32 (DwHc->DwUsbBase + HCINT (Channel), 0xFFFFFFFF);
 
-  *DataLength = Done;
+  if (DirectMapping != NULL) {
+    DmaUnmap (DirectMapping);
+  }
 
-  gBS->RestoreTPL (Tpl);
+  DwHcFreeChannel (DwHc, Channel);
+
+  *DataLength = Done;
 
   ASSERT (!EFI_ERROR (Status) || *TransferResult != EFI_USB_NOERROR);
 
@@ -437,13 +551,20 @@ DwHcDeferredTransfer (
 
   Req->TransferResult = EFI_USB_NOERROR;
   Status = DwHcTransfer (Req->DwHc, TimeoutEvt,
-             Req->Channel, Req->Translator,
+             Req->Translator,
              Req->DeviceSpeed, Req->DeviceAddress,
              Req->MaximumPacketLength, &Req->Pid,
              Req->TransferDirection, Req->Data, &Req->DataLength,
              Req->EpAddress, Req->EpType, &Req->TransferResult,
              Req->IgnoreAck);
 
+  if (Status == EFI_OUT_OF_RESOURCES) {
+    /*
+     * Every channel is busy, poll again on the next interval.
+     */
+    goto Exit;
+  }
+
   if (Req->EpType == DWC2_HCCHAR_EPTYPE_INTR &&
       Status == EFI_DEVICE_ERROR &&
       Req->TransferResult == EFI_USB_ERR_NAK) {
@@ -883,7 +1004,7 @@ DwHcControlTransfer (
   Pid = DWC2_HC_PID_SETUP;
   Length = 8;
   Status = DwHcTransfer (DwHc, TimeoutEvt,
-             DWC2_HC_CHANNEL, Translator, DeviceSpeed,
+             Translator, DeviceSpeed,
              DeviceAddress, MaximumPacketLength, &Pid, 0,
              Request, &Length, 0, DWC2_HCCHAR_EPTYPE_CONTROL,
              TransferResult, 1);
@@ -904,7 +1025,7 @@ DwHcControlTransfer (
     }
 
     Status = DwHcTransfer (DwHc, TimeoutEvt,
-               DWC2_HC_CHANNEL, Translator, DeviceSpeed,
+               Translator, DeviceSpeed,
                DeviceAddress, MaximumPacketLength, &Pid,
                Direction, Data, DataLength, 0,
                DWC2_HCCHAR_EPTYPE_CONTROL,
@@ -927,7 +1048,7 @@ DwHcControlTransfer (
   Pid = DWC2_HC_PID_DATA1;
   Length = 0;
   Status = DwHcTransfer (DwHc, TimeoutEvt,
-             DWC2_HC_CHANNEL, Translator, DeviceSpeed,
+             Translator, DeviceSpeed,
              DeviceAddress, MaximumPacketLength, &Pid,
              StatusDirection, DwHc->StatusBuffer, &Length, 0,
              DWC2_HCCHAR_EPTYPE_CONTROL, TransferResult, 1);
@@ -1017,7 +1138,7 @@ DwHcBulkTransfer (
   Pid = (*DataToggle << 1);
 
   Status = DwHcTransfer (DwHc, TimeoutEvt,
-             DWC2_HC_CHANNEL_BULK, Translator, DeviceSpeed,
+             Translator, DeviceSpeed,
              DeviceAddress, MaximumPacketLength, &Pid,
              TransferDirection, Data[0], DataLength, EpAddress,
              DWC2_HCCHAR_EPTYPE_BULK, TransferResult, 1);
@@ -1130,7 +1251,6 @@ DwHcAsyncInterruptTransfer (
     NewReq->FrameInterval;
 
   NewReq->DwHc = DwHc;
-  NewReq->Channel = DWC2_HC_CHANNEL_ASYNC;
   NewReq->Translator = Translator;
   NewReq->DeviceSpeed = DeviceSpeed;
   NewReq->DeviceAddress = DeviceAddress;
@@ -1226,7 +1346,7 @@ DwHcSyncInterruptTransfer (
   EpAddress = EndPointAddress & 0x0F;
   Pid = (*DataToggle << 1);
   Status = DwHcTransfer (DwHc, TimeoutEvt,
-             DWC2_HC_CHANNEL_SYNC, Translator,
+             Translator,
              DeviceSpeed, DeviceAddress,
              MaximumPacketLength,
              &Pid, TransferDirection, Data,
@@ -1344,6 +1464,7 @@ DwHcInit (
   UINT32 NpTxFifoSz = 0;
   UINT32 pTxFifoSz = 0;
   UINT32 Hprt0 = 0;
+  UINT32 Hwcfg3;
   INT32  i, Status, NumChannels;
 
   MmioWrite32 (DwHc->DwUsbBase + PCGCCTL, 0);
@@ -1372,6 +1493,20 @@ DwHcInit (
   NumChannels += 1;
   DEBUG ((DEBUG_INFO, "Host has %u channels\n", NumChannels));
 
+  DwHc->NumChannels = MIN (NumChannels, DWC2_MAX_HC_CHANNELS);
+  DwHc->BusyChannels = 0;
+
+  /*
+   * The transfer size and packet counters are 11-19 and 4-10 bits wide.
+   */
+  Hwcfg3 = MmioRead32 (DwHc->DwUsbBase + GHWCFG3);
+  DwHc->MaxTransferSize = (1U << (((Hwcfg3 & DWC2_HWCFG3_XFER_SIZE_CNTR_WIDTH_MASK) >>
+                                   DWC2_HWCFG3_XFER_SIZE_CNTR_WIDTH_OFFSET) + 11)) - 1;
+  DwHc->MaxPacketCount = (1U << (((Hwcfg3 & DWC2_HWCFG3_PACKET_SIZE_CNTR_WIDTH_MASK) >>
+                                  DWC2_HWCFG3_PACKET_SIZE_CNTR_WIDTH_OFFSET) + 4)) - 1;
+  DEBUG ((DEBUG_INFO, "Max transfer size %u, max packet count %u\n",
+    DwHc->MaxTransferSize, DwHc->MaxPacketCount));
+
   for (i = 0; i < NumChannels; i++)
     MmioAndThenOr32 (DwHc->DwUsbBase + HCCHAR (i),
       ~(DWC2_HCCHAR_CHEN | DWC2_HCCHAR_EPDIR),
@@ -1473,7 +1608,7 @@ DestroyDwUsbHc (
     gBS->CloseEvent (DwHc->ExitBootServiceEvent);
   }
 
-  Pages = EFI_SIZE_TO_PAGES (DWC2_DATA_BUF_SIZE);
+  Pages = EFI_SIZE_TO_PAGES (DWC2_DATA_BUF_SIZE * DWC2_MAX_HC_CHANNELS);
   DmaUnmap (DwHc->AlignedBufferMapping);
   DmaFreeBuffer (Pages, DwHc->AlignedBuffer);
 
@@ -1596,7 +1731,7 @@ CreateDwUsbHc (
     return EFI_OUT_OF_RESOURCES;
   }
 
-  Pages = EFI_SIZE_TO_PAGES (DWC2_DATA_BUF_SIZE);
+  Pages = EFI_SIZE_TO_PAGES (DWC2_DATA_BUF_SIZE * DWC2_MAX_HC_CHANNELS);
   Status = DmaAllocateBuffer (EfiBootServicesData, Pages, (VOID**)&DwHc->AlignedBuffer);
   if (EFI_ERROR (Status)) {
     DEBUG ((DEBUG_ERROR, "CreateDwUsbHc: DmaAllocateBuffer: %r\n", Status));
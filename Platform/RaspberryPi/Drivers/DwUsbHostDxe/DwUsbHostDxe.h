@@ -74,7 +74,6 @@ typedef struct {
 typedef struct _DWUSB_DEFERRED_REQ {
   IN OUT LIST_ENTRY                         List;
   IN     struct _DWUSB_OTGHC_DEV            *DwHc;
-  IN     UINT32                             Channel;
   IN     UINT32                             FrameInterval;
   IN     UINT32                             TargetFrame;
   IN     EFI_USB2_HC_TRANSACTION_TRANSLATOR *Translator;
@@ -108,10 +107,21 @@ typedef struct _DWUSB_OTGHC_DEV {
   EFI_PHYSICAL_ADDRESS            DwUsbBase;
   UINT8                           *StatusBuffer;
 
+  /*
+   * One DWC2_DATA_BUF_SIZE bounce buffer per host channel.
+   */
   UINT8                           *AlignedBuffer;
   VOID *                          AlignedBufferMapping;
   UINTN                           AlignedBufferBusAddress;
   LIST_ENTRY                      DeferredList;
+  /*
+   * Host channels in use by in-flight transfers, and the
+   * channel transfer size limits reported by GHWCFG3.
+   */
+  UINT32                          NumChannels;
+  UINT32                          BusyChannels;
+  UINT32                          MaxTransferSize;
+  UINT32                          MaxPacketCount;
   /*
    * 1ms frames.
    */
@@ -170,6 +170,134 @@ typedef struct {
 } RPI_FW_SET_POWER_STATE_CMD;
 #pragma pack()
 
+//
+// Answers that cannot change while UEFI is running. Most of them are
+// fetched in one batched transaction at driver start, and every getter
+// below consults the cache before going to the firmware.
+//
+#define RPI_FW_CACHED_ARM_MEMORY          BIT0
+#define RPI_FW_CACHED_MAC_ADDRESS         BIT1
+#define RPI_FW_CACHED_SERIAL              BIT2
+#define RPI_FW_CACHED_MODEL               BIT3
+#define RPI_FW_CACHED_MODEL_REVISION      BIT4
+#define RPI_FW_CACHED_FIRMWARE_REVISION   BIT5
+
+#define RPI_FW_MAX_CACHED_CLOCK_ID        RPI_MBOX_CLOCK_RATE_M2MC
+
+typedef struct {
+  UINT32                    Valid;
+  UINT32                    ArmMemory[2];     // Base, Size
+  UINT8                     MacAddress[6];
+  UINT64                    Serial;
+  UINT32                    Model;
+  UINT32                    ModelRevision;
+  UINT32                    FirmwareRevision;
+  //
+  // A zero entry means the rate has not been queried yet
+  //
+  UINT32                    MaxClockRate[RPI_FW_MAX_CACHED_CLOCK_ID + 1];
+  UINT32                    MinClockRate[RPI_FW_MAX_CACHED_CLOCK_ID + 1];
+} RPI_FW_CACHE;
+
+STATIC RPI_FW_CACHE mCache;
+
+typedef struct {
+  UINT32                    TagId;
+  VOID                      *Value;
+  UINT32                    ValueSize;
+  BOOLEAN                   Answered;
+} RPI_FW_BATCH_TAG;
+
+/**
+  Send several property tags to the firmware in a single mailbox transaction.
+
+  The contents of each tag's value buffer are sent as the request, and are
+  overwritten with the response if the firmware answered that tag.
+
+  @param  Tags    Array of tags to send
+  @param  Count   Number of entries in Tags
+
+  @retval EFI_SUCCESS           The transaction completed, check Answered
+  @retval EFI_BAD_BUFFER_SIZE   The tags do not fit in the DMA buffer
+  @retval EFI_DEVICE_ERROR      The mailbox transaction failed
+
+**/
+STATIC
+EFI_STATUS
+RpiFirmwareBatchTransaction (
+  IN OUT  RPI_FW_BATCH_TAG  *Tags,
+  IN      UINTN             Count
+  )
+{
+  RPI_FW_BUFFER_HEAD          *BufferHead;
+  RPI_FW_TAG_HEAD             *TagHead;
+  UINT8                       *Ptr;
+  UINTN                       Length;
+  UINTN                       Index;
+  UINT32                      ValueSize;
+  EFI_STATUS                  Status;
+  UINT32                      Result;
+
+  Length = sizeof (RPI_FW_BUFFER_HEAD) + sizeof (UINT32);
+  for (Index = 0; Index < Count; Index++) {
+    Length += sizeof (RPI_FW_TAG_HEAD) +
+              ALIGN_VALUE (Tags[Index].ValueSize, sizeof (UINT32));
+  }
+  if (Length > EFI_PAGES_TO_SIZE (NUM_PAGES)) {
+    return EFI_BAD_BUFFER_SIZE;
+  }
+
+  if (!AcquireSpinLockOrFail (&mMailboxLock)) {
+    DEBUG ((DEBUG_ERROR, "%a: failed to acquire spinlock\n", __FUNCTION__));
+    return EFI_DEVICE_ERROR;
+  }
+
+  BufferHead = mDmaBuffer;
+  ZeroMem (BufferHead, Length);
+
+  BufferHead->BufferSize  = (UINT32)Length;
+  BufferHead->Response    = 0;
+
+  //
+  // The end tag is the zeroed word following the last tag
+  //
+  Ptr = (UINT8 *)(BufferHead + 1);
+  for (Index = 0; Index < Count; Index++) {
+    TagHead               = (RPI_FW_TAG_HEAD *)Ptr;
+    TagHead->TagId        = Tags[Index].TagId;
+    TagHead->TagSize      = ALIGN_VALUE (Tags[Index].ValueSize, sizeof (UINT32));
+    TagHead->TagValueSize = 0;
+    CopyMem (TagHead + 1, Tags[Index].Value, Tags[Index].ValueSize);
+    Ptr += sizeof (*TagHead) + TagHead->TagSize;
+  }
+
+  Status = MailboxTransaction (BufferHead->BufferSize, RPI_MBOX_VC_CHANNEL, &Result);
+
+  if (EFI_ERROR (Status) ||
+      BufferHead->Response != RPI_MBOX_RESP_SUCCESS) {
+    DEBUG ((DEBUG_ERROR,
+      "%a: mailbox transaction error: Status == %r, Response == 0x%x\n",
+      __FUNCTION__, Status, BufferHead->Response));
+    ReleaseSpinLock (&mMailboxLock);
+    return EFI_DEVICE_ERROR;
+  }
+
+  Ptr = (UINT8 *)(BufferHead + 1);
+  for (Index = 0; Index < Count; Index++) {
+    TagHead   = (RPI_FW_TAG_HEAD *)Ptr;
+    ValueSize = TagHead->TagValueSize & ~RPI_MBOX_VALUE_SIZE_RESPONSE_MASK;
+
+    Tags[Index].Answered = (TagHead->TagValueSize & RPI_MBOX_VALUE_SIZE_RESPONSE_MASK) != 0;
+    if (Tags[Index].Answered) {
+      CopyMem (Tags[Index].Value, TagHead + 1, MIN (ValueSize, Tags[Index].ValueSize));
+    }
+    Ptr += sizeof (*TagHead) + ALIGN_VALUE (Tags[Index].ValueSize, sizeof (UINT32));
+  }
+  ReleaseSpinLock (&mMailboxLock);
+
+  return EFI_SUCCESS;
+}
+
 STATIC
 EFI_STATUS
 EFIAPI
@@ -249,6 +377,12 @@ RpiFirmwareGetArmMemory (
   EFI_STATUS                  Status;
   UINT32                      Result;
 
+  if ((mCache.Valid & RPI_FW_CACHED_ARM_MEMORY) != 0) {
+    *Base = mCache.ArmMemory[0];
+    *Size = mCache.ArmMemory[1];
+    return EFI_SUCCESS;
+  }
+
   if (!AcquireSpinLockOrFail (&mMailboxLock)) {
     DEBUG ((DEBUG_ERROR, "%a: failed to acquire spinlock\n", __FUNCTION__));
     return EFI_DEVICE_ERROR;
@@ -278,6 +412,9 @@ RpiFirmwareGetArmMemory (
 
   *Base = Cmd->TagBody.Base;
   *Size = Cmd->TagBody.Size;
+  mCache.ArmMemory[0] = *Base;
+  mCache.ArmMemory[1] = *Size;
+  mCache.Valid |= RPI_FW_CACHED_ARM_MEMORY;
   ReleaseSpinLock (&mMailboxLock);
 
   return EFI_SUCCESS;
@@ -308,6 +445,11 @@ RpiFirmwareGetMacAddress (
   EFI_STATUS                  Status;
   UINT32                      Result;
 
+  if ((mCache.Valid & RPI_FW_CACHED_MAC_ADDRESS) != 0) {
+    CopyMem (MacAddress, mCache.MacAddress, sizeof (mCache.MacAddress));
+    return EFI_SUCCESS;
+  }
+
   if (!AcquireSpinLockOrFail (&mMailboxLock)) {
     DEBUG ((DEBUG_ERROR, "%a: failed to acquire spinlock\n", __FUNCTION__));
     return EFI_DEVICE_ERROR;
@@ -335,6 +477,8 @@ RpiFirmwareGetMacAddress (
   }
 
   CopyMem (MacAddress, Cmd->TagBody.MacAddress, sizeof (Cmd->TagBody.MacAddress));
+  CopyMem (mCache.MacAddress, Cmd->TagBody.MacAddress, sizeof (mCache.MacAddress));
+  mCache.Valid |= RPI_FW_CACHED_MAC_ADDRESS;
   ReleaseSpinLock (&mMailboxLock);
 
   return EFI_SUCCESS;
@@ -355,8 +499,7 @@ typedef struct {
 
 STATIC
 EFI_STATUS
-EFIAPI
-RpiFirmwareGetSerial (
+RpiFirmwareGetBoardSerial (
   OUT   UINT64 *Serial
   )
 {
@@ -364,6 +507,11 @@ RpiFirmwareGetSerial (
   EFI_STATUS                  Status;
   UINT32                      Result;
 
+  if ((mCache.Valid & RPI_FW_CACHED_SERIAL) != 0) {
+    *Serial = mCache.Serial;
+    return EFI_SUCCESS;
+  }
+
   if (!AcquireSpinLockOrFail (&mMailboxLock)) {
     DEBUG ((DEBUG_ERROR, "%a: failed to acquire spinlock\n", __FUNCTION__));
     return EFI_DEVICE_ERROR;
@@ -391,7 +539,27 @@ RpiFirmwareGetSerial (
   }
 
   *Serial = Cmd->TagBody.Serial;
+  mCache.Serial = *Serial;
+  mCache.Valid |= RPI_FW_CACHED_SERIAL;
   ReleaseSpinLock (&mMailboxLock);
+
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+RpiFirmwareGetSerial (
+  OUT   UINT64 *Serial
+  )
+{
+  EFI_STATUS                  Status;
+
+  Status = RpiFirmwareGetBoardSerial (Serial);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
   // Some platforms return 0 or 0x0000000010000000 for serial.
   // For those, try to use the MAC address.
   if ((*Serial == 0) || ((*Serial & 0xFFFFFFFF0FFFFFFFULL) == 0)) {
@@ -427,6 +595,11 @@ RpiFirmwareGetModel (
   EFI_STATUS                  Status;
   UINT32                      Result;
 
+  if ((mCache.Valid & RPI_FW_CACHED_MODEL) != 0) {
+    *Model = mCache.Model;
+    return EFI_SUCCESS;
+  }
+
   if (!AcquireSpinLockOrFail (&mMailboxLock)) {
     DEBUG ((DEBUG_ERROR, "%a: failed to acquire spinlock\n", __FUNCTION__));
     return EFI_DEVICE_ERROR;
@@ -454,6 +627,8 @@ RpiFirmwareGetModel (
   }
 
   *Model = Cmd->TagBody.Model;
+  mCache.Model = *Model;
+  mCache.Valid |= RPI_FW_CACHED_MODEL;
   ReleaseSpinLock (&mMailboxLock);
 
   return EFI_SUCCESS;
@@ -483,6 +658,11 @@ RpiFirmwareGetModelRevision (
   EFI_STATUS                    Status;
   UINT32                        Result;
 
+  if ((mCache.Valid & RPI_FW_CACHED_MODEL_REVISION) != 0) {
+    *Revision = mCache.ModelRevision;
+    return EFI_SUCCESS;
+  }
+
   if (!AcquireSpinLockOrFail (&mMailboxLock)) {
     DEBUG ((DEBUG_ERROR, "%a: failed to acquire spinlock\n", __FUNCTION__));
     return EFI_DEVICE_ERROR;
@@ -510,6 +690,8 @@ RpiFirmwareGetModelRevision (
   }
 
   *Revision = Cmd->TagBody.Revision;
+  mCache.ModelRevision = *Revision;
+  mCache.Valid |= RPI_FW_CACHED_MODEL_REVISION;
   ReleaseSpinLock (&mMailboxLock);
 
   return EFI_SUCCESS;
@@ -526,6 +708,11 @@ RpiFirmwareGetFirmwareRevision (
   EFI_STATUS                    Status;
   UINT32                        Result;
 
+  if ((mCache.Valid & RPI_FW_CACHED_FIRMWARE_REVISION) != 0) {
+    *Revision = mCache.FirmwareRevision;
+    return EFI_SUCCESS;
+  }
+
   if (!AcquireSpinLockOrFail (&mMailboxLock)) {
     DEBUG ((DEBUG_ERROR, "%a: failed to acquire spinlock\n", __FUNCTION__));
     return EFI_DEVICE_ERROR;
@@ -553,6 +740,8 @@ RpiFirmwareGetFirmwareRevision (
   }
 
   *Revision = Cmd->TagBody.Revision;
+  mCache.FirmwareRevision = *Revision;
+  mCache.Valid |= RPI_FW_CACHED_FIRMWARE_REVISION;
   ReleaseSpinLock (&mMailboxLock);
 
   return EFI_SUCCESS;
@@ -1117,6 +1306,36 @@ typedef struct {
 } RPI_FW_GET_CLOCK_RATE_CMD;
 #pragma pack()
 
+/**
+  Return the cache slot for a clock rate query, if that rate is immutable.
+
+  @param  ClockId     Firmware clock ID
+  @param  ClockKind   Property tag of the rate query
+
+  @return Pointer to the cache slot, or NULL if the rate may not be cached
+
+**/
+STATIC
+UINT32 *
+RpiFirmwareClockRateCacheSlot (
+  IN  UINT32 ClockId,
+  IN  UINT32 ClockKind
+  )
+{
+  if (ClockId > RPI_FW_MAX_CACHED_CLOCK_ID) {
+    return NULL;
+  }
+
+  switch (ClockKind) {
+  case RPI_MBOX_GET_MAX_CLOCK_RATE:
+    return &mCache.MaxClockRate[ClockId];
+  case RPI_MBOX_GET_MIN_CLOCK_RATE:
+    return &mCache.MinClockRate[ClockId];
+  default:
+    return NULL;
+  }
+}
+
 STATIC
 EFI_STATUS
 RpiFirmwareGetClockRate (
@@ -1128,6 +1347,13 @@ RpiFirmwareGetClockRate (
   RPI_FW_GET_CLOCK_RATE_CMD   *Cmd;
   EFI_STATUS                  Status;
   UINT32                      Result;
+  UINT32                      *CacheSlot;
+
+  CacheSlot = RpiFirmwareClockRateCacheSlot (ClockId, ClockKind);
+  if (CacheSlot != NULL && *CacheSlot != 0) {
+    *ClockRate = *CacheSlot;
+    return EFI_SUCCESS;
+  }
 
   if (!AcquireSpinLockOrFail (&mMailboxLock)) {
     DEBUG ((DEBUG_ERROR, "%a: failed to acquire spinlock\n", __FUNCTION__));
@@ -1157,6 +1383,9 @@ RpiFirmwareGetClockRate (
   }
 
   *ClockRate = Cmd->TagBody.ClockRate;
+  if (CacheSlot != NULL) {
+    *CacheSlot = *ClockRate;
+  }
   ReleaseSpinLock (&mMailboxLock);
 
   DEBUG ((DEBUG_INFO, "%a: Get Clock Rate return: ClockRate=%d ClockId=%X\n", __FUNCTION__, *ClockRate, ClockId));
@@ -1560,6 +1789,68 @@ STATIC RASPBERRY_PI_FIRMWARE_PROTOCOL mRpiFirmwareProtocol = {
   RpiFirmwareNotifyGpioSetCfg
 };
 
+/**
+  Fetch the immutable board properties in a single batched transaction,
+  so that the getters can answer from the cache without a round trip to
+  the VPU. Tags the firmware does not answer are left uncached, and will
+  be queried individually on first use.
+
+**/
+STATIC
+VOID
+RpiFirmwareFillCache (
+  VOID
+  )
+{
+  RPI_FW_BATCH_TAG  Tags[6];
+  UINT32            CacheBits[ARRAY_SIZE (Tags)];
+  EFI_STATUS        Status;
+  UINTN             Index;
+
+  Tags[0].TagId       = RPI_MBOX_GET_ARM_MEMSIZE;
+  Tags[0].Value       = mCache.ArmMemory;
+  Tags[0].ValueSize   = sizeof (mCache.ArmMemory);
+  CacheBits[0]        = RPI_FW_CACHED_ARM_MEMORY;
+
+  Tags[1].TagId       = RPI_MBOX_GET_MAC_ADDRESS;
+  Tags[1].Value       = mCache.MacAddress;
+  Tags[1].ValueSize   = sizeof (mCache.MacAddress);
+  CacheBits[1]        = RPI_FW_CACHED_MAC_ADDRESS;
+
+  Tags[2].TagId       = RPI_MBOX_GET_BOARD_SERIAL;
+  Tags[2].Value       = &mCache.Serial;
+  Tags[2].ValueSize   = sizeof (mCache.Serial);
+  CacheBits[2]        = RPI_FW_CACHED_SERIAL;
+
+  Tags[3].TagId       = RPI_MBOX_GET_BOARD_MODEL;
+  Tags[3].Value       = &mCache.Model;
+  Tags[3].ValueSize   = sizeof (mCache.Model);
+  CacheBits[3]        = RPI_FW_CACHED_MODEL;
+
+  Tags[4].TagId       = RPI_MBOX_GET_BOARD_REVISION;
+  Tags[4].Value       = &mCache.ModelRevision;
+  Tags[4].ValueSize   = sizeof (mCache.ModelRevision);
+  CacheBits[4]        = RPI_FW_CACHED_MODEL_REVISION;
+
+  Tags[5].TagId       = RPI_MBOX_GET_REVISION;
+  Tags[5].Value       = &mCache.FirmwareRevision;
+  Tags[5].ValueSize   = sizeof (mCache.FirmwareRevision);
+  CacheBits[5]        = RPI_FW_CACHED_FIRMWARE_REVISION;
+
+  Status = RpiFirmwareBatchTransaction (Tags, ARRAY_SIZE (Tags));
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_WARN, "%a: failed to prefetch board properties (Status == %r)\n",
+      __FUNCTION__, Status));
+    return;
+  }
+
+  for (Index = 0; Index < ARRAY_SIZE (Tags); Index++) {
+    if (Tags[Index].Answered) {
+      mCache.Valid |= CacheBits[Index];
+    }
+  }
+}
+
 /**
   Initialize the state information for the CPU Architectural Protocol
 
@@ -1607,6 +1898,8 @@ RpiFirmwareDxeInitialize (
   //
   ASSERT (!(mDmaBufferBusAddress & (BCM2836_MBOX_NUM_CHANNELS - 1)));
 
+  RpiFirmwareFillCache ();
+
   Status = gBS->InstallProtocolInterface (&ImageHandle,
                   &gRaspberryPiFirmwareProtocolGuid, EFI_NATIVE_INTERFACE,
                   &mRpiFirmwareProtocol);
@@ -32,14 +32,25 @@
 #define SDHOST_BLOCK_BYTE_LENGTH            512
 
 // Driver Timing Parameters
-#define CMD_STALL_AFTER_POLL_US             1
 #define CMD_MIN_POLL_TOTAL_TIME_US          100000 // 100ms
-#define CMD_MAX_POLL_COUNT                  (CMD_MIN_POLL_TOTAL_TIME_US / CMD_STALL_AFTER_POLL_US)
 #define CMD_MAX_RETRY_COUNT                 3
 #define CMD_STALL_AFTER_RETRY_US            20 // 20us
-#define FIFO_MAX_POLL_COUNT                 1000000
+#define FIFO_MIN_POLL_TOTAL_TIME_US         1000000 // 1s without progress
 #define STALL_TO_STABILIZE_US               10000 // 10ms
 
+// Polls spin on the register first, then back off with growing stalls
+#define POLL_SPIN_COUNT                     1000
+#define POLL_MAX_STALL_US                   128
+
+// DMA channel not claimed by the VPU firmware, and the FIFO fill
+// level (in words) at which the SdHost raises its DREQ.
+#define SDHOST_DMA_CHANNEL                  4
+#define SDHOST_DMA_BASE_ADDRESS             BCM2836_DMA_CHANNEL_BASE_ADDRESS (SDHOST_DMA_CHANNEL)
+#define SDHOST_DMA_FIFO_THRESHOLD           4
+// The SdHost does not raise DREQ reliably for the final words of a
+// read, so the last FIFO's worth is always drained by PIO.
+#define SDHOST_DMA_READ_DRAIN_BYTES         (SDHOST_FIFO_WORDS * sizeof (UINT32))
+
 #define IDENT_MODE_SD_CLOCK_FREQ_HZ         400000 // 400KHz
 
 // Macros adopted from MmcDxe internal header
@@ -68,6 +79,73 @@ STATIC BOOLEAN mCardIsPresent = FALSE;
 STATIC CARD_DETECT_STATE mCardDetectState = CardDetectRequired;
 STATIC UINT32 mLastGoodCmd = MMC_GET_INDX (MMC_CMD0);
 
+// BCM283x DMA control block, must be 32-byte aligned
+typedef struct {
+  UINT32 TransferInfo;
+  UINT32 SourceAddress;
+  UINT32 DestinationAddress;
+  UINT32 TransferLength;
+  UINT32 Stride;
+  UINT32 NextControlBlock;
+  UINT32 Reserved[2];
+} SDHOST_DMA_CONTROL_BLOCK;
+
+STATIC SDHOST_DMA_CONTROL_BLOCK *mDmaCb;
+STATIC VOID                     *mDmaCbMapping;
+STATIC EFI_PHYSICAL_ADDRESS     mDmaCbBusAddress;
+
+typedef struct {
+  UINT32 Spins;
+  UINT32 StallUs;
+  UINT32 ElapsedUs;
+} SDHOST_POLL;
+
+STATIC VOID
+SdHostPollReset (
+  OUT SDHOST_POLL *Poll
+  )
+{
+  Poll->Spins = 0;
+  Poll->StallUs = 0;
+  Poll->ElapsedUs = 0;
+}
+
+/**
+  Wait before the next read of a polled register.
+
+  The first POLL_SPIN_COUNT calls return immediately, so that
+  conditions which are met within a few bus cycles are caught without
+  any delay. After that, the caller is stalled for periods doubling
+  up to POLL_MAX_STALL_US.
+
+  @return FALSE once TimeoutUs of stalls have elapsed, else TRUE.
+**/
+STATIC BOOLEAN
+SdHostPollWait (
+  IN OUT SDHOST_POLL *Poll,
+  IN     UINT32      TimeoutUs
+  )
+{
+  if (Poll->Spins < POLL_SPIN_COUNT) {
+    ++Poll->Spins;
+    return TRUE;
+  }
+
+  if (Poll->ElapsedUs >= TimeoutUs) {
+    return FALSE;
+  }
+
+  if (Poll->StallUs == 0) {
+    Poll->StallUs = 1;
+  } else if (Poll->StallUs < POLL_MAX_STALL_US) {
+    Poll->StallUs *= 2;
+  }
+
+  gBS->Stall (Poll->StallUs);
+  Poll->ElapsedUs += Poll->StallUs;
+  return TRUE;
+}
+
 STATIC inline BOOLEAN
 IsAppCmd (
   VOID
@@ -367,7 +445,8 @@ SdSendCommand (
     ((SdCmd & (SDHOST_CMD_RESPONSE_CMD_LONG_RESP | SDHOST_CMD_RESPONSE_CMD_NO_RESP)) >> 9),
     ((SdCmd & SDHOST_CMD_WRITE_CMD) ? 1 : 0), ((SdCmd & SDHOST_CMD_READ_CMD) ? 1 : 0)));
 
-  UINT32 PollCount = 0;
+  SDHOST_POLL Poll;
+  UINT32 CmdReg;
   UINT32 RetryCount = 0;
   BOOLEAN IsCmdExecuted = FALSE;
   EFI_STATUS Status = EFI_SUCCESS;
@@ -395,8 +474,9 @@ SdSendCommand (
     MmioWrite32 (SDHOST_CMD, SDHOST_CMD_NEW_FLAG | SdCmd);
 
     // Poll for the command status until it finishes execution
-    while (PollCount < CMD_MAX_POLL_COUNT) {
-      UINT32 CmdReg = MmioRead32 (SDHOST_CMD);
+    SdHostPollReset (&Poll);
+    do {
+      CmdReg = MmioRead32 (SDHOST_CMD);
 
       // Read status of command response
       if (CmdReg & SDHOST_CMD_FAIL_FLAG) {
@@ -411,10 +491,7 @@ SdSendCommand (
         IsCmdExecuted = TRUE;
         break;
       }
-
-      ++PollCount;
-      gBS->Stall (CMD_STALL_AFTER_POLL_US);
-    }
+    } while (SdHostPollWait (&Poll, CMD_MIN_POLL_TOTAL_TIME_US));
 
     if (!IsCmdExecuted) {
       ++RetryCount;
@@ -495,6 +572,191 @@ SdReceiveResponse (
   return EFI_SUCCESS;
 }
 
+/**
+  Move data between the caller's buffer and the SdHost FIFO by PIO,
+  as many words at a time as the EDM FIFO fill level allows.
+
+  @retval EFI_SUCCESS       All words were transferred.
+  @retval EFI_DEVICE_ERROR  The SdHost flagged a transfer error.
+  @retval EFI_TIMEOUT       The FIFO made no progress in time.
+**/
+STATIC EFI_STATUS
+SdHostPioTransfer (
+  IN     BOOLEAN  IsWrite,
+  IN     UINTN    NumWords,
+  IN OUT UINT32   *Buffer
+  )
+{
+  SDHOST_POLL Poll;
+  UINTN       WordIdx;
+  UINT32      Hsts;
+  UINT32      Words;
+
+  SdHostPollReset (&Poll);
+  WordIdx = 0;
+  while (WordIdx < NumWords) {
+    Words = SDHOST_EDM_FIFO_FILL (MmioRead32 (SDHOST_EDM));
+    if (IsWrite) {
+      Words = SDHOST_FIFO_WORDS - Words;
+    }
+
+    if (Words == 0) {
+      Hsts = MmioRead32 (SDHOST_HSTS);
+      if ((Hsts & SDHOST_HSTS_ERROR) != 0 ||
+          !SdHostPollWait (&Poll, FIFO_MIN_POLL_TOTAL_TIME_US)) {
+        DEBUG ((DEBUG_MMCHOST_SD_ERROR,
+          "SdHost: SdHostPioTransfer(): Block Word%d %a poll failed\n",
+          WordIdx, IsWrite ? "write" : "read"));
+        SdHostDumpStatus ();
+        MmioWrite32 (SDHOST_HSTS, SDHOST_HSTS_CLEAR);
+        return ((Hsts & SDHOST_HSTS_ERROR) != 0) ? EFI_DEVICE_ERROR : EFI_TIMEOUT;
+      }
+      continue;
+    }
+
+    for (; Words > 0 && WordIdx < NumWords; --Words, ++WordIdx) {
+      if (IsWrite) {
+        MmioWrite32 (SDHOST_DATA, Buffer[WordIdx]);
+      } else {
+        Buffer[WordIdx] = MmioRead32 (SDHOST_DATA);
+      }
+    }
+    SdHostPollReset (&Poll);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Move whole blocks between the caller's buffer and the SdHost FIFO
+  with the DMA engine, paced by the SdHost DREQ.
+
+  @retval EFI_SUCCESS       All data was transferred.
+  @retval EFI_UNSUPPORTED   The buffer could not be mapped, use PIO.
+  @retval EFI_DEVICE_ERROR  The SdHost or the DMA engine flagged an error.
+  @retval EFI_TIMEOUT       The transfer made no progress in time.
+**/
+STATIC EFI_STATUS
+SdHostDmaTransfer (
+  IN     BOOLEAN  IsWrite,
+  IN     UINTN    Length,
+  IN OUT UINT32   *Buffer
+  )
+{
+  EFI_STATUS            Status;
+  EFI_PHYSICAL_ADDRESS  BusAddress;
+  VOID                  *Mapping;
+  UINTN                 DmaLength;
+  UINTN                 MapLength;
+  SDHOST_POLL           Poll;
+  UINT32                Remaining;
+  UINT32                LastRemaining;
+  UINT32                Cs;
+  UINT32                Hsts;
+
+  DmaLength = Length;
+  if (!IsWrite) {
+    DmaLength -= SDHOST_DMA_READ_DRAIN_BYTES;
+  }
+
+  MapLength = DmaLength;
+  Status = DmaMap (IsWrite ? MapOperationBusMasterRead : MapOperationBusMasterWrite,
+             Buffer, &MapLength, &BusAddress, &Mapping);
+  if (EFI_ERROR (Status)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  if (MapLength != DmaLength) {
+    DmaUnmap (Mapping);
+    return EFI_UNSUPPORTED;
+  }
+
+  ZeroMem (mDmaCb, sizeof (*mDmaCb));
+  mDmaCb->TransferInfo = BCM2836_DMA_TI_PERMAP (SDHOST_DMA_DREQ) | BCM2836_DMA_TI_WAIT_RESP;
+  if (IsWrite) {
+    mDmaCb->TransferInfo |= BCM2836_DMA_TI_SRC_INC | BCM2836_DMA_TI_DEST_DREQ;
+    mDmaCb->SourceAddress = (UINT32)BusAddress;
+    mDmaCb->DestinationAddress = SDHOST_DATA_BUS_ADDRESS;
+  } else {
+    mDmaCb->TransferInfo |= BCM2836_DMA_TI_DEST_INC | BCM2836_DMA_TI_SRC_DREQ;
+    mDmaCb->SourceAddress = SDHOST_DATA_BUS_ADDRESS;
+    mDmaCb->DestinationAddress = (UINT32)BusAddress;
+  }
+  mDmaCb->TransferLength = (UINT32)DmaLength;
+  MemoryFence ();
+
+  MmioWrite32 (SDHOST_DMA_BASE_ADDRESS + BCM2836_DMA_CS_OFFSET, BCM2836_DMA_CS_RESET);
+  MmioWrite32 (SDHOST_DMA_BASE_ADDRESS + BCM2836_DMA_DEBUG_OFFSET, BCM2836_DMA_DEBUG_CLEAR_ERRORS);
+  MmioWrite32 (SDHOST_DMA_BASE_ADDRESS + BCM2836_DMA_CONBLK_AD_OFFSET, (UINT32)mDmaCbBusAddress);
+  MmioWrite32 (SDHOST_DMA_BASE_ADDRESS + BCM2836_DMA_CS_OFFSET,
+    BCM2836_DMA_CS_ACTIVE | BCM2836_DMA_CS_END | BCM2836_DMA_CS_WAIT_FOR_OUTSTANDING_WRITES);
+
+  // The timeout only runs while the transfer makes no progress
+  SdHostPollReset (&Poll);
+  LastRemaining = (UINT32)DmaLength;
+  for (;;) {
+    Cs = MmioRead32 (SDHOST_DMA_BASE_ADDRESS + BCM2836_DMA_CS_OFFSET);
+    if ((Cs & BCM2836_DMA_CS_ERROR) != 0) {
+      DEBUG ((DEBUG_MMCHOST_SD_ERROR, "SdHost: SdHostDmaTransfer(): DMA error, CS 0x%x DEBUG 0x%x\n",
+        Cs, MmioRead32 (SDHOST_DMA_BASE_ADDRESS + BCM2836_DMA_DEBUG_OFFSET)));
+      Status = EFI_DEVICE_ERROR;
+      break;
+    }
+
+    if ((Cs & BCM2836_DMA_CS_ACTIVE) == 0) {
+      Status = EFI_SUCCESS;
+      break;
+    }
+
+    Hsts = MmioRead32 (SDHOST_HSTS);
+    if ((Hsts & SDHOST_HSTS_ERROR) != 0) {
+      Status = EFI_DEVICE_ERROR;
+      break;
+    }
+
+    Remaining = MmioRead32 (SDHOST_DMA_BASE_ADDRESS + BCM2836_DMA_TXFR_LEN_OFFSET);
+    if (Remaining != LastRemaining) {
+      LastRemaining = Remaining;
+      SdHostPollReset (&Poll);
+    } else if (!SdHostPollWait (&Poll, FIFO_MIN_POLL_TOTAL_TIME_US)) {
+      Status = EFI_TIMEOUT;
+      break;
+    }
+  }
+
+  if (EFI_ERROR (Status)) {
+    MmioWrite32 (SDHOST_DMA_BASE_ADDRESS + BCM2836_DMA_CS_OFFSET, BCM2836_DMA_CS_RESET);
+  }
+  DmaUnmap (Mapping);
+
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_MMCHOST_SD_ERROR, "SdHost: SdHostDmaTransfer(): %a of 0x%x bytes failed: %r\n",
+      IsWrite ? "write" : "read", Length, Status));
+    SdHostDumpStatus ();
+    MmioWrite32 (SDHOST_HSTS, SDHOST_HSTS_CLEAR);
+    return Status;
+  }
+
+  if (!IsWrite) {
+    return SdHostPioTransfer (FALSE, (Length - DmaLength) / 4,
+             Buffer + DmaLength / 4);
+  }
+
+  // Let the FIFO drain to the card before the caller issues CMD12
+  SdHostPollReset (&Poll);
+  while (SDHOST_EDM_FIFO_FILL (MmioRead32 (SDHOST_EDM)) != 0) {
+    if ((MmioRead32 (SDHOST_HSTS) & SDHOST_HSTS_ERROR) != 0 ||
+        !SdHostPollWait (&Poll, FIFO_MIN_POLL_TOTAL_TIME_US)) {
+      DEBUG ((DEBUG_MMCHOST_SD_ERROR, "SdHost: SdHostDmaTransfer(): FIFO did not drain\n"));
+      SdHostDumpStatus ();
+      MmioWrite32 (SDHOST_HSTS, SDHOST_HSTS_CLEAR);
+      return EFI_DEVICE_ERROR;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
 STATIC EFI_STATUS
 SdReadBlockData (
   IN EFI_MMC_HOST_PROTOCOL    *This,
@@ -509,36 +771,16 @@ SdReadBlockData (
   ASSERT (Buffer != NULL);
   ASSERT (Length % 4 == 0);
 
-  EFI_STATUS Status = EFI_SUCCESS;
+  EFI_STATUS Status = EFI_UNSUPPORTED;
 
   mFwProtocol->SetLed (TRUE);
-  {
-    UINT32 NumWords = Length / 4;
-    UINT32 WordIdx;
-
-    for (WordIdx = 0; WordIdx < NumWords; ++WordIdx) {
-      UINT32 PollCount = 0;
-      while (PollCount < FIFO_MAX_POLL_COUNT) {
-        UINT32 Hsts = MmioRead32 (SDHOST_HSTS);
-        if ((Hsts & SDHOST_HSTS_DATA_FLAG) != 0) {
-          MmioWrite32 (SDHOST_HSTS, SDHOST_HSTS_DATA_FLAG);
-          Buffer[WordIdx] = MmioRead32 (SDHOST_DATA);
-          break;
-        }
-
-        ++PollCount;
-        gBS->Stall (CMD_STALL_AFTER_RETRY_US);
-      }
+  if (mDmaCb != NULL && Length >= SDHOST_BLOCK_BYTE_LENGTH &&
+      Length % SDHOST_BLOCK_BYTE_LENGTH == 0) {
+    Status = SdHostDmaTransfer (FALSE, Length, Buffer);
+  }
 
-      if (PollCount == FIFO_MAX_POLL_COUNT) {
-        DEBUG ((DEBUG_MMCHOST_SD_ERROR,
-            "SdHost: SdReadBlockData(): Block Word%d read poll timed-out\n", WordIdx));
-        SdHostDumpStatus ();
-        MmioWrite32 (SDHOST_HSTS, SDHOST_HSTS_CLEAR);
-        Status = EFI_TIMEOUT;
-        break;
-      }
-    }
+  if (Status == EFI_UNSUPPORTED) {
+    Status = SdHostPioTransfer (FALSE, Length / 4, Buffer);
   }
   mFwProtocol->SetLed (FALSE);
 
@@ -560,35 +802,15 @@ SdWriteBlockData (
   ASSERT (Buffer != NULL);
   ASSERT (Length % SDHOST_BLOCK_BYTE_LENGTH == 0);
 
-  EFI_STATUS Status = EFI_SUCCESS;
+  EFI_STATUS Status = EFI_UNSUPPORTED;
 
   mFwProtocol->SetLed (TRUE);
-  {
-    UINT32 NumWords = Length / 4;
-    UINT32 WordIdx;
-
-    for (WordIdx = 0; WordIdx < NumWords; ++WordIdx) {
-      UINT32 PollCount = 0;
-      while (PollCount < FIFO_MAX_POLL_COUNT) {
-        if (MmioRead32 (SDHOST_HSTS) & SDHOST_HSTS_DATA_FLAG) {
-          MmioWrite32 (SDHOST_HSTS, SDHOST_HSTS_DATA_FLAG);
-          MmioWrite32 (SDHOST_DATA, Buffer[WordIdx]);
-          break;
-        }
-
-        ++PollCount;
-        gBS->Stall (CMD_STALL_AFTER_RETRY_US);
-      }
+  if (mDmaCb != NULL) {
+    Status = SdHostDmaTransfer (TRUE, Length, Buffer);
+  }
 
-      if (PollCount == FIFO_MAX_POLL_COUNT) {
-        DEBUG ((DEBUG_MMCHOST_SD_ERROR,
-          "SdHost: SdWriteBlockData(): Block Word%d write poll timed-out\n", WordIdx));
-        SdHostDumpStatus ();
-        MmioWrite32 (SDHOST_HSTS, SDHOST_HSTS_CLEAR);
-        Status = EFI_TIMEOUT;
-        break;
-      }
-    }
+  if (Status == EFI_UNSUPPORTED) {
+    Status = SdHostPioTransfer (TRUE, Length / 4, Buffer);
   }
   mFwProtocol->SetLed (FALSE);
 
@@ -672,6 +894,13 @@ SdNotifyState (
     Hcfg |= SDHOST_HCFG_SLOW_CARD; // Use all bits of CDIV in DataMode
     MmioWrite32 (SDHOST_HCFG, Hcfg);
 
+    // FIFO fill levels at which the DMA DREQ is raised
+    MmioAndThenOr32 (SDHOST_EDM,
+      ~((SDHOST_EDM_THRESHOLD_MASK << SDHOST_EDM_READ_THRESHOLD_SHIFT) |
+        (SDHOST_EDM_THRESHOLD_MASK << SDHOST_EDM_WRITE_THRESHOLD_SHIFT)),
+      (SDHOST_DMA_FIFO_THRESHOLD << SDHOST_EDM_READ_THRESHOLD_SHIFT) |
+      (SDHOST_DMA_FIFO_THRESHOLD << SDHOST_EDM_WRITE_THRESHOLD_SHIFT));
+
     // Set default clock frequency
     EFI_STATUS Status = SdHostSetClockFrequency (IDENT_MODE_SD_CLOCK_FREQ_HZ);
     if (EFI_ERROR (Status)) {
@@ -802,6 +1031,36 @@ EFI_MMC_HOST_PROTOCOL gMmcHost =
     SdIsMultiBlock
   };
 
+STATIC EFI_STATUS
+SdHostDmaInitialize (
+  VOID
+  )
+{
+  EFI_STATUS Status;
+  UINTN      BufferSize;
+  VOID       *Buffer;
+
+  Status = DmaAllocateBuffer (EfiBootServicesData, 1, &Buffer);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  BufferSize = EFI_PAGES_TO_SIZE (1);
+  Status = DmaMap (MapOperationBusMasterCommonBuffer, Buffer, &BufferSize,
+             &mDmaCbBusAddress, &mDmaCbMapping);
+  if (EFI_ERROR (Status)) {
+    DmaFreeBuffer (1, Buffer);
+    return Status;
+  }
+
+  MmioOr32 (BCM2836_DMA_CTRL_BASE_ADDRESS + BCM2836_DMA_ENABLE_OFFSET,
+    1U << SDHOST_DMA_CHANNEL);
+  MmioWrite32 (SDHOST_DMA_BASE_ADDRESS + BCM2836_DMA_CS_OFFSET, BCM2836_DMA_CS_RESET);
+
+  mDmaCb = Buffer;
+  return EFI_SUCCESS;
+}
+
 EFI_STATUS
 SdHostInitialize (
   IN EFI_HANDLE          ImageHandle,
@@ -824,12 +1083,20 @@ SdHostInitialize (
 
   DEBUG ((DEBUG_MMCHOST_SD, "SdHost: Initialize\n"));
   DEBUG ((DEBUG_MMCHOST_SD, "Config:\n"));
-  DEBUG ((DEBUG_MMCHOST_SD, " - FIFO_MAX_POLL_COUNT=%d\n", FIFO_MAX_POLL_COUNT));
-  DEBUG ((DEBUG_MMCHOST_SD, " - CMD_STALL_AFTER_POLL_US=%dus\n", CMD_STALL_AFTER_POLL_US));
+  DEBUG ((DEBUG_MMCHOST_SD, " - FIFO_MIN_POLL_TOTAL_TIME_US=%dms\n", FIFO_MIN_POLL_TOTAL_TIME_US / 1000));
   DEBUG ((DEBUG_MMCHOST_SD, " - CMD_MIN_POLL_TOTAL_TIME_US=%dms\n", CMD_MIN_POLL_TOTAL_TIME_US / 1000));
-  DEBUG ((DEBUG_MMCHOST_SD, " - CMD_MAX_POLL_COUNT=%d\n", CMD_MAX_POLL_COUNT));
   DEBUG ((DEBUG_MMCHOST_SD, " - CMD_MAX_RETRY_COUNT=%d\n", CMD_MAX_RETRY_COUNT));
   DEBUG ((DEBUG_MMCHOST_SD, " - CMD_STALL_AFTER_RETRY_US=%dus\n", CMD_STALL_AFTER_RETRY_US));
+  DEBUG ((DEBUG_MMCHOST_SD, " - POLL_SPIN_COUNT=%d\n", POLL_SPIN_COUNT));
+  DEBUG ((DEBUG_MMCHOST_SD, " - SDHOST_DMA_CHANNEL=%d\n", SDHOST_DMA_CHANNEL));
+
+  //
+  // Without a control block for the DMA engine, fall back to PIO.
+  //
+  Status = SdHostDmaInitialize ();
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_MMCHOST_SD_INFO, "SdHost: DMA unavailable (%r), using PIO\n", Status));
+  }
 
   Status = gBS->InstallMultipleProtocolInterfaces (
     &Handle,
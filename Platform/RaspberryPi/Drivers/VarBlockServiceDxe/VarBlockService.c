@@ -86,6 +86,31 @@ EFI_FW_VOL_BLOCK_DEVICE mFvbDeviceTemplate = {
 };
 
 
+STATIC
+VOID
+VarStoreMarkDirty (
+  IN UINTN Address,
+  IN UINTN Length
+  )
+{
+  UINTN Chunk;
+  UINTN LastChunk;
+
+  if (Length == 0) {
+    return;
+  }
+
+  Chunk = (Address - mFvInstance->FvBase) >> mFvInstance->DirtyChunkShift;
+  LastChunk = (Address - mFvInstance->FvBase + Length - 1) >>
+                mFvInstance->DirtyChunkShift;
+  for (; Chunk <= LastChunk; Chunk++) {
+    mFvInstance->DirtyMap[Chunk / 8] |= (UINT8)(1 << (Chunk % 8));
+  }
+
+  mFvInstance->Dirty = TRUE;
+}
+
+
 EFI_STATUS
 VarStoreWrite (
   IN     UINTN Address,
@@ -94,7 +119,7 @@ VarStoreWrite (
   )
 {
   CopyMem ((VOID*)Address, Buffer, *NumBytes);
-  mFvInstance->Dirty = TRUE;
+  VarStoreMarkDirty (Address, *NumBytes);
 
   return EFI_SUCCESS;
 }
@@ -107,7 +132,7 @@ VarStoreErase (
   )
 {
   SetMem ((VOID*)Address, LbaLength, 0xff);
-  mFvInstance->Dirty = TRUE;
+  VarStoreMarkDirty (Address, LbaLength);
 
   return EFI_SUCCESS;
 }
@@ -843,6 +868,11 @@ FvbInitialize (
   mFvInstance->FvBase = (UINTN)BaseAddress;
   mFvInstance->FvLength = (UINTN)Length;
   mFvInstance->Offset = StartOffset;
+  mFvInstance->DirtyChunkShift = VAR_STORE_DIRTY_CHUNK_SHIFT;
+  while (((Length - 1) >> mFvInstance->DirtyChunkShift) >=
+         VAR_STORE_DIRTY_MAP_SIZE * 8) {
+    mFvInstance->DirtyChunkShift++;
+  }
   /*
    * Should I parse config.txt instead and find the real name?
    */
@@ -22,6 +22,17 @@
 #include <Protocol/BlockIo.h>
 #include <Protocol/LoadedImage.h>
 
+//
+// Changes to the variable store are tracked in chunks, so that only the
+// changed parts of the mapped file need to be written back. The chunk size
+// starts at 4 KB and grows if the store has more chunks than the map holds.
+//
+#define VAR_STORE_DIRTY_CHUNK_SHIFT     12
+#define VAR_STORE_DIRTY_MAP_SIZE        64
+
+#define VAR_STORE_CHUNK_IS_DIRTY(Instance, Chunk) \
+  (((Instance)->DirtyMap[(Chunk) / 8] & (1 << ((Chunk) % 8))) != 0)
+
 typedef struct {
   union {
     UINTN                      FvBase;
@@ -33,6 +44,8 @@ typedef struct {
   EFI_DEVICE_PATH_PROTOCOL   *Device;
   CHAR16                     *MappedFile;
   BOOLEAN                    Dirty;
+  UINTN                      DirtyChunkShift;
+  UINT8                      DirtyMap[VAR_STORE_DIRTY_MAP_SIZE];
 } EFI_FW_VOL_INSTANCE;
 
 extern EFI_FW_VOL_INSTANCE *mFvInstance;
@@ -8,6 +8,8 @@
  *
  **/
 
+#include <Library/BaseMemoryLib.h>
+
 #include "VarBlockService.h"
 
 //
@@ -130,14 +132,23 @@ InstallVirtualAddressChangeHandler (
 }
 
 
+//
+// Write the variable store back to the mapped file. Unless Full is set,
+// only the runs of chunks that changed since the last dump are written.
+//
 STATIC
 EFI_STATUS
 DoDump (
-  IN EFI_DEVICE_PATH_PROTOCOL *Device
+  IN EFI_DEVICE_PATH_PROTOCOL *Device,
+  IN BOOLEAN Full
   )
 {
   EFI_STATUS Status;
   EFI_FILE_PROTOCOL *File;
+  UINTN NumChunks;
+  UINTN Chunk;
+  UINTN End;
+  UINTN Start;
 
   Status = FileOpen (Device,
              mFvInstance->MappedFile,
@@ -148,10 +159,34 @@ DoDump (
     return Status;
   }
 
-  Status = FileWrite (File,
-             mFvInstance->Offset,
-             mFvInstance->FvBase,
-             mFvInstance->FvLength);
+  if (Full) {
+    Status = FileWrite (File,
+               mFvInstance->Offset,
+               mFvInstance->FvBase,
+               mFvInstance->FvLength);
+    FileClose (File);
+    return Status;
+  }
+
+  NumChunks = ((mFvInstance->FvLength - 1) >> mFvInstance->DirtyChunkShift) + 1;
+  for (Chunk = 0; Chunk < NumChunks && !EFI_ERROR (Status); Chunk = End) {
+    End = Chunk + 1;
+    if (!VAR_STORE_CHUNK_IS_DIRTY (mFvInstance, Chunk)) {
+      continue;
+    }
+
+    while (End < NumChunks && VAR_STORE_CHUNK_IS_DIRTY (mFvInstance, End)) {
+      End++;
+    }
+
+    Start = Chunk << mFvInstance->DirtyChunkShift;
+    Status = FileWrite (File,
+               mFvInstance->Offset + Start,
+               mFvInstance->FvBase + Start,
+               MIN (End << mFvInstance->DirtyChunkShift,
+                 mFvInstance->FvLength) - Start);
+  }
+
   FileClose (File);
   return Status;
 }
@@ -178,7 +213,7 @@ DumpVars (
     return;
   }
 
-  Status = DoDump (mFvInstance->Device);
+  Status = DoDump (mFvInstance->Device, FALSE);
   if (EFI_ERROR (Status)) {
     DEBUG ((DEBUG_ERROR, "Couldn't dump '%s'\n", mFvInstance->MappedFile));
     ASSERT_EFI_ERROR (Status);
@@ -198,6 +233,7 @@ DumpVars (
   }
 
   mFvInstance->Dirty = FALSE;
+  ZeroMem (mFvInstance->DirtyMap, sizeof (mFvInstance->DirtyMap));
 }
 
 
@@ -305,7 +341,11 @@ OnSimpleFileSystemInstall (
       continue;
     }
 
-    Status = DoDump (Device);
+    //
+    // Whatever the file on this device holds, bring all of it in line
+    // with the store in memory.
+    //
+    Status = DoDump (Device, TRUE);
     if (EFI_ERROR (Status)) {
       DEBUG ((DEBUG_ERROR, "Couldn't update '%s'\n", mFvInstance->MappedFile));
       ASSERT_EFI_ERROR (Status);
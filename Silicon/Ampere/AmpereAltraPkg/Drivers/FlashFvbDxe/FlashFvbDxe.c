@@ -6,6 +6,7 @@
 
 **/
 
+#include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/FlashLib.h>
 #include <Library/PcdLib.h>
@@ -250,8 +251,6 @@ FlashFvbDxeRead (
   IN OUT   UINT8                               *Buffer
   )
 {
-  EFI_STATUS Status;
-
   ASSERT (NumBytes != NULL);
   ASSERT (Buffer != NULL);
 
@@ -259,16 +258,16 @@ FlashFvbDxeRead (
     return EFI_BAD_BUFFER_SIZE;
   }
 
-  Status = FlashReadCommand (
-             mNvFlashBase + Lba * mFlashBlockSize + Offset,
-             Buffer,
-             *NumBytes
-             );
-
-  if (EFI_ERROR (Status)) {
-    DEBUG ((DEBUG_ERROR, "Failed to do flash read\n"));
-    return EFI_DEVICE_ERROR;
-  }
+  //
+  // The in-memory copy of the NV store is loaded from Flash by FlashPei and
+  // kept in step by Write() and EraseBlocks(), so there is no need to go
+  // to MM for reads.
+  //
+  CopyMem (
+    Buffer,
+    (VOID *)(UINTN)(mNvStorageBase + Lba * mFlashBlockSize + Offset),
+    *NumBytes
+    );
 
   return EFI_SUCCESS;
 }
@@ -361,6 +360,12 @@ FlashFvbDxeWrite (
     return EFI_DEVICE_ERROR;
   }
 
+  CopyMem (
+    (VOID *)(UINTN)(mNvStorageBase + Lba * mFlashBlockSize + Offset),
+    Buffer,
+    *NumBytes
+    );
+
   return Status;
 }
 
@@ -437,6 +442,15 @@ FlashFvbDxeErase (
                mNvFlashBase + Start * mFlashBlockSize,
                Length * mFlashBlockSize
                );
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+
+    SetMem (
+      (VOID *)(UINTN)(mNvStorageBase + Start * mFlashBlockSize),
+      Length * mFlashBlockSize,
+      0xFF
+      );
   }
 
   VA_END (Args);
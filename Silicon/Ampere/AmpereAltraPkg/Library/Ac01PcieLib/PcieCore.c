@@ -1171,13 +1171,90 @@ Ac01PcieCoreGetEndpointInfo (
   EnableDbiAccess (RootComplex, PcieIndex, FALSE);
 }
 
+/**
+  Put the controllers selected in ReInitMask into reset together, so that the
+  reset settle time is paid once for all of them, then re-initialize them and
+  restart their link training.
+
+  @param RootComplexList[in]  Pointer to the Root Complex list
+  @param ReInitMask[in]       Per Root Complex mask of the controllers to re-initialize
+**/
+STATIC
+VOID
+ReInitControllers (
+  IN AC01_ROOT_COMPLEX   *RootComplexList,
+  IN UINT8               *ReInitMask
+  )
+{
+  AC01_ROOT_COMPLEX      *RootComplex;
+  PHYSICAL_ADDRESS       TargetAddress;
+  BOOLEAN                ResetAsserted;
+  UINT8                  RCIndex;
+  UINT8                  PcieIndex;
+  UINT32                 Val;
+
+  ResetAsserted = FALSE;
+  for (RCIndex = 0; RCIndex < AC01_PCIE_MAX_ROOT_COMPLEX; RCIndex++) {
+    RootComplex = &RootComplexList[RCIndex];
+    for (PcieIndex = 0; PcieIndex < RootComplex->MaxPcieController; PcieIndex++) {
+      if ((ReInitMask[RCIndex] & PCIE_CONTROLLER_BIT (PcieIndex)) == 0) {
+        continue;
+      }
+
+      TargetAddress = RootComplex->Pcie[PcieIndex].CsrBase + AC01_PCIE_CORE_RESET_REG;
+      Val = MmioRead32 (TargetAddress);
+      if (!(Val & RESET_MASK)) {
+        Val = DWC_PCIE_SET (Val, ASSERT_RESET);
+        MmioWrite32 (TargetAddress, Val);
+        ResetAsserted = TRUE;
+      }
+    }
+  }
+
+  if (ResetAsserted) {
+    // Delay 50ms to ensure controllers finish their reset
+    MicroSecondDelay (50000);
+  }
+
+  //
+  // The controllers are in reset already, so Ac01PcieCoreSetupRC() does not
+  // wait again for each of them.
+  //
+  for (RCIndex = 0; RCIndex < AC01_PCIE_MAX_ROOT_COMPLEX; RCIndex++) {
+    RootComplex = &RootComplexList[RCIndex];
+    for (PcieIndex = 0; PcieIndex < RootComplex->MaxPcieController; PcieIndex++) {
+      if ((ReInitMask[RCIndex] & PCIE_CONTROLLER_BIT (PcieIndex)) == 0) {
+        continue;
+      }
+
+      DEBUG ((DEBUG_INFO, "PCIE%d.%d Start link re-initialization..\n", RootComplex->ID, PcieIndex));
+      Ac01PcieCoreSetupRC (RootComplex, TRUE, PcieIndex);
+    }
+  }
+}
+
+/**
+  Poll the controllers selected in PollMask until their link is up.
+
+  All the controllers share one LTSSM_TRANSITION_TIMEOUT deadline. The ones
+  whose link comes up are marked LinkUp and removed from PollMask, so only the
+  controllers which timed out are left in it on return.
+
+  @param RootComplexList[in]  Pointer to the Root Complex list
+  @param PollMask[in, out]    Per Root Complex mask of the controllers to poll
+**/
+STATIC
 VOID
 PollLinkUp (
-  IN AC01_ROOT_COMPLEX   *RootComplex,
-  IN UINT8               PcieIndex
+  IN     AC01_ROOT_COMPLEX   *RootComplexList,
+  IN OUT UINT8               *PollMask
   )
 {
-  UINT32        TimeOut;
+  AC01_ROOT_COMPLEX   *RootComplex;
+  BOOLEAN             Pending;
+  INT32               TimeOut;
+  UINT8               RCIndex;
+  UINT8               PcieIndex;
 
   // Poll until link up
   // This checking for linkup status and
@@ -1186,119 +1263,188 @@ PollLinkUp (
   // the state transition is completed
   TimeOut = LTSSM_TRANSITION_TIMEOUT;
   do {
-    if (PcieLinkUpCheck (&RootComplex->Pcie[PcieIndex])) {
-      DEBUG ((
-        DEBUG_INFO,
-        "\tPCIE%d.%d LinkStat is correct after soft reset, transition time: %d\n",
-        RootComplex->ID,
-        PcieIndex,
-        TimeOut
-        ));
-      RootComplex->Pcie[PcieIndex].LinkUp = TRUE;
-      break;
+    Pending = FALSE;
+    for (RCIndex = 0; RCIndex < AC01_PCIE_MAX_ROOT_COMPLEX; RCIndex++) {
+      RootComplex = &RootComplexList[RCIndex];
+      for (PcieIndex = 0; PcieIndex < RootComplex->MaxPcieController; PcieIndex++) {
+        if ((PollMask[RCIndex] & PCIE_CONTROLLER_BIT (PcieIndex)) == 0) {
+          continue;
+        }
+
+        if (!PcieLinkUpCheck (&RootComplex->Pcie[PcieIndex])) {
+          Pending = TRUE;
+          continue;
+        }
+
+        DEBUG ((
+          DEBUG_INFO,
+          "\tPCIE%d.%d LinkStat is correct after soft reset, transition time: %d\n",
+          RootComplex->ID,
+          PcieIndex,
+          LTSSM_TRANSITION_TIMEOUT - TimeOut
+          ));
+        DEBUG ((DEBUG_INFO, "PCIE%d.%d Link re-initialization passed!\n", RootComplex->ID, PcieIndex));
+        RootComplex->Pcie[PcieIndex].LinkUp = TRUE;
+        PollMask[RCIndex] &= ~PCIE_CONTROLLER_BIT (PcieIndex);
+      }
+    }
+
+    if (!Pending) {
+      return;
     }
 
     MicroSecondDelay (100);
     TimeOut -= 100;
   } while (TimeOut > 0);
 
-  if (TimeOut <= 0) {
-    DEBUG ((DEBUG_ERROR, "\tPCIE%d.%d LinkStat TIMEOUT after re-init\n", RootComplex->ID, PcieIndex));
-  } else {
-    DEBUG ((DEBUG_INFO, "PCIE%d.%d Link re-initialization passed!\n", RootComplex->ID, PcieIndex));
+  for (RCIndex = 0; RCIndex < AC01_PCIE_MAX_ROOT_COMPLEX; RCIndex++) {
+    RootComplex = &RootComplexList[RCIndex];
+    for (PcieIndex = 0; PcieIndex < RootComplex->MaxPcieController; PcieIndex++) {
+      if ((PollMask[RCIndex] & PCIE_CONTROLLER_BIT (PcieIndex)) != 0) {
+        DEBUG ((DEBUG_ERROR, "\tPCIE%d.%d LinkStat TIMEOUT after re-init\n", RootComplex->ID, PcieIndex));
+      }
+    }
   }
 }
 
 /**
-  Check active PCIe controllers of RootComplex, retrain or soft reset if needed
+  Check the links of the controllers selected in CheckMask, soft reset them if needed.
 
-  @param RootComplex[in]  Pointer to AC01_ROOT_COMPLEX structure
-  @param PcieIndex[in]    PCIe controller index
+  The links of all Root Complexes are handled together: the RAS DES counters
+  of every link are armed, a single evaluation window is waited, then the
+  counters of every link are read back. The failing links are soft reset
+  together and polled against a shared deadline before the next round.
 
-  @retval                 -1: Link recovery had failed
-                          1: Link width and speed are not correct
-                          0: Link recovery succeed
+  @param RootComplexList[in]  Pointer to the Root Complex list
+  @param CheckMask[in]        Per Root Complex mask of the controllers whose link is up
 **/
-INT32
+STATIC
+VOID
 Ac01PcieCoreQoSLinkCheckRecovery (
-  IN AC01_ROOT_COMPLEX   *RootComplex,
-  IN UINT8               PcieIndex
+  IN AC01_ROOT_COMPLEX   *RootComplexList,
+  IN UINT8               *CheckMask
   )
 {
-  INT32       LinkStatusCheck, RasdesChecking;
-  INT32       NumberOfReset = MAX_REINIT;
-  UINT8       EpMaxWidth, EpMaxGen;
+  AC01_PCIE_CONTROLLER   *Pcie;
+  AC01_ROOT_COMPLEX      *RootComplex;
+  BOOLEAN                Armed;
+  BOOLEAN                ReInitNeeded;
+  INT32                  LinkStatusCheck, RasdesChecking;
+  INT32                  NumberOfReset = MAX_REINIT;
+  UINT8                  EpMaxWidth, EpMaxGen;
+  UINT8                  LinkCheckFailed[AC01_PCIE_MAX_ROOT_COMPLEX];
+  UINT8                  Pending[AC01_PCIE_MAX_ROOT_COMPLEX];
+  UINT8                  ReInitMask[AC01_PCIE_MAX_ROOT_COMPLEX];
+  UINT8                  RCIndex;
+  UINT8                  PcieIndex;
 
-  // PCIe controller is not active or Link is not up
-  // Nothing to be done
-  if ((!RootComplex->Pcie[PcieIndex].Active) || (!RootComplex->Pcie[PcieIndex].LinkUp)) {
-    return LINK_CHECK_WRONG_PARAMETER;
+  for (RCIndex = 0; RCIndex < AC01_PCIE_MAX_ROOT_COMPLEX; RCIndex++) {
+    Pending[RCIndex] = CheckMask[RCIndex];
   }
 
   do {
-    if (RootComplex->Pcie[PcieIndex].LinkUp) {
-      // Enable all of RASDES register to detect any training error
-      Ac01PFACommand (RootComplex, PcieIndex, PFA_MODE_ENABLE);
+    Armed = FALSE;
+    for (RCIndex = 0; RCIndex < AC01_PCIE_MAX_ROOT_COMPLEX; RCIndex++) {
+      RootComplex = &RootComplexList[RCIndex];
+      LinkCheckFailed[RCIndex] = 0;
+      for (PcieIndex = 0; PcieIndex < RootComplex->MaxPcieController; PcieIndex++) {
+        if (((Pending[RCIndex] & PCIE_CONTROLLER_BIT (PcieIndex)) == 0)
+            || !RootComplex->Pcie[PcieIndex].LinkUp) {
+          continue;
+        }
 
-      // Accessing Endpoint and checking current link capabilities
-      Ac01PcieCoreGetEndpointInfo (RootComplex, PcieIndex, &EpMaxWidth, &EpMaxGen);
-      LinkStatusCheck = Ac01PcieCoreLinkCheck (RootComplex, PcieIndex, EpMaxWidth, EpMaxGen);
+        // Enable all of RASDES register to detect any training error
+        Ac01PFACommand (RootComplex, PcieIndex, PFA_MODE_ENABLE);
+
+        // Accessing Endpoint and checking current link capabilities
+        Ac01PcieCoreGetEndpointInfo (RootComplex, PcieIndex, &EpMaxWidth, &EpMaxGen);
+        LinkStatusCheck = Ac01PcieCoreLinkCheck (RootComplex, PcieIndex, EpMaxWidth, EpMaxGen);
+        if (LinkStatusCheck == LINK_CHECK_FAILED) {
+          LinkCheckFailed[RCIndex] |= PCIE_CONTROLLER_BIT (PcieIndex);
+        }
+
+        Armed = TRUE;
+      }
+    }
 
-      // Delay to allow the link to perform internal operation and generate
+    if (Armed) {
+      // Delay to allow the links to perform internal operation and generate
       // any error status update. This allows detection of any error observed
       // during initial link training. Possible evaluation time can be
       // between 100ms to 200ms.
       MicroSecondDelay (100000);
+    }
 
-      // Check for error
-      RasdesChecking = Ac01PFACommand (RootComplex, PcieIndex, PFA_MODE_READ);
+    ReInitNeeded = FALSE;
+    for (RCIndex = 0; RCIndex < AC01_PCIE_MAX_ROOT_COMPLEX; RCIndex++) {
+      RootComplex = &RootComplexList[RCIndex];
+      ReInitMask[RCIndex] = 0;
+      for (PcieIndex = 0; PcieIndex < RootComplex->MaxPcieController; PcieIndex++) {
+        if ((Pending[RCIndex] & PCIE_CONTROLLER_BIT (PcieIndex)) == 0) {
+          continue;
+        }
 
-      // Clear error counter
-      Ac01PFACommand (RootComplex, PcieIndex, PFA_MODE_CLEAR);
+        Pcie = &RootComplex->Pcie[PcieIndex];
+        if (Pcie->LinkUp) {
+          // Check for error
+          RasdesChecking = Ac01PFACommand (RootComplex, PcieIndex, PFA_MODE_READ);
+
+          // Clear error counter
+          Ac01PFACommand (RootComplex, PcieIndex, PFA_MODE_CLEAR);
+
+          // If link check functions return passed, then this link is done
+          // else go to soft reset
+          if (((LinkCheckFailed[RCIndex] & PCIE_CONTROLLER_BIT (PcieIndex)) == 0) &&
+              RasdesChecking != LINK_CHECK_FAILED &&
+              PcieLinkUpCheck (Pcie))
+          {
+            Pending[RCIndex] &= ~PCIE_CONTROLLER_BIT (PcieIndex);
+            continue;
+          }
 
-      // If link check functions return passed, then breaking out
-      // else go to soft reset
-      if (LinkStatusCheck != LINK_CHECK_FAILED &&
-          RasdesChecking != LINK_CHECK_FAILED &&
-          PcieLinkUpCheck (&RootComplex->Pcie[PcieIndex]))
-      {
-        return LINK_CHECK_SUCCESS;
+          Pcie->LinkUp = FALSE;
+        }
+
+        ReInitMask[RCIndex] |= PCIE_CONTROLLER_BIT (PcieIndex);
+        ReInitNeeded = TRUE;
       }
+    }
 
-      RootComplex->Pcie[PcieIndex].LinkUp = FALSE;
+    if (!ReInitNeeded) {
+      break;
     }
 
     // Trigger controller soft reset
-    DEBUG ((DEBUG_INFO, "PCIE%d.%d Start link re-initialization..\n", RootComplex->ID, PcieIndex));
-    Ac01PcieCoreSetupRC (RootComplex, TRUE, PcieIndex);
+    ReInitControllers (RootComplexList, ReInitMask);
 
-    PollLinkUp (RootComplex, PcieIndex);
+    PollLinkUp (RootComplexList, ReInitMask);
 
     NumberOfReset--;
   } while (NumberOfReset > 0);
-
-  return LINK_CHECK_SUCCESS;
 }
 
+/**
+  Find the controllers of a Root Complex whose link has come up.
+
+  @param RootComplex[in]          Pointer to AC01_ROOT_COMPLEX structure
+  @param IsNextRoundNeeded[out]   Whether another round of polling is needed
+  @param LinkUpMask[out]          Mask of the controllers whose link has come up
+**/
+STATIC
 VOID
 Ac01PcieCoreUpdateLink (
   IN  AC01_ROOT_COMPLEX *RootComplex,
   OUT BOOLEAN           *IsNextRoundNeeded,
-  OUT INT8              *FailedPciePtr,
-  OUT INT8              *FailedPcieCount
+  OUT UINT8             *LinkUpMask
   )
 {
   AC01_PCIE_CONTROLLER      *Pcie;
   PHYSICAL_ADDRESS          CfgBase;
   UINT8                     PcieIndex;
-  UINT32                    Index;
   UINT32                    Val;
 
   *IsNextRoundNeeded = FALSE;
-  *FailedPcieCount   = 0;
-  for (Index = 0; Index < MaxPcieControllerOfRootComplexB; Index++) {
-    FailedPciePtr[Index] = -1;
-  }
+  *LinkUpMask        = 0;
 
   if (!RootComplex->Active) {
     return;
@@ -1325,19 +1471,9 @@ Ac01PcieCoreUpdateLink (
           CAP_LINK_SPEED_GET (Val)
           ));
 
-        // Doing link checking and recovery if needed
-        Ac01PcieCoreQoSLinkCheckRecovery (RootComplex, PcieIndex);
-
-        // Link timeout after 32ms
-        SetLinkTimeout (RootComplex, PcieIndex, 32);
-
-        // Un-mask Completion Timeout
-        DisableCompletionTimeOut (RootComplex, PcieIndex, FALSE);
-
+        *LinkUpMask |= PCIE_CONTROLLER_BIT (PcieIndex);
       } else {
         *IsNextRoundNeeded = FALSE;
-        FailedPciePtr[*FailedPcieCount] = PcieIndex;
-        *FailedPcieCount += 1;
       }
     }
   }
@@ -1353,13 +1489,14 @@ Ac01PcieCorePostSetupRC (
   IN AC01_ROOT_COMPLEX *RootComplexList
   )
 {
-  UINT8   RCIndex, Idx;
+  AC01_ROOT_COMPLEX *RootComplex;
+  UINT8   RCIndex, PcieIndex;
   BOOLEAN IsNextRoundNeeded, NextRoundNeeded;
   UINT64  PrevTick, CurrTick, ElapsedCycle;
   UINT64  TimerTicks64;
   UINT8   ReInit;
-  INT8    FailedPciePtr[MaxPcieControllerOfRootComplexB];
-  INT8    FailedPcieCount;
+  UINT8   LinkUpMask[AC01_PCIE_MAX_ROOT_COMPLEX];
+  UINT8   FailedMask[AC01_PCIE_MAX_ROOT_COMPLEX];
 
   ReInit = 0;
 
@@ -1384,33 +1521,54 @@ _link_polling:
   } while (ElapsedCycle < TimerTicks64);
 
   for (RCIndex = 0; RCIndex < AC01_PCIE_MAX_ROOT_COMPLEX; RCIndex++) {
-    Ac01PcieCoreUpdateLink (&RootComplexList[RCIndex], &IsNextRoundNeeded, FailedPciePtr, &FailedPcieCount);
+    Ac01PcieCoreUpdateLink (&RootComplexList[RCIndex], &IsNextRoundNeeded, &LinkUpMask[RCIndex]);
     if (IsNextRoundNeeded) {
       NextRoundNeeded = TRUE;
     }
   }
 
+  // Doing link checking and recovery if needed, for all Root Complexes at once
+  Ac01PcieCoreQoSLinkCheckRecovery (RootComplexList, LinkUpMask);
+
+  for (RCIndex = 0; RCIndex < AC01_PCIE_MAX_ROOT_COMPLEX; RCIndex++) {
+    RootComplex = &RootComplexList[RCIndex];
+    for (PcieIndex = 0; PcieIndex < RootComplex->MaxPcieController; PcieIndex++) {
+      if ((LinkUpMask[RCIndex] & PCIE_CONTROLLER_BIT (PcieIndex)) == 0) {
+        continue;
+      }
+
+      // Link timeout after 32ms
+      SetLinkTimeout (RootComplex, PcieIndex, 32);
+
+      // Un-mask Completion Timeout
+      DisableCompletionTimeOut (RootComplex, PcieIndex, FALSE);
+    }
+  }
+
   if (NextRoundNeeded && ReInit < MAX_REINIT) {
     //
     // Timer is up. Give another chance to re-program controller
     //
     ReInit++;
     for (RCIndex = 0; RCIndex < AC01_PCIE_MAX_ROOT_COMPLEX; RCIndex++) {
-      Ac01PcieCoreUpdateLink (&RootComplexList[RCIndex], &IsNextRoundNeeded, FailedPciePtr, &FailedPcieCount);
-      if (IsNextRoundNeeded) {
-        for (Idx = 0; Idx < FailedPcieCount; Idx++) {
-          if (FailedPciePtr[Idx] == -1) {
-            continue;
-          }
+      RootComplex = &RootComplexList[RCIndex];
+      FailedMask[RCIndex] = 0;
+      if (!RootComplex->Active) {
+        continue;
+      }
 
-          //
-          // Some controller still observes link-down. Re-init controller
-          //
-          Ac01PcieCoreSetupRC (&RootComplexList[RCIndex], TRUE, FailedPciePtr[Idx]);
+      for (PcieIndex = 0; PcieIndex < RootComplex->MaxPcieController; PcieIndex++) {
+        //
+        // Some controller still observes link-down. Re-init controller
+        //
+        if (RootComplex->Pcie[PcieIndex].Active && !RootComplex->Pcie[PcieIndex].LinkUp) {
+          FailedMask[RCIndex] |= PCIE_CONTROLLER_BIT (PcieIndex);
         }
       }
     }
 
+    ReInitControllers (RootComplexList, FailedMask);
+
     goto _link_polling;
   }
 }
@@ -23,6 +23,8 @@
 
 #define MAX_REINIT                       3      // Number of soft reset retry
 
+#define PCIE_CONTROLLER_BIT(PcieIndex)   (1 << (PcieIndex))
+
 #define SLOT_POWER_LIMIT_75W             75     // Watt
 
 #define LINK_CHECK_SUCCESS               0
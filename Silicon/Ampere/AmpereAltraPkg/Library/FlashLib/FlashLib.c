@@ -12,6 +12,7 @@
 #include <Library/DebugLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/MmCommunicationLib.h>
+#include <Library/PcdLib.h>
 
 #include "FlashLibCommon.h"
 
@@ -26,7 +27,7 @@ FlashLibConstructor (
   VOID
   )
 {
-  gFlashLibPhysicalBuffer = AllocateZeroPool (EFI_MM_MAX_TMP_BUF_SIZE);
+  gFlashLibPhysicalBuffer = AllocatePages (EFI_SIZE_TO_PAGES (FLASH_LIB_TRANSFER_SIZE));
   gFlashLibVirtualBuffer = gFlashLibPhysicalBuffer;
   ASSERT (gFlashLibPhysicalBuffer != NULL);
 
@@ -12,6 +12,7 @@
 #include <Library/DebugLib.h>
 #include <Library/FlashLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
 
 #include "FlashLibCommon.h"
 
@@ -19,6 +20,51 @@ BOOLEAN                       gFlashLibRuntime = FALSE;
 UINT8                         *gFlashLibPhysicalBuffer;
 UINT8                         *gFlashLibVirtualBuffer;
 
+STATIC UINT32                 mFlashLibTransferSize = FLASH_LIB_TRANSFER_SIZE;
+
+/**
+  Fall back to the safe transfer size if the MM transport or the SPI-NOR
+  service failed a request larger than it.
+
+  @param[in] Status              Status of the MM request.
+  @param[in] ResStatus           Status returned by the SPI-NOR service.
+  @param[in] Size                Number of bytes of the MM request.
+
+  @retval TRUE                   The request must be retried in smaller pieces.
+  @retval FALSE                  The request didn't fail, or not for its size.
+**/
+STATIC
+BOOLEAN
+FlashTransferSizeRejected (
+  IN EFI_STATUS Status,
+  IN UINT64     ResStatus,
+  IN UINTN      Size
+  )
+{
+  if (Size <= EFI_MM_MAX_TMP_BUF_SIZE) {
+    return FALSE;
+  }
+
+  if (EFI_ERROR (Status)) {
+    if (Status != EFI_INVALID_PARAMETER && Status != EFI_BAD_BUFFER_SIZE) {
+      return FALSE;
+    }
+  } else if (ResStatus == MM_SPINOR_RES_SUCCESS) {
+    return FALSE;
+  }
+
+  DEBUG ((
+    DEBUG_WARN,
+    "%a: 0x%lx byte request rejected, using 0x%x byte requests\n",
+    __FUNCTION__,
+    Size,
+    EFI_MM_MAX_TMP_BUF_SIZE
+    ));
+  mFlashLibTransferSize = EFI_MM_MAX_TMP_BUF_SIZE;
+
+  return TRUE;
+}
+
 /**
   Convert Virtual Address to Physical Address at Runtime.
 
@@ -278,7 +324,7 @@ FlashWriteCommand (
 
   Remain = Length;
   while (Remain > 0) {
-    NumWrite = (Remain > EFI_MM_MAX_TMP_BUF_SIZE) ? EFI_MM_MAX_TMP_BUF_SIZE : Remain;
+    NumWrite = (Remain > mFlashLibTransferSize) ? mFlashLibTransferSize : Remain;
 
     MmData[0] = MM_SPINOR_FUNC_WRITE;
     MmData[1] = ByteAddress + Count;
@@ -291,6 +337,9 @@ FlashWriteCommand (
               &MmSpiNorRes,
               sizeof (MmSpiNorRes)
               );
+    if (FlashTransferSizeRejected (Status, MmSpiNorRes.Status, NumWrite)) {
+      continue;
+    }
     if (EFI_ERROR (Status)) {
       return Status;
     }
@@ -338,12 +387,16 @@ FlashReadCommand (
 
   Remain = Length;
   while (Remain > 0) {
-    NumRead = (Remain > EFI_MM_MAX_TMP_BUF_SIZE) ? EFI_MM_MAX_TMP_BUF_SIZE : Remain;
+    NumRead = (Remain > mFlashLibTransferSize) ? mFlashLibTransferSize : Remain;
 
     MmData[0] = MM_SPINOR_FUNC_READ;
     MmData[1] = ByteAddress + Count;
     MmData[2] = NumRead;
-    MmData[3] = (UINT64)gFlashLibPhysicalBuffer;  // Read data into the temp buffer with specified virtual address
+    if (gFlashLibRuntime) {
+      MmData[3] = (UINT64)gFlashLibPhysicalBuffer;  // Read data into the temp buffer with specified virtual address
+    } else {
+      MmData[3] = (UINT64)(Buffer + Count);         // Buffers are identity mapped, read straight into the caller's
+    }
 
     Status = FlashMmCommunicate (
               MmData,
@@ -351,6 +404,9 @@ FlashReadCommand (
               &MmSpiNorRes,
               sizeof (MmSpiNorRes)
               );
+    if (FlashTransferSizeRejected (Status, MmSpiNorRes.Status, NumRead)) {
+      continue;
+    }
     if (EFI_ERROR (Status)) {
       return Status;
     }
@@ -363,7 +419,9 @@ FlashReadCommand (
     //
     // Get data from the virtual address of the temp buffer.
     //
-    CopyMem ((VOID *)(Buffer + Count), (VOID *)gFlashLibVirtualBuffer, NumRead);
+    if (gFlashLibRuntime) {
+      CopyMem ((VOID *)(Buffer + Count), (VOID *)gFlashLibVirtualBuffer, NumRead);
+    }
     Remain -= NumRead;
     Count += NumRead;
   }
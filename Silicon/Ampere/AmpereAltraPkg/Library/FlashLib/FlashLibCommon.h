@@ -9,7 +9,23 @@
 #ifndef FLASH_LIB_COMMON_H_
 #define FLASH_LIB_COMMON_H_
 
+//
+// Transfer size every SPI-NOR MM service is known to accept.
+//
 #define EFI_MM_MAX_TMP_BUF_SIZE           0x1000
+
+//
+// Transfer size tried when PcdFlashMmLargeTransferEnable is set: a whole
+// 64 KB NOR sector. A service rejecting it is used in
+// EFI_MM_MAX_TMP_BUF_SIZE pieces instead.
+//
+#define EFI_MM_MAX_XFER_BUF_SIZE          0x10000
+
+//
+// Size of the staging window, and of the first transfer tried
+//
+#define FLASH_LIB_TRANSFER_SIZE           (FixedPcdGetBool (PcdFlashMmLargeTransferEnable) ? \
+                                           EFI_MM_MAX_XFER_BUF_SIZE : EFI_MM_MAX_TMP_BUF_SIZE)
 #define EFI_MM_MAX_PAYLOAD_SIZE           0x50
 
 #define MM_SPINOR_FUNC_GET_INFO           0x00
@@ -11,6 +11,7 @@
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiRuntimeServicesTableLib.h>
 #include <Protocol/MmCommunication2.h>
@@ -58,7 +59,7 @@ FlashLibConstructor (
   EFI_EVENT  VirtualAddressChangeEvent = NULL;
   EFI_STATUS Status;
 
-  gFlashLibPhysicalBuffer = AllocateRuntimeZeroPool (EFI_MM_MAX_TMP_BUF_SIZE);
+  gFlashLibPhysicalBuffer = AllocateRuntimePages (EFI_SIZE_TO_PAGES (FLASH_LIB_TRANSFER_SIZE));
   gFlashLibVirtualBuffer = gFlashLibPhysicalBuffer;
   ASSERT (gFlashLibPhysicalBuffer != NULL);
 
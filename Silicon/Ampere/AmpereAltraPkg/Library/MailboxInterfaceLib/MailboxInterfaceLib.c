@@ -51,6 +51,17 @@
 #define DB_STATUS_AVAIL_BIT       BIT16
 #define DB_STATUS_ACK_BIT         BIT0
 
+//
+// The SMpro/PMpro normally answer within a few microseconds, far below
+// MAILBOX_POLL_INTERVAL_US. Spin on the status at a fine interval first,
+// and take the time spent spinning out of the slow poll so the overall
+// timeout stays MAILBOX_POLL_TIMEOUT_US.
+//
+#define MAILBOX_SPIN_INTERVAL_US  1
+#define MAILBOX_SPIN_COUNT        1000
+#define MAILBOX_SLOW_POLL_COUNT   \
+        (MAILBOX_POLL_COUNT - (MAILBOX_SPIN_COUNT * MAILBOX_SPIN_INTERVAL_US) / MAILBOX_POLL_INTERVAL_US)
+
 /**
   Get the base address of a doorbell.
 
@@ -125,6 +136,48 @@ MailboxGetDoorbellInterruptNumber (
   return DoorbellInterruptNumber;
 }
 
+/**
+  Wait for a status bit of a doorbell to be set.
+
+  The status is polled every MAILBOX_SPIN_INTERVAL_US for the first
+  MAILBOX_SPIN_COUNT polls, then every MAILBOX_POLL_INTERVAL_US for the rest
+  of MAILBOX_POLL_TIMEOUT_US.
+
+  @param[in]  DoorbellAddress   The base address of the doorbell.
+  @param[in]  StatusBit         The status bit to wait for.
+
+  @retval EFI_SUCCESS           The status bit is set.
+  @retval EFI_TIMEOUT           Timeout occurred when waiting for the status bit.
+**/
+STATIC
+EFI_STATUS
+MailboxWaitStatus (
+  IN UINTN  DoorbellAddress,
+  IN UINT32 StatusBit
+  )
+{
+  UINTN TimeoutCount;
+
+  for (TimeoutCount = 0; TimeoutCount < MAILBOX_SPIN_COUNT; TimeoutCount++) {
+    if ((MmioRead32 (DoorbellAddress + DB_STATUS_REG_OFST) & StatusBit) != 0) {
+      return EFI_SUCCESS;
+    }
+
+    MicroSecondDelay (MAILBOX_SPIN_INTERVAL_US);
+  }
+
+  TimeoutCount = MAILBOX_SLOW_POLL_COUNT;
+
+  while ((MmioRead32 (DoorbellAddress + DB_STATUS_REG_OFST) & StatusBit) == 0) {
+    MicroSecondDelay (MAILBOX_POLL_INTERVAL_US);
+    if (--TimeoutCount == 0) {
+      return EFI_TIMEOUT;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
 /**
   Read a message via the hardware Doorbell interface.
 
@@ -144,8 +197,8 @@ MailboxRead (
   OUT MAILBOX_MESSAGE_DATA *Message
   )
 {
-  UINTN TimeoutCount;
-  UINTN DoorbellAddress;
+  EFI_STATUS Status;
+  UINTN      DoorbellAddress;
 
   if (Socket >= GetNumberOfActiveSockets ()
       || Doorbell >= NUMBER_OF_DOORBELLS_PER_SOCKET
@@ -154,19 +207,15 @@ MailboxRead (
     return EFI_INVALID_PARAMETER;
   }
 
-  TimeoutCount = MAILBOX_POLL_COUNT;
-
   DoorbellAddress = MailboxGetDoorbellAddress (Socket, Doorbell);
   ASSERT (DoorbellAddress != 0);
 
   //
   // Polling Doorbell status
   //
-  while ((MmioRead32 ((DoorbellAddress + DB_STATUS_REG_OFST)) & DB_STATUS_AVAIL_BIT) == 0) {
-    MicroSecondDelay (MAILBOX_POLL_INTERVAL_US);
-    if (--TimeoutCount == 0) {
-      return EFI_TIMEOUT;
-    }
+  Status = MailboxWaitStatus (DoorbellAddress, DB_STATUS_AVAIL_BIT);
+  if (EFI_ERROR (Status)) {
+    return Status;
   }
 
   Message->ExtendedData[0] = MmioRead32 (DoorbellAddress + DB_DIN0_REG_OFST);
@@ -200,8 +249,8 @@ MailboxWrite (
   IN MAILBOX_MESSAGE_DATA *Message
   )
 {
-  UINTN TimeoutCount;
-  UINTN DoorbellAddress;
+  EFI_STATUS Status;
+  UINTN      DoorbellAddress;
 
   if (Socket >= GetNumberOfActiveSockets ()
       || Doorbell >= NUMBER_OF_DOORBELLS_PER_SOCKET
@@ -210,8 +259,6 @@ MailboxWrite (
     return EFI_INVALID_PARAMETER;
   }
 
-  TimeoutCount = MAILBOX_POLL_COUNT;
-
   DoorbellAddress = MailboxGetDoorbellAddress (Socket, Doorbell);
   ASSERT (DoorbellAddress != 0);
 
@@ -232,11 +279,9 @@ MailboxWrite (
   //
   // Wait for ACK
   //
-  while ((MmioRead32 (DoorbellAddress + DB_STATUS_REG_OFST) & DB_STATUS_ACK_BIT) == 0) {
-    MicroSecondDelay (MAILBOX_POLL_INTERVAL_US);
-    if (--TimeoutCount == 0) {
-      return EFI_TIMEOUT;
-    }
+  Status = MailboxWaitStatus (DoorbellAddress, DB_STATUS_ACK_BIT);
+  if (EFI_ERROR (Status)) {
+    return Status;
   }
 
   //
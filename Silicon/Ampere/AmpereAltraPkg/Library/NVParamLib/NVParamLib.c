@@ -11,9 +11,54 @@
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/MmCommunicationLib.h>
+#include <Library/PcdLib.h>
 
 #include "NVParamLibCommon.h"
 
+//
+// Nothing but this firmware changes the NVParams before the OS runs, so
+// boot-time modules can serve repeated reads from the cache. Each module
+// has its own cache; a module changing a NVParam advances
+// PcdNVParamGeneration, which makes every other module drop its cache.
+//
+CONST BOOLEAN mNVParamCacheEnabled = TRUE;
+
+/**
+  Get the NVParam generation shared by all the modules of this boot.
+
+  @return The current generation.
+**/
+UINT32
+NVParamGetGeneration (
+  VOID
+  )
+{
+  return PcdGet32 (PcdNVParamGeneration);
+}
+
+/**
+  Advance the NVParam generation shared by all the modules of this boot,
+  so that their caches are dropped on the next NVParamGet ().
+
+  @return The new generation.
+**/
+UINT32
+NVParamNextGeneration (
+  VOID
+  )
+{
+  EFI_STATUS Status;
+  UINT32     Generation;
+
+  Generation = PcdGet32 (PcdNVParamGeneration) + 1;
+  Status = PcdSet32S (PcdNVParamGeneration, Generation);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_WARN, "%a: Failed to update the NVParam generation - %r\n", __FUNCTION__, Status));
+  }
+
+  return Generation;
+}
+
 /**
   Provides an interface to access the NVParam services via MM interface.
 
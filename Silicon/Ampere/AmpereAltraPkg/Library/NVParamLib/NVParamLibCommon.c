@@ -15,6 +15,123 @@
 
 #include "NVParamLibCommon.h"
 
+STATIC NVPARAM_CACHE_ENTRY mNVParamCache[NVPARAM_CACHE_SIZE];
+STATIC UINTN               mNVParamCacheNext;
+STATIC UINT32              mNVParamCacheGeneration;
+
+/**
+  Drop the whole cache if another module changed a NVParam since it was
+  filled.
+**/
+STATIC
+VOID
+NVParamCacheSync (
+  VOID
+  )
+{
+  UINT32 Generation;
+
+  Generation = NVParamGetGeneration ();
+  if (Generation != mNVParamCacheGeneration) {
+    ZeroMem (mNVParamCache, sizeof (mNVParamCache));
+    mNVParamCacheGeneration = Generation;
+  }
+}
+
+/**
+  Look up a NVParamGet () result in the cache.
+
+  @param[in]  Param               Parameter ID
+  @param[in]  ACLRd               Permission for read operation.
+
+  @return The cache entry, or NULL if the result isn't cached.
+**/
+STATIC
+NVPARAM_CACHE_ENTRY *
+NVParamCacheLookup (
+  IN UINT32 Param,
+  IN UINT16 ACLRd
+  )
+{
+  UINTN Index;
+
+  if (!mNVParamCacheEnabled) {
+    return NULL;
+  }
+
+  NVParamCacheSync ();
+
+  for (Index = 0; Index < NVPARAM_CACHE_SIZE; Index++) {
+    if (mNVParamCache[Index].Valid
+        && mNVParamCache[Index].Param == Param
+        && mNVParamCache[Index].ACLRd == ACLRd) {
+      return &mNVParamCache[Index];
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Record a NVParamGet () result in the cache, replacing the oldest entry
+  when the cache is full.
+
+  @param[in]  Param               Parameter ID
+  @param[in]  ACLRd               Permission for read operation.
+  @param[in]  Set                 FALSE if the NVParam entry is not set.
+  @param[in]  Value               Value of the NVParam entry.
+**/
+STATIC
+VOID
+NVParamCacheInsert (
+  IN UINT32  Param,
+  IN UINT16  ACLRd,
+  IN BOOLEAN Set,
+  IN UINT32  Value
+  )
+{
+  NVPARAM_CACHE_ENTRY *Entry;
+
+  if (!mNVParamCacheEnabled) {
+    return;
+  }
+
+  Entry = &mNVParamCache[mNVParamCacheNext];
+  mNVParamCacheNext = (mNVParamCacheNext + 1) % NVPARAM_CACHE_SIZE;
+
+  Entry->Param = Param;
+  Entry->ACLRd = ACLRd;
+  Entry->Set   = Set;
+  Entry->Value = Value;
+  Entry->Valid = TRUE;
+}
+
+/**
+  Drop the cached results of a parameter, for every read permission. The
+  permission checks are done by MM, so the next read goes there. The other
+  modules drop their whole cache, they see the generation change.
+
+  @param[in]  Param               Parameter ID
+**/
+STATIC
+VOID
+NVParamCacheInvalidate (
+  IN UINT32 Param
+  )
+{
+  UINTN Index;
+
+  NVParamCacheSync ();
+
+  for (Index = 0; Index < NVPARAM_CACHE_SIZE; Index++) {
+    if (mNVParamCache[Index].Param == Param) {
+      mNVParamCache[Index].Valid = FALSE;
+    }
+  }
+
+  mNVParamCacheGeneration = NVParamNextGeneration ();
+}
+
 /**
   Retrieve a non-volatile parameter.
 
@@ -41,11 +158,21 @@ NVParamGet (
   EFI_MM_COMMUNICATE_NVPARAM_RESPONSE MmNVParamRes;
   EFI_STATUS                          Status;
   UINT64                              MmData[5];
+  NVPARAM_CACHE_ENTRY                 *Entry;
 
   if (Val == NULL) {
     return EFI_INVALID_PARAMETER;
   }
 
+  Entry = NVParamCacheLookup (Param, ACLRd);
+  if (Entry != NULL) {
+    if (!Entry->Set) {
+      return EFI_NOT_FOUND;
+    }
+    *Val = Entry->Value;
+    return EFI_SUCCESS;
+  }
+
   MmData[0] = MM_NVPARAM_FUNC_READ;
   MmData[1] = Param;
   MmData[2] = (UINT64)ACLRd;
@@ -63,9 +190,11 @@ NVParamGet (
   switch (MmNVParamRes.Status) {
   case MM_NVPARAM_RES_SUCCESS:
     *Val = (UINT32)MmNVParamRes.Value;
+    NVParamCacheInsert (Param, ACLRd, TRUE, *Val);
     return EFI_SUCCESS;
 
   case MM_NVPARAM_RES_NOT_SET:
+    NVParamCacheInsert (Param, ACLRd, FALSE, 0);
     return EFI_NOT_FOUND;
 
   case MM_NVPARAM_RES_NO_PERM:
@@ -109,6 +238,11 @@ NVParamSet (
   EFI_STATUS                          Status;
   UINT64                              MmData[5];
 
+  //
+  // Whatever the outcome, the cached value may be stale now
+  //
+  NVParamCacheInvalidate (Param);
+
   MmData[0] = MM_NVPARAM_FUNC_WRITE;
   MmData[1] = Param;
   MmData[2] = (UINT64)ACLRd;
@@ -164,6 +298,8 @@ NVParamClr (
   EFI_STATUS                          Status;
   UINT64                              MmData[5];
 
+  NVParamCacheInvalidate (Param);
+
   MmData[0] = MM_NVPARAM_FUNC_CLEAR;
   MmData[1] = Param;
   MmData[2] = 0;
@@ -210,6 +346,9 @@ NVParamClrAll (
   EFI_STATUS                          Status;
   UINT64                              MmData[5];
 
+  ZeroMem (mNVParamCache, sizeof (mNVParamCache));
+  mNVParamCacheGeneration = NVParamNextGeneration ();
+
   MmData[0] = MM_NVPARAM_FUNC_CLEAR_ALL;
 
   Status = NVParamMmCommunicate (
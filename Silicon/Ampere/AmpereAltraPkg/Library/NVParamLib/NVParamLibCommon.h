@@ -21,6 +21,8 @@
 #define MM_NVPARAM_RES_NO_PERM            0xAABBCC02
 #define MM_NVPARAM_RES_FAIL               0xAABBCCFF
 
+#define NVPARAM_CACHE_SIZE                64
+
 #pragma pack (1)
 
 typedef struct {
@@ -47,6 +49,43 @@ typedef struct {
 
 #pragma pack ()
 
+//
+// A cached NVParamGet () result
+//
+typedef struct {
+  UINT32  Param;
+  UINT16  ACLRd;
+  BOOLEAN Valid;
+  BOOLEAN Set;      // FALSE if the NVParam entry is not set
+  UINT32  Value;
+} NVPARAM_CACHE_ENTRY;
+
+//
+// TRUE if the library flavour may serve NVParamGet () from the cache
+//
+extern CONST BOOLEAN mNVParamCacheEnabled;
+
+/**
+  Get the NVParam generation shared by all the modules of this boot.
+
+  @return The current generation.
+**/
+UINT32
+NVParamGetGeneration (
+  VOID
+  );
+
+/**
+  Advance the NVParam generation shared by all the modules of this boot,
+  so that their caches are dropped on the next NVParamGet ().
+
+  @return The new generation.
+**/
+UINT32
+NVParamNextGeneration (
+  VOID
+  );
+
 /**
   Provides an interface to access the NVParam services via MM interface.
 
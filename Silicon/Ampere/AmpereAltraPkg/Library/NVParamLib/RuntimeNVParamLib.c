@@ -11,7 +11,9 @@
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
 #include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiRuntimeLib.h>
 #include <Library/UefiRuntimeServicesTableLib.h>
 #include <Protocol/MmCommunication2.h>
 
@@ -19,6 +21,45 @@
 
 STATIC EFI_MM_COMMUNICATION2_PROTOCOL *mMmCommunicationProtocol = NULL;
 
+//
+// At runtime the NVParams may be changed by the OS or the BMC, always ask MM.
+//
+CONST BOOLEAN mNVParamCacheEnabled = FALSE;
+
+/**
+  Get the NVParam generation shared by all the modules of this boot.
+
+  @return The current generation.
+**/
+UINT32
+NVParamGetGeneration (
+  VOID
+  )
+{
+  return 0;
+}
+
+/**
+  Advance the NVParam generation shared by all the modules of this boot,
+  so that their caches are dropped on the next NVParamGet ().
+
+  This flavour doesn't cache, but changes made before ExitBootServices ()
+  must still reach the caches of the boot-time modules.
+
+  @return The new generation.
+**/
+UINT32
+NVParamNextGeneration (
+  VOID
+  )
+{
+  if (!EfiAtRuntime ()) {
+    PcdSet32S (PcdNVParamGeneration, PcdGet32 (PcdNVParamGeneration) + 1);
+  }
+
+  return 0;
+}
+
 /**
   This is a notification function registered on EVT_SIGNAL_VIRTUAL_ADDRESS_CHANGE
   event. It converts a pointer to a new virtual address.
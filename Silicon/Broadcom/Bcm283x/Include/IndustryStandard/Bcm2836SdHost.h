@@ -16,6 +16,7 @@
 #define SDHOST_BASE_ADDRESS         (BCM2836_SOC_REGISTERS + SDHOST_OFFSET)
 #define SDHOST_LENGTH               0x00000100
 #define SDHOST_REG(X)               (SDHOST_BASE_ADDRESS + (X))
+#define SDHOST_BUS_REG(X)           (BCM2836_PERIPHERAL_BUS_ADDRESS + SDHOST_OFFSET + (X))
 #define SDHOST_CMD                  SDHOST_REG(0x0)
 #define SDHOST_ARG                  SDHOST_REG(0x4)
 #define SDHOST_TOUT                 SDHOST_REG(0x8)
@@ -32,6 +33,10 @@
 #define SDHOST_DATA                 SDHOST_REG(0x40)
 #define SDHOST_HBLC                 SDHOST_REG(0x50)
 
+#define SDHOST_DATA_BUS_ADDRESS     SDHOST_BUS_REG(0x40)
+#define SDHOST_FIFO_WORDS           16
+#define SDHOST_DMA_DREQ             13
+
 //
 // CMD
 //
@@ -78,6 +83,9 @@
 // EDM
 //
 #define SDHOST_EDM_FIFO_CLEAR               BIT21
+#define SDHOST_EDM_FSM_MASK                 0xF
+#define SDHOST_EDM_FIFO_FILL_SHIFT          4
+#define SDHOST_EDM_FIFO_FILL(Edm)           (((Edm) >> SDHOST_EDM_FIFO_FILL_SHIFT) & SDHOST_EDM_THRESHOLD_MASK)
 #define SDHOST_EDM_WRITE_THRESHOLD_SHIFT    9
 #define SDHOST_EDM_READ_THRESHOLD_SHIFT     14
 #define SDHOST_EDM_THRESHOLD_MASK           0x1F
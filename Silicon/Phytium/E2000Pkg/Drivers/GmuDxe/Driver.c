@@ -217,6 +217,26 @@ DriverStart (
                                 Controller,
                                 EFI_OPEN_PROTOCOL_BY_DRIVER
                                 );
+  if (EFI_ERROR (Status)) {
+    FreePages (Snp, EFI_SIZE_TO_PAGES (sizeof (SIMPLE_NETWORK_DRIVER)));
+    return Status;
+  }
+  //
+  // The platform may defer the share memory setup until the device is started
+  //
+  if (Snp->Dev->Initialize != NULL) {
+    Status = Snp->Dev->Initialize (Snp->Dev);
+    if (EFI_ERROR (Status)) {
+      gBS->CloseProtocol (
+             Controller,
+             &gEdkiiNonDiscoverableDeviceProtocolGuid,
+             This->DriverBindingHandle,
+             Controller
+             );
+      FreePages (Snp, EFI_SIZE_TO_PAGES (sizeof (SIMPLE_NETWORK_DRIVER)));
+      return Status;
+    }
+  }
   //
   // Size for transmit and receive buffer
   //
@@ -396,6 +396,16 @@ PhyControllerDriverStart (
     goto Error;
   }
   //
+  // The platform may defer the share memory setup until the device is started
+  //
+  if (Dev->Initialize != NULL) {
+    Status = Dev->Initialize (Dev);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "Non Discoverable Device Initialize failed - %r\n", Status));
+      goto Error;
+    }
+  }
+  //
   // Open Device Path Protocol for on USB host controller
   //
   GopDevicePath = NULL;
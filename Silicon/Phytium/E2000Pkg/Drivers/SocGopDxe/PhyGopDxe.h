@@ -14,6 +14,7 @@
 #include <Library/UefiDriverEntryPoint.h>
 #include <Library/UefiLib.h>
 #include <Library/PcdLib.h>
+#include <Library/PhyGopCoreLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/BaseMemoryLib.h>
@@ -90,6 +91,8 @@ typedef struct _PHY_PRIVATE_DATA {
   DP_SYNC                         DpSync[PHY_GOP_MAX_MODENUM];
   VOID                            *LineBuffer;
   UINT64                          BufferAddr;
+  PHY_GOP_CORE                    GopCore;
+  EFI_EVENT                       ExitBootServicesEvent;
   UINT8                           MaxMode;
   UINT8                           ModeNum;
   UINT64                          DcCtrlBaseAddr;
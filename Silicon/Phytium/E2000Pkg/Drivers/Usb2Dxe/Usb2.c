@@ -1330,6 +1330,22 @@ PhytiumUsb2DriverBindingStart (
     return Status;
   }
 
+  //
+  // The platform may defer the share memory setup until the device is started
+  //
+  if (Dev->Initialize != NULL) {
+    Status = Dev->Initialize (Dev);
+    if (EFI_ERROR (Status)) {
+      gBS->CloseProtocol (
+             Controller,
+             &gEdkiiNonDiscoverableDeviceProtocolGuid,
+             This->DriverBindingHandle,
+             Controller
+             );
+      return Status;
+    }
+  }
+
   //
   // Open Device Path Protocol for on USB host controller
   //
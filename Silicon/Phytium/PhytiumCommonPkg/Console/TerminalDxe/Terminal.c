@@ -103,7 +103,17 @@ TERMINAL_DEV  mTerminalDevTemplate = {
     NULL,
     NULL,
   },
-  NULL // KeyNotifyProcessEvent
+  NULL, // KeyNotifyProcessEvent
+  { 0 },  // OutputBuffer
+  0,      // OutputLength
+  NULL,   // ShadowScreen
+  0,      // ShadowColumns
+  0,      // ShadowRows
+  0,      // SkippedCells
+  FALSE,  // WrapPending
+  FALSE,  // WrapScrolls
+  FALSE,  // ShadowSuspended
+  -1      // TerminalAttribute
 };
 
 TERMINAL_CONSOLE_MODE_DATA mTerminalConsoleModeData[] = {
@@ -823,6 +833,10 @@ FreeResources:
     FreePool (TerminalDevice->TerminalConsoleModeData);
   }
 
+  if (TerminalDevice->ShadowScreen != NULL) {
+    FreePool (TerminalDevice->ShadowScreen);
+  }
+
   FreePool (TerminalDevice);
 
 CloseProtocols:
@@ -982,6 +996,9 @@ TerminalDriverBindingStop (
         TerminalFreeNotifyList (&TerminalDevice->NotifyList);
         FreePool (TerminalDevice->DevicePath);
         FreePool (TerminalDevice->TerminalConsoleModeData);
+        if (TerminalDevice->ShadowScreen != NULL) {
+          FreePool (TerminalDevice->ShadowScreen);
+        }
         FreePool (TerminalDevice);
       }
     }
@@ -65,6 +65,23 @@ typedef struct {
 
 #define KEYBOARD_TIMER_INTERVAL         200000  // 0.02s
 
+//
+// Output of OutputString() is collected and sent to the serial device in
+// chunks of this size. The serial driver feeds its FIFO from one chunk, so
+// a chunk a few times the FIFO depth keeps the UART busy without a call per
+// character.
+//
+#define TERMINAL_OUTPUT_BUFFER_SIZE     256
+
+//
+// One character position of the shadow screen. Char is CHAR_NULL when what
+// the terminal shows at this position is not known.
+//
+typedef struct {
+  CHAR16  Char;
+  UINT16  Attribute;
+} TERMINAL_CELL;
+
 #define TERMINAL_DEV_SIGNATURE  SIGNATURE_32 ('t', 'm', 'n', 'l')
 
 #define TERMINAL_CONSOLE_IN_EX_NOTIFY_SIGNATURE SIGNATURE_32 ('t', 'm', 'e', 'n')
@@ -118,6 +135,39 @@ typedef struct {
   EFI_SIMPLE_TEXT_INPUT_EX_PROTOCOL   SimpleInputEx;
   LIST_ENTRY                          NotifyList;
   EFI_EVENT                           KeyNotifyProcessEvent;
+
+  //
+  // Pending output, written to the serial device when full and at the end
+  // of each OutputString().
+  //
+  UINT8                               OutputBuffer[TERMINAL_OUTPUT_BUFFER_SIZE];
+  UINTN                               OutputLength;
+
+  //
+  // Shadow of the terminal screen. Characters the terminal already shows
+  // with the same attribute are skipped, SkippedCells counts the ones the
+  // terminal cursor has not been moved over yet.
+  //
+  TERMINAL_CELL                       *ShadowScreen;
+  UINTN                               ShadowColumns;
+  UINTN                               ShadowRows;
+  UINTN                               SkippedCells;
+  //
+  // The last column was written and the terminal defers the wrap until
+  // the next character. WrapScrolls is set if that wrap scrolls the screen.
+  //
+  BOOLEAN                             WrapPending;
+  BOOLEAN                             WrapScrolls;
+  //
+  // The terminal cursor may differ from the mode cursor, e.g. after a tab,
+  // don't use the shadow until the cursor is set again.
+  //
+  BOOLEAN                             ShadowSuspended;
+  //
+  // Attribute set on the terminal, -1 if not known. SetAttribute() only
+  // updates the mode, the terminal is changed before the next character.
+  //
+  INT32                               TerminalAttribute;
 } TERMINAL_DEV;
 
 #define INPUT_STATE_DEFAULT               0x00
@@ -1382,6 +1432,45 @@ TerminalIsValidEfiCntlChar (
   IN  CHAR16  CharC
   );
 
+/**
+  Write the pending output of the terminal to the serial device.
+
+  @param  TerminalDevice         The terminal device.
+
+  @retval EFI_SUCCESS            The pending output is written.
+  @retval Others                 The serial device fails to write the output.
+
+**/
+EFI_STATUS
+TerminalFlushOutput (
+  IN  TERMINAL_DEV  *TerminalDevice
+  );
+
+/**
+  Allocate the shadow screen for the current mode of the terminal.
+
+  The shadow screen is not used if PcdPhytiumTerminalShadowScreen is FALSE
+  or the allocation fails.
+
+  @param  TerminalDevice         The terminal device.
+
+**/
+VOID
+TerminalAllocateShadowScreen (
+  IN  TERMINAL_DEV  *TerminalDevice
+  );
+
+/**
+  Forget what the terminal shows, every character is sent again.
+
+  @param  TerminalDevice         The terminal device.
+
+**/
+VOID
+TerminalInvalidateShadowScreen (
+  IN  TERMINAL_DEV  *TerminalDevice
+  );
+
 /**
   Check if the device supports hot-plug through its device path.
 
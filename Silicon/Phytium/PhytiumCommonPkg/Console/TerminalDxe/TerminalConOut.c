@@ -80,6 +80,549 @@ CHAR16 mSetCursorPositionString[]  = { ESC, '[', '0', '0', ';', '0', '0', 'H', 0
 CHAR16 mCursorForwardString[]      = { ESC, '[', '0', '0', 'C', 0 };
 CHAR16 mCursorBackwardString[]     = { ESC, '[', '0', '0', 'D', 0 };
 
+//
+// Skipped characters fewer than this are sent again instead of moving
+// the cursor over them with mCursorForwardString.
+//
+#define TERMINAL_SKIP_RESEND_MAX  5
+
+//
+// Output engine
+//
+
+/**
+  Get the shadow screen cell of a character position.
+
+  @param  TerminalDevice         The terminal device.
+  @param  Column                 Column of the position.
+  @param  Row                    Row of the position.
+
+  @return The cell, or NULL if the shadow screen is not used.
+
+**/
+STATIC
+TERMINAL_CELL *
+TerminalShadowCell (
+  IN  TERMINAL_DEV  *TerminalDevice,
+  IN  UINTN         Column,
+  IN  UINTN         Row
+  )
+{
+  if ((TerminalDevice->ShadowScreen == NULL) || TerminalDevice->ShadowSuspended ||
+      (Column >= TerminalDevice->ShadowColumns) || (Row >= TerminalDevice->ShadowRows)) {
+    return NULL;
+  }
+
+  return &TerminalDevice->ShadowScreen[Row * TerminalDevice->ShadowColumns + Column];
+}
+
+/**
+  Scroll the shadow screen up by one line, as the terminal does when a line
+  feed or a wrap happens on the last row.
+
+  @param  TerminalDevice         The terminal device.
+
+**/
+STATIC
+VOID
+TerminalScrollShadowScreen (
+  IN  TERMINAL_DEV  *TerminalDevice
+  )
+{
+  UINTN  LineSize;
+
+  if (TerminalDevice->ShadowScreen == NULL) {
+    return;
+  }
+
+  LineSize = TerminalDevice->ShadowColumns * sizeof (TERMINAL_CELL);
+  CopyMem (
+    TerminalDevice->ShadowScreen,
+    (UINT8 *) TerminalDevice->ShadowScreen + LineSize,
+    LineSize * (TerminalDevice->ShadowRows - 1)
+    );
+  ZeroMem ((UINT8 *) TerminalDevice->ShadowScreen + LineSize * (TerminalDevice->ShadowRows - 1), LineSize);
+}
+
+/**
+  Stop using the shadow screen until the cursor position is set again.
+
+  @param  TerminalDevice         The terminal device.
+
+**/
+STATIC
+VOID
+TerminalSuspendShadowScreen (
+  IN  TERMINAL_DEV  *TerminalDevice
+  )
+{
+  TerminalInvalidateShadowScreen (TerminalDevice);
+  TerminalDevice->ShadowSuspended = TRUE;
+}
+
+/**
+  Append bytes to the pending output of the terminal.
+
+  @param  TerminalDevice         The terminal device.
+  @param  Bytes                  The bytes to output.
+  @param  Length                 Number of bytes.
+
+  @retval EFI_SUCCESS            The bytes are queued.
+  @retval Others                 The serial device fails to write the pending output.
+
+**/
+STATIC
+EFI_STATUS
+TerminalOutputBytes (
+  IN  TERMINAL_DEV  *TerminalDevice,
+  IN  UINT8         *Bytes,
+  IN  UINTN         Length
+  )
+{
+  EFI_STATUS  Status;
+
+  if (TerminalDevice->OutputLength + Length > TERMINAL_OUTPUT_BUFFER_SIZE) {
+    Status = TerminalFlushOutput (TerminalDevice);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  CopyMem (&TerminalDevice->OutputBuffer[TerminalDevice->OutputLength], Bytes, Length);
+  TerminalDevice->OutputLength += Length;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Append a control sequence to the pending output of the terminal.
+
+  @param  TerminalDevice         The terminal device.
+  @param  String                 The control sequence, ASCII characters only.
+
+  @retval EFI_SUCCESS            The control sequence is queued.
+  @retval Others                 The serial device fails to write the pending output.
+
+**/
+STATIC
+EFI_STATUS
+TerminalOutputControlString (
+  IN  TERMINAL_DEV  *TerminalDevice,
+  IN  CHAR16        *String
+  )
+{
+  EFI_STATUS  Status;
+  UINT8       Byte;
+
+  for (; *String != CHAR_NULL; String++) {
+    Byte   = (UINT8) *String;
+    Status = TerminalOutputBytes (TerminalDevice, &Byte, 1);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Convert a Unicode character to the bytes sent to the terminal.
+
+  @param  TerminalDevice         The terminal device.
+  @param  Char                   The Unicode character.
+  @param  Bytes                  Returns the bytes, at least sizeof (UTF8_CHAR).
+  @param  Length                 Returns the number of bytes.
+
+  @retval TRUE                   The character can be rendered.
+  @retval FALSE                  The character is replaced with '?'.
+
+**/
+STATIC
+BOOLEAN
+TerminalTranslateChar (
+  IN  TERMINAL_DEV  *TerminalDevice,
+  IN  CHAR16        Char,
+  OUT UINT8         *Bytes,
+  OUT UINTN         *Length
+  )
+{
+  UTF8_CHAR  Utf8Char;
+  CHAR8      GraphicChar;
+  CHAR8      AsciiChar;
+  UINT8      ValidBytes;
+  BOOLEAN    Valid;
+
+  Valid   = TRUE;
+  *Length = 0;
+
+  switch (TerminalDevice->TerminalType) {
+
+  case TerminalTypePcAnsi:
+  case TerminalTypeVt100:
+  case TerminalTypeVt100Plus:
+  case TerminalTypeTtyTerm:
+
+    AsciiChar = 0;
+    if (!TerminalIsValidTextGraphics (Char, &GraphicChar, &AsciiChar)) {
+      //
+      // If it's not a graphic character convert Unicode to ASCII.
+      //
+      GraphicChar = (CHAR8) Char;
+
+      if (!(TerminalIsValidAscii (GraphicChar) || TerminalIsValidEfiCntlChar (GraphicChar))) {
+        //
+        // when this driver use the OutputString to output control string,
+        // TerminalDevice->OutputEscChar is set to let the Esc char
+        // to be output to the terminal emulation software.
+        //
+        if ((GraphicChar == 27) && TerminalDevice->OutputEscChar) {
+          GraphicChar = 27;
+        } else {
+          GraphicChar = '?';
+          Valid       = FALSE;
+        }
+      }
+
+      AsciiChar = GraphicChar;
+
+    }
+
+    if (TerminalDevice->TerminalType != TerminalTypePcAnsi) {
+      GraphicChar = AsciiChar;
+    }
+
+    Bytes[0] = (UINT8) GraphicChar;
+    *Length  = 1;
+    break;
+
+  case TerminalTypeVtUtf8:
+    UnicodeToUtf8 (Char, &Utf8Char, &ValidBytes);
+    CopyMem (Bytes, &Utf8Char, ValidBytes);
+    *Length = ValidBytes;
+    break;
+  }
+
+  return Valid;
+}
+
+/**
+  Set the attribute of the terminal to the mode attribute, if it differs.
+
+  @param  TerminalDevice         The terminal device.
+
+  @retval EFI_SUCCESS            The terminal uses the mode attribute.
+  @retval Others                 The serial device fails to write the pending output.
+
+**/
+STATIC
+EFI_STATUS
+TerminalSyncAttribute (
+  IN  TERMINAL_DEV  *TerminalDevice
+  )
+{
+  EFI_STATUS    Status;
+  INT32         Attribute;
+  UINT8         ForegroundControl;
+  UINT8         BackgroundControl;
+  UINT8         BrightControl;
+
+  Attribute = TerminalDevice->SimpleTextOutput.Mode->Attribute;
+  if (TerminalDevice->TerminalAttribute == Attribute) {
+    return EFI_SUCCESS;
+  }
+
+  //
+  //  convert Attribute value to terminal emulator
+  //  understandable foreground color
+  //
+  switch (Attribute & 0x07) {
+
+  case EFI_BLACK:
+    ForegroundControl = 30;
+    break;
+
+  case EFI_BLUE:
+    ForegroundControl = 34;
+    break;
+
+  case EFI_GREEN:
+    ForegroundControl = 32;
+    break;
+
+  case EFI_CYAN:
+    ForegroundControl = 36;
+    break;
+
+  case EFI_RED:
+    ForegroundControl = 31;
+    break;
+
+  case EFI_MAGENTA:
+    ForegroundControl = 35;
+    break;
+
+  case EFI_BROWN:
+    ForegroundControl = 33;
+    break;
+
+  default:
+
+  case EFI_LIGHTGRAY:
+    ForegroundControl = 37;
+    break;
+
+  }
+  //
+  //  bit4 of the Attribute indicates bright control
+  //  of terminal emulator.
+  //
+  BrightControl = (UINT8) ((Attribute >> 3) & 1);
+
+  //
+  //  convert Attribute value to terminal emulator
+  //  understandable background color.
+  //
+  switch ((Attribute >> 4) & 0x07) {
+
+  case EFI_BLACK:
+    BackgroundControl = 40;
+    break;
+
+  case EFI_BLUE:
+    BackgroundControl = 44;
+    break;
+
+  case EFI_GREEN:
+    BackgroundControl = 42;
+    break;
+
+  case EFI_CYAN:
+    BackgroundControl = 46;
+    break;
+
+  case EFI_RED:
+    BackgroundControl = 41;
+    break;
+
+  case EFI_MAGENTA:
+    BackgroundControl = 45;
+    break;
+
+  case EFI_BROWN:
+    BackgroundControl = 43;
+    break;
+
+  default:
+
+  case EFI_LIGHTGRAY:
+    BackgroundControl = 47;
+    break;
+  }
+  //
+  // terminal emulator's control sequence to set attributes
+  //
+  mSetAttributeString[BRIGHT_CONTROL_OFFSET]          = (CHAR16) ('0' + BrightControl);
+  mSetAttributeString[FOREGROUND_CONTROL_OFFSET + 0]  = (CHAR16) ('0' + (ForegroundControl / 10));
+  mSetAttributeString[FOREGROUND_CONTROL_OFFSET + 1]  = (CHAR16) ('0' + (ForegroundControl % 10));
+  mSetAttributeString[BACKGROUND_CONTROL_OFFSET + 0]  = (CHAR16) ('0' + (BackgroundControl / 10));
+  mSetAttributeString[BACKGROUND_CONTROL_OFFSET + 1]  = (CHAR16) ('0' + (BackgroundControl % 10));
+
+  Status = TerminalOutputControlString (TerminalDevice, mSetAttributeString);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  TerminalDevice->TerminalAttribute = Attribute;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Move the terminal cursor over the characters skipped because the terminal
+  already shows them.
+
+  @param  TerminalDevice         The terminal device.
+
+  @retval EFI_SUCCESS            The terminal cursor is at the mode cursor.
+  @retval Others                 The serial device fails to write the pending output.
+
+**/
+STATIC
+EFI_STATUS
+TerminalSyncCursor (
+  IN  TERMINAL_DEV  *TerminalDevice
+  )
+{
+  EFI_SIMPLE_TEXT_OUTPUT_MODE *Mode;
+  EFI_STATUS                  Status;
+  TERMINAL_CELL               *Cell;
+  UINTN                       Count;
+  UINT8                       Bytes[sizeof (UTF8_CHAR)];
+  UINTN                       Length;
+
+  Mode   = TerminalDevice->SimpleTextOutput.Mode;
+  Status = EFI_SUCCESS;
+
+  if (TerminalDevice->SkippedCells == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Cell = TerminalShadowCell (TerminalDevice, Mode->CursorColumn - TerminalDevice->SkippedCells, Mode->CursorRow);
+  if ((Cell != NULL) && (TerminalDevice->SkippedCells < TERMINAL_SKIP_RESEND_MAX)) {
+    //
+    // Sending the few skipped characters again is shorter than moving the cursor.
+    // The skipped cells are on the cursor row and use the mode attribute.
+    //
+    Status = TerminalSyncAttribute (TerminalDevice);
+    for (Count = TerminalDevice->SkippedCells; !EFI_ERROR (Status) && Count > 0; Count--, Cell++) {
+      TerminalTranslateChar (TerminalDevice, Cell->Char, Bytes, &Length);
+      Status = TerminalOutputBytes (TerminalDevice, Bytes, Length);
+    }
+  } else {
+    for (Count = TerminalDevice->SkippedCells; !EFI_ERROR (Status) && Count > 0; Count -= Length) {
+      Length = MIN (Count, 99);
+      mCursorForwardString[FW_BACK_OFFSET + 0] = (CHAR16) ('0' + (Length / 10));
+      mCursorForwardString[FW_BACK_OFFSET + 1] = (CHAR16) ('0' + (Length % 10));
+      Status = TerminalOutputControlString (TerminalDevice, mCursorForwardString);
+    }
+  }
+
+  TerminalDevice->SkippedCells = 0;
+
+  return Status;
+}
+
+/**
+  Output one character at the mode cursor, skipping it if the terminal
+  already shows it. The mode cursor is not updated.
+
+  @param  TerminalDevice         The terminal device.
+  @param  Char                   The Unicode character.
+  @param  Bytes                  The bytes of the character for the terminal.
+  @param  Length                 Number of bytes.
+  @param  MaxColumn              Number of columns of the mode.
+  @param  MaxRow                 Number of rows of the mode.
+
+  @retval EFI_SUCCESS            The character is output.
+  @retval Others                 The serial device fails to write the pending output.
+
+**/
+STATIC
+EFI_STATUS
+TerminalOutputChar (
+  IN  TERMINAL_DEV  *TerminalDevice,
+  IN  CHAR16        Char,
+  IN  UINT8         *Bytes,
+  IN  UINTN         Length,
+  IN  UINTN         MaxColumn,
+  IN  UINTN         MaxRow
+  )
+{
+  EFI_SIMPLE_TEXT_OUTPUT_MODE *Mode;
+  EFI_STATUS                  Status;
+  TERMINAL_CELL               *Cell;
+  UINTN                       Column;
+  UINTN                       Row;
+
+  Mode   = TerminalDevice->SimpleTextOutput.Mode;
+  Column = (UINTN) Mode->CursorColumn;
+  Row    = (UINTN) Mode->CursorRow;
+
+  if ((Char == CHAR_BACKSPACE) || (Char == CHAR_LINEFEED) || (Char == CHAR_CARRIAGE_RETURN)) {
+    Status = TerminalSyncCursor (TerminalDevice);
+
+    if (TerminalDevice->WrapPending) {
+      //
+      // The terminal cursor is still on the last column, the mode cursor
+      // has wrapped already. They don't meet again until the cursor is set.
+      //
+      TerminalSuspendShadowScreen (TerminalDevice);
+      TerminalDevice->WrapPending = FALSE;
+    }
+
+    if (!EFI_ERROR (Status) && (Char == CHAR_LINEFEED)) {
+      //
+      // A line feed on the last row scrolls in a line of the current background.
+      //
+      Status = TerminalSyncAttribute (TerminalDevice);
+      if (Row == MaxRow - 1) {
+        TerminalScrollShadowScreen (TerminalDevice);
+      }
+    }
+
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    return TerminalOutputBytes (TerminalDevice, Bytes, Length);
+  }
+
+  Cell = TerminalShadowCell (TerminalDevice, Column, Row);
+
+  if ((Cell != NULL) && !TerminalDevice->WrapPending && (Char != CHAR_TAB) &&
+      (Column < MaxColumn - 1) &&
+      (Cell->Char == Char) && (Cell->Attribute == (UINT16) Mode->Attribute)) {
+    TerminalDevice->SkippedCells++;
+    return EFI_SUCCESS;
+  }
+
+  Status = TerminalSyncCursor (TerminalDevice);
+  if (!EFI_ERROR (Status)) {
+    Status = TerminalSyncAttribute (TerminalDevice);
+  }
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (TerminalDevice->WrapPending) {
+    TerminalDevice->WrapPending = FALSE;
+    if (TerminalDevice->WrapScrolls) {
+      TerminalScrollShadowScreen (TerminalDevice);
+    }
+  }
+
+  Status = TerminalOutputBytes (TerminalDevice, Bytes, Length);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (Char == CHAR_TAB) {
+    //
+    // The terminal moves to the next tab stop, the mode cursor one column.
+    //
+    TerminalSuspendShadowScreen (TerminalDevice);
+    return EFI_SUCCESS;
+  }
+
+  if (Cell != NULL) {
+    Cell->Char      = Char;
+    Cell->Attribute = (UINT16) Mode->Attribute;
+  }
+
+  if (Column == MaxColumn - 1) {
+    if (TerminalDevice->TerminalType == TerminalTypeTtyTerm) {
+      //
+      // The caller sends CR LF to wrap, which scrolls on the last row.
+      //
+      if (Row == MaxRow - 1) {
+        TerminalScrollShadowScreen (TerminalDevice);
+      }
+    } else if (TerminalDevice->TerminalType == TerminalTypePcAnsi) {
+      //
+      // PC ANSI terminals may or may not wrap right away.
+      //
+      if (Row == MaxRow - 1) {
+        TerminalSuspendShadowScreen (TerminalDevice);
+      }
+    } else {
+      TerminalDevice->WrapPending = TRUE;
+      TerminalDevice->WrapScrolls = (BOOLEAN) (Row == MaxRow - 1);
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
 //
 // Body of the ConOut functions
 //
@@ -177,11 +720,8 @@ TerminalConOutOutputString (
   UINTN                       MaxColumn;
   UINTN                       MaxRow;
   UINTN                       Length;
-  UTF8_CHAR                   Utf8Char;
-  CHAR8                       GraphicChar;
-  CHAR8                       AsciiChar;
+  UINT8                       Bytes[sizeof (UTF8_CHAR)];
   EFI_STATUS                  Status;
-  UINT8                       ValidBytes;
   CHAR8                       CrLfStr[2];
   //
   //  flag used to indicate whether condition happens which will cause
@@ -189,9 +729,7 @@ TerminalConOutOutputString (
   //
   BOOLEAN                     Warning;
 
-  ValidBytes  = 0;
   Warning     = FALSE;
-  AsciiChar   = 0;
 
   //
   //  get Terminal device data structure pointer.
@@ -216,68 +754,24 @@ TerminalConOutOutputString (
 
   for (; *WString != CHAR_NULL; WString++) {
 
-    switch (TerminalDevice->TerminalType) {
-
-    case TerminalTypePcAnsi:
-    case TerminalTypeVt100:
-    case TerminalTypeVt100Plus:
-    case TerminalTypeTtyTerm:
-
-      if (!TerminalIsValidTextGraphics (*WString, &GraphicChar, &AsciiChar)) {
-        //
-        // If it's not a graphic character convert Unicode to ASCII.
-        //
-        GraphicChar = (CHAR8) *WString;
-
-        if (!(TerminalIsValidAscii (GraphicChar) || TerminalIsValidEfiCntlChar (GraphicChar))) {
-          //
-          // when this driver use the OutputString to output control string,
-          // TerminalDevice->OutputEscChar is set to let the Esc char
-          // to be output to the terminal emulation software.
-          //
-          if ((GraphicChar == 27) && TerminalDevice->OutputEscChar) {
-            GraphicChar = 27;
-          } else {
-            GraphicChar = '?';
-            Warning     = TRUE;
-          }
-        }
-
-        AsciiChar = GraphicChar;
-
-      }
-
-      if (TerminalDevice->TerminalType != TerminalTypePcAnsi) {
-        GraphicChar = AsciiChar;
-      }
-
-      Length = 1;
-
-      Status = TerminalDevice->SerialIo->Write (
-                                          TerminalDevice->SerialIo,
-                                          &Length,
-                                          &GraphicChar
-                                          );
-
-      if (EFI_ERROR (Status)) {
-        goto OutputError;
-      }
+    if (!TerminalTranslateChar (TerminalDevice, *WString, Bytes, &Length)) {
+      Warning = TRUE;
+    }
 
-      break;
+    //
+    // Control sequences of this driver are sent as they are, other
+    // characters go through the shadow screen.
+    //
+    if (TerminalDevice->OutputEscChar) {
+      Status = TerminalOutputBytes (TerminalDevice, Bytes, Length);
+    } else {
+      Status = TerminalOutputChar (TerminalDevice, *WString, Bytes, Length, MaxColumn, MaxRow);
+    }
 
-    case TerminalTypeVtUtf8:
-      UnicodeToUtf8 (*WString, &Utf8Char, &ValidBytes);
-      Length = ValidBytes;
-      Status = TerminalDevice->SerialIo->Write (
-                                          TerminalDevice->SerialIo,
-                                          &Length,
-                                          (UINT8 *) &Utf8Char
-                                          );
-      if (EFI_ERROR (Status)) {
-        goto OutputError;
-      }
-      break;
+    if (EFI_ERROR (Status)) {
+      goto OutputError;
     }
+
     //
     //  Update cursor position.
     //
@@ -324,13 +818,7 @@ TerminalConOutOutputString (
           CrLfStr[0] = '\r';
           CrLfStr[1] = '\n';
 
-          Length = sizeof(CrLfStr);
-
-          Status = TerminalDevice->SerialIo->Write (
-                                                TerminalDevice->SerialIo,
-                                                &Length,
-                                                CrLfStr
-                                                );
+          Status = TerminalOutputBytes (TerminalDevice, (UINT8 *) CrLfStr, sizeof (CrLfStr));
 
           if (EFI_ERROR (Status)) {
             goto OutputError;
@@ -343,6 +831,19 @@ TerminalConOutOutputString (
 
   }
 
+  //
+  // Send the whole string at once, with the terminal cursor where the mode
+  // cursor is.
+  //
+  Status = TerminalSyncCursor (TerminalDevice);
+  if (!EFI_ERROR (Status)) {
+    Status = TerminalFlushOutput (TerminalDevice);
+  }
+
+  if (EFI_ERROR (Status)) {
+    goto OutputError;
+  }
+
   if (Warning) {
     return EFI_WARN_UNKNOWN_GLYPH;
   }
@@ -350,6 +851,14 @@ TerminalConOutOutputString (
   return EFI_SUCCESS;
 
 OutputError:
+  //
+  // What reached the terminal is not known.
+  //
+  TerminalDevice->OutputLength      = 0;
+  TerminalDevice->SkippedCells      = 0;
+  TerminalDevice->TerminalAttribute = -1;
+  TerminalSuspendShadowScreen (TerminalDevice);
+
   REPORT_STATUS_CODE_WITH_DEVICE_PATH (
     EFI_ERROR_CODE | EFI_ERROR_MINOR,
     (EFI_PERIPHERAL_REMOTE_CONSOLE | EFI_P_EC_OUTPUT_ERROR),
@@ -491,6 +1000,7 @@ TerminalConOutSetMode (
   // Set the current mode
   //
   This->Mode->Mode = (INT32) ModeNumber;
+  TerminalAllocateShadowScreen (TerminalDevice);
 
   This->ClearScreen (This);
 
@@ -533,22 +1043,6 @@ TerminalConOutSetAttribute (
   IN  UINTN                            Attribute
   )
 {
-  UINT8         ForegroundControl;
-  UINT8         BackgroundControl;
-  UINT8         BrightControl;
-  INT32         SavedColumn;
-  INT32         SavedRow;
-  EFI_STATUS    Status;
-  TERMINAL_DEV  *TerminalDevice;
-
-  SavedColumn = 0;
-  SavedRow    = 0;
-
-  //
-  //  get Terminal device data structure pointer.
-  //
-  TerminalDevice = TERMINAL_CON_OUT_DEV_FROM_THIS (This);
-
   //
   //  only the bit0..6 of the Attribute is valid
   //
@@ -565,122 +1059,11 @@ TerminalConOutSetAttribute (
   }
 
   //
-  //  convert Attribute value to terminal emulator
-  //  understandable foreground color
-  //
-  switch (Attribute & 0x07) {
-
-  case EFI_BLACK:
-    ForegroundControl = 30;
-    break;
-
-  case EFI_BLUE:
-    ForegroundControl = 34;
-    break;
-
-  case EFI_GREEN:
-    ForegroundControl = 32;
-    break;
-
-  case EFI_CYAN:
-    ForegroundControl = 36;
-    break;
-
-  case EFI_RED:
-    ForegroundControl = 31;
-    break;
-
-  case EFI_MAGENTA:
-    ForegroundControl = 35;
-    break;
-
-  case EFI_BROWN:
-    ForegroundControl = 33;
-    break;
-
-  default:
-
-  case EFI_LIGHTGRAY:
-    ForegroundControl = 37;
-    break;
-
-  }
-  //
-  //  bit4 of the Attribute indicates bright control
-  //  of terminal emulator.
-  //
-  BrightControl = (UINT8) ((Attribute >> 3) & 1);
-
-  //
-  //  convert Attribute value to terminal emulator
-  //  understandable background color.
-  //
-  switch ((Attribute >> 4) & 0x07) {
-
-  case EFI_BLACK:
-    BackgroundControl = 40;
-    break;
-
-  case EFI_BLUE:
-    BackgroundControl = 44;
-    break;
-
-  case EFI_GREEN:
-    BackgroundControl = 42;
-    break;
-
-  case EFI_CYAN:
-    BackgroundControl = 46;
-    break;
-
-  case EFI_RED:
-    BackgroundControl = 41;
-    break;
-
-  case EFI_MAGENTA:
-    BackgroundControl = 45;
-    break;
-
-  case EFI_BROWN:
-    BackgroundControl = 43;
-    break;
-
-  default:
-
-  case EFI_LIGHTGRAY:
-    BackgroundControl = 47;
-    break;
-  }
-  //
-  // terminal emulator's control sequence to set attributes
-  //
-  mSetAttributeString[BRIGHT_CONTROL_OFFSET]          = (CHAR16) ('0' + BrightControl);
-  mSetAttributeString[FOREGROUND_CONTROL_OFFSET + 0]  = (CHAR16) ('0' + (ForegroundControl / 10));
-  mSetAttributeString[FOREGROUND_CONTROL_OFFSET + 1]  = (CHAR16) ('0' + (ForegroundControl % 10));
-  mSetAttributeString[BACKGROUND_CONTROL_OFFSET + 0]  = (CHAR16) ('0' + (BackgroundControl / 10));
-  mSetAttributeString[BACKGROUND_CONTROL_OFFSET + 1]  = (CHAR16) ('0' + (BackgroundControl % 10));
-
-  //
-  // save current column and row
-  // for future scrolling back use.
-  //
-  SavedColumn                   = This->Mode->CursorColumn;
-  SavedRow                      = This->Mode->CursorRow;
-
-  TerminalDevice->OutputEscChar = TRUE;
-  Status                        = This->OutputString (This, mSetAttributeString);
-  TerminalDevice->OutputEscChar = FALSE;
-
-  if (EFI_ERROR (Status)) {
-    return EFI_DEVICE_ERROR;
-  }
-  //
-  //  scroll back to saved cursor position.
+  // The terminal is switched to the new attribute right before the next
+  // character is sent, so attributes set and changed again without output
+  // in between never reach the terminal.
   //
-  This->Mode->CursorColumn  = SavedColumn;
-  This->Mode->CursorRow     = SavedRow;
-
-  This->Mode->Attribute     = (INT32) Attribute;
+  This->Mode->Attribute = (INT32) Attribute;
 
   return EFI_SUCCESS;
 
@@ -710,6 +1093,18 @@ TerminalConOutClearScreen (
 
   TerminalDevice = TERMINAL_CON_OUT_DEV_FROM_THIS (This);
 
+  //
+  // The screen is cleared to the background of the current attribute.
+  // Whether the terminal fills it with that background is not known, so
+  // the shadow screen is not filled with spaces.
+  //
+  TerminalInvalidateShadowScreen (TerminalDevice);
+  Status = TerminalSyncAttribute (TerminalDevice);
+  if (EFI_ERROR (Status)) {
+    TerminalDevice->OutputLength = 0;
+    return EFI_DEVICE_ERROR;
+  }
+
   //
   //  control sequence for clear screen request
   //
@@ -783,9 +1178,10 @@ TerminalConOutSetCursorPosition (
   //
   // Optimize cursor motion control sequences for TtyTerm.  Move
   // within the current line if possible, and don't output anyting if
-  // it isn't necessary.
+  // it isn't necessary. The terminal cursor must be known for that.
   //
   if (TerminalDevice->TerminalType == TerminalTypeTtyTerm &&
+      !TerminalDevice->ShadowSuspended &&
       (UINTN)Mode->CursorRow == Row) {
     if ((UINTN)Mode->CursorColumn > Column) {
       mCursorBackwardString[FW_BACK_OFFSET + 0] = (CHAR16) ('0' + ((Mode->CursorColumn - Column) / 10));
@@ -823,6 +1219,12 @@ TerminalConOutSetCursorPosition (
   Mode->CursorColumn  = (INT32) Column;
   Mode->CursorRow     = (INT32) Row;
 
+  //
+  // The terminal cursor is at the mode cursor again.
+  //
+  TerminalDevice->WrapPending     = FALSE;
+  TerminalDevice->ShadowSuspended = FALSE;
+
   return EFI_SUCCESS;
 }
 
@@ -953,3 +1355,95 @@ TerminalIsValidEfiCntlChar (
 
   return FALSE;
 }
+
+/**
+  Write the pending output of the terminal to the serial device.
+
+  @param  TerminalDevice         The terminal device.
+
+  @retval EFI_SUCCESS            The pending output is written.
+  @retval Others                 The serial device fails to write the output.
+
+**/
+EFI_STATUS
+TerminalFlushOutput (
+  IN  TERMINAL_DEV  *TerminalDevice
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Length;
+
+  if (TerminalDevice->OutputLength == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Length = TerminalDevice->OutputLength;
+  Status = TerminalDevice->SerialIo->Write (
+                                       TerminalDevice->SerialIo,
+                                       &Length,
+                                       TerminalDevice->OutputBuffer
+                                       );
+  TerminalDevice->OutputLength = 0;
+
+  return Status;
+}
+
+/**
+  Allocate the shadow screen for the current mode of the terminal.
+
+  The shadow screen is not used if PcdPhytiumTerminalShadowScreen is FALSE
+  or the allocation fails.
+
+  @param  TerminalDevice         The terminal device.
+
+**/
+VOID
+TerminalAllocateShadowScreen (
+  IN  TERMINAL_DEV  *TerminalDevice
+  )
+{
+  EFI_SIMPLE_TEXT_OUTPUT_MODE *Mode;
+
+  if (TerminalDevice->ShadowScreen != NULL) {
+    FreePool (TerminalDevice->ShadowScreen);
+    TerminalDevice->ShadowScreen = NULL;
+  }
+
+  TerminalDevice->ShadowColumns = 0;
+  TerminalDevice->ShadowRows    = 0;
+  TerminalDevice->SkippedCells  = 0;
+
+  if (!PcdGetBool (PcdPhytiumTerminalShadowScreen)) {
+    return;
+  }
+
+  Mode = TerminalDevice->SimpleTextOutput.Mode;
+  TerminalDevice->ShadowScreen = AllocateZeroPool (
+                                   TerminalDevice->TerminalConsoleModeData[Mode->Mode].Columns *
+                                   TerminalDevice->TerminalConsoleModeData[Mode->Mode].Rows *
+                                   sizeof (TERMINAL_CELL)
+                                   );
+  if (TerminalDevice->ShadowScreen != NULL) {
+    TerminalDevice->ShadowColumns = TerminalDevice->TerminalConsoleModeData[Mode->Mode].Columns;
+    TerminalDevice->ShadowRows    = TerminalDevice->TerminalConsoleModeData[Mode->Mode].Rows;
+  }
+}
+
+/**
+  Forget what the terminal shows, every character is sent again.
+
+  @param  TerminalDevice         The terminal device.
+
+**/
+VOID
+TerminalInvalidateShadowScreen (
+  IN  TERMINAL_DEV  *TerminalDevice
+  )
+{
+  if (TerminalDevice->ShadowScreen != NULL) {
+    ZeroMem (
+      TerminalDevice->ShadowScreen,
+      TerminalDevice->ShadowColumns * TerminalDevice->ShadowRows * sizeof (TERMINAL_CELL)
+      );
+  }
+}
@@ -907,7 +907,7 @@ DcConfigInit (
   //diable gamma
   //
   ConfGammaEnable (Private, Num, 0);
-  Private->DcCore[Num].Display.FbPhysAddr = Private->BufferAddr;
+  Private->DcCore[Num].Display.FbPhysAddr = PhyGopCoreGetFrameBuffer (&Private->GopCore);
   Private->DcCore[Num].Display.FbStride = WidthToStride (DcFramebuffer.Width);
   //
   //no dcreq in e2k
@@ -1041,7 +1041,7 @@ DcConfigInit (
   //diable gamma
   //
   ConfGammaEnable (Private, Num, 0);
-  Private->DcCore[Num].Display.FbPhysAddr = Private->BufferAddr;
+  Private->DcCore[Num].Display.FbPhysAddr = PhyGopCoreGetFrameBuffer (&Private->GopCore);
   Private->DcCore[Num].Display.FbStride = WidthToStride (DcFramebuffer.Width);
   //dcreq
   //
@@ -15,6 +15,7 @@
 #include <Library/IoLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/PcdLib.h>
+#include <Library/PhyGopCoreLib.h>
 #include <Library/TimerLib.h>
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiDriverEntryPoint.h>
@@ -89,6 +90,8 @@ typedef struct _PHY_PRIVATE_DATA {
   DP_SYNC                         DpSync[PHY_GOP_MAX_MODENUM];
   VOID                            *LineBuffer;
   UINT64                          BufferAddr;
+  PHY_GOP_CORE                    GopCore;
+  EFI_EVENT                       ExitBootServicesEvent;
   UINT64                          ShadowBuffer;
   UINT8                           MaxMode;
   UINT8                           ModeNum;
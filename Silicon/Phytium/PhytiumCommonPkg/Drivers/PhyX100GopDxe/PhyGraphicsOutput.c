@@ -148,39 +148,6 @@ ResToModeNum (
   return Value;
 }
 
-/**
-  Fill a specified pixel value to rectangular area.
-
-  @param[in]  Private  Pointer to private data structure
-
-  @param[in]  width   Width of rectangular area.
-
-  @param[in]  height  Height of rectangular area.
-
-  @param[in]  blt     The pixel to be filled
-
-  @retval     NULL
-**/
-VOID
-VideoFillFramebuffer (
-  IN PHY_PRIVATE_DATA             *Private,
-  IN UINT32                        Width,
-  IN UINT32                        Height,
-  IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL Blt
-  )
-{
-  UINT32  Stride;
-  UINT32  I;
-  UINT32  J;
-  Stride = WidthToStride (Width);
-  //DEBUG((DEBUG_INFO,"fill width : %d , height : %d\n",width,height));
-  for (I = 0; I < Height; I++) {
-    for (J = 0; J < Stride / 4; J++) {
-      PhyFramebufferWrite (Private, I * Stride + J * 4, 1, &Blt);
-    }
-  }
-}
-
 /**
  *
 **/
@@ -229,17 +196,16 @@ InitializeGraphicsMode(
   )
 {
   DEBUG ((DEBUG_INFO, "%a(),%d\n", __FUNCTION__, __LINE__));
-  //EFI_STATUS  Status;
+  EFI_STATUS  Status;
   UINT32  DpNum;
   //UINT32   PixelClock;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL  Blt;
   DpNum = 0;
   //clear to black
-  Blt.Blue = 0;
-  Blt.Green = 0;
-  Blt.Red = 0x0;
-  Blt.Reserved = 0;
-  VideoFillFramebuffer (Private, GopMode->Width, GopMode->Height, Blt);
+  Status = PhyGopCoreSetMode (&Private->GopCore, GopMode->Width, GopMode->Height, WidthToStride (GopMode->Width));
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
   for (DpNum = 0; DpNum < DPDC_PATH_NUM; DpNum++) {
     if (Private->DpIsUsed[DpNum] == 0){
       continue;
@@ -299,352 +265,6 @@ InitializeGraphicsMode(
   return EFI_SUCCESS;
 }
 
-/**
-  Performs a UEFI Graphics Output Protocol Blt Video to Buffer operation
-  with extended parameters.
-
-  @param[in]  Private  Pointer to private data structure
-
-  @param[in]  Num      the index of dcdp , 0 , 1 or 2
-
-  @param[out] BltBuffer     Output buffer for pixel color data
-
-  @param[in]  SourceX       X location within video
-
-  @param[in]  SourceY       Y location within video
-
-  @param[in]  DestinationX  X location within BltBuffer
-
-  @param[in]  DestinationY  Y location within BltBuffer
-
-  @param[in]  Width         Width (in pixels)
-
-  @param[in]  Height        Height
-
-  @param[in]  Delta         Number of bytes in a row of BltBuffer
-
-  @retval  EFI_DEVICE_ERROR A hardware error occured
-
-  @retval  EFI_INVALID_PARAMETER  Invalid parameter passed in
-
-  @retval  EFI_SUCCESS  Success.
-**/
-EFI_STATUS
-BltVideoToBltBuffer (
-  IN  PHY_PRIVATE_DATA                      *Private,
-  IN  UINT8                                 Num,
-  OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL         *BltBuffer,
-  IN  UINTN                                 SourceX,
-  IN  UINTN                                 SourceY,
-  IN  UINTN                                 DestinationX,
-  IN  UINTN                                 DestinationY,
-  IN  UINTN                                 Width,
-  IN  UINTN                                 Height,
-  IN  UINTN                                 Delta
-  )
-{
-  EFI_STATUS  Status;
-  Status = EFI_SUCCESS;
-  UINT32  ResWidth;
-  UINT32  ResHeight;
-  UINT32  PixelWidth;
-  UINT32  Stride;
-  UINT32  SrcY;
-  UINT32  DstY;
-  UINTN   Offset;
-  ASSERT (Num < 3);
-  ResWidth = Private->ModeData[Private->ModeNum].Width;
-  ResHeight = Private->ModeData[Private->ModeNum].Height;
-  Stride = WidthToStride (ResWidth);
-  PixelWidth = Private->ModeData[Private->ModeNum].ColorDepth / 8;
-  //DEBUG((DEBUG_INFO,"Private->ModeNum : %d\n",Private->ModeNum));
-  //DEBUG((DEBUG_INFO,"resWidth : %d , resHeight : %d,SourceX : %d,SourceY : %d,DestinationX:%d,DestinationY:%d\n",
-    //ResWidth,ResHeight,SourceX,SourceY,DestinationX,DestinationY));
-  if (DestinationY + Height > ResHeight) {
-    DEBUG ((DEBUG_ERROR, "VideotoBuffer: Past screen (Y)\n"));
-    return EFI_INVALID_PARAMETER;
-  }
-
-  if (DestinationX + Width > ResWidth) {
-    DEBUG ((DEBUG_ERROR, "VideotoBuffer: Past screen (X)\n"));
-    return EFI_INVALID_PARAMETER;
-  }
-
-  if ((Width == 0) || (Height == 0)) {
-    DEBUG ((DEBUG_ERROR, "VideotoBuffer: Width or Height is 0\n"));
-    return EFI_INVALID_PARAMETER;
-  }
-  //
-  // If Delta is zero, then the entire BltBuffer is being used, so Delta
-  // is the Number of bytes in each row of BltBuffer.  Since BltBuffer is Width pixels size,
-  // the Number of bytes in each row can be computed.
-  //
-  if (Delta == 0) {
-    Delta = Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
-  }
-
-  for (SrcY = SourceY, DstY = DestinationY; DstY < (Height + DestinationY); SrcY++, DstY++) {
-      Offset = SrcY * Stride + SourceX * PixelWidth;
-      PhyFramebufferRead (Private, Offset, Width, (UINT8 *) (BltBuffer) + Delta * DstY + DestinationX * PixelWidth);
-  }
-  return Status;
-}
-
-/**
-  Performs a UEFI Graphics Output Protocol Blt Video to Video operation
-
-  @param[in]  Private  Pointer to private data structure
-
-  @param[in]  Num      the index of dcdp , 0 , 1 or 2
-
-  @param[in]  Private  Pointer to private data structure
-
-  @param[in]  Num      the index of dcdp , 0 , 1 or 2
-
-  @param[in]  SourceX       X location within video
-
-  @param[in]  SourceY       Y location within video
-
-  @param[in]  DestinationX  X location within video
-
-  @param[in]  DestinationY  Y location within video
-
-  @param[in]  Width         Width (in pixels)
-
-  @param[in]  Height        Height
-
-  @retval  EFI_DEVICE_ERROR  A hardware error occured
-
-  @retval  EFI_INVALID_PARAMETER  Invalid parameter passed in
-
-  @retval  EFI_SUCCESS  Success.
-**/
-EFI_STATUS
-BltVideoToVideo (
-  IN  PHY_PRIVATE_DATA                      *Private,
-  IN  UINT8                                 Num,
-  IN  UINTN                                 SourceX,
-  IN  UINTN                                 SourceY,
-  IN  UINTN                                 DestinationX,
-  IN  UINTN                                 DestinationY,
-  IN  UINTN                                 Width,
-  IN  UINTN                                 Height
-  )
-{
-  EFI_STATUS  Status;
-  Status = EFI_SUCCESS;
-  UINT32  ResWidth;
-  UINT32  ResHeight;
-  UINT32  PixelWidth;
-  UINT32  Stride;
-  UINT32  SrcY;
-  UINT32  DstY;
-  UINTN   Offset;
- // DEBUG((DEBUG_INFO,"Width:%d,Height:%d,SourceX : %d,SourceY : %d,DestinationX:%d,DestinationY:%d\n",Width,Height,SourceX,SourceY,DestinationX,DestinationY));
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *Blt;
-  ASSERT (Num < 3);
-  ResWidth = Private->ModeData[Private->ModeNum].Width;
-  ResHeight = Private->ModeData[Private->ModeNum].Height;
-  Stride = WidthToStride (ResWidth);
-  PixelWidth = Private->ModeData[Private->ModeNum].ColorDepth / 8;
-  if (DestinationY + Height > ResHeight) {
-    DEBUG ((DEBUG_ERROR, "VideotoVedeo: Past screen (Y)\n"));
-    return EFI_INVALID_PARAMETER;
-  }
-
-  if (DestinationX + Width > ResWidth) {
-    DEBUG ((DEBUG_ERROR, "VideotoVedeo: Past screen (X)\n"));
-    return EFI_INVALID_PARAMETER;
-  }
-
-  if (Width == 0 || Height == 0) {
-    DEBUG ((DEBUG_ERROR, "VideotoBuffer: Width or Height is 0\n"));
-    return EFI_INVALID_PARAMETER;
-  }
-  Blt = AllocatePool(Width * Height * PixelWidth);
-  if(Blt == NULL){
-    DEBUG((DEBUG_INFO,"VideotoVedeo blt alloc failed\n"));
-    return EFI_BUFFER_TOO_SMALL;
-  }
-  //
-  //video to buffer
-  //
-  for (SrcY = SourceY, DstY = 0; SrcY < (Height + SourceY); SrcY++, DstY++) {
-    Offset = SrcY * Stride + SourceX * PixelWidth;
-    //DEBUG((DEBUG_INFO,"SrcY:%d,Offset:%d,Width:%d\n",SrcY,Offset,Width));
-    PhyFramebufferRead (Private, Offset, Width, (UINT8 *) (Blt) + Width * DstY * PixelWidth);
-  }
-  //
-  //buffer to video
-  //
-  for (SrcY = 0, DstY = DestinationY; SrcY < (Height); SrcY++, DstY++) {
-    Offset = DstY * Stride + DestinationX * PixelWidth;
-    //DEBUG((DEBUG_INFO,"SrcY:%d,Offset:%d,Width:%d\n",SrcY,Offset,Width));
-    PhyFramebufferWrite (Private, Offset, Width, (UINT8 *) (Blt) + Width * SrcY * PixelWidth);
-  }
-  FreePool(Blt);
-  return Status;
-}
-
-/**
-  Performs a UEFI Graphics Output Protocol Blt Video Fill.
-
-  @param[in]  Private  Pointer to private data structure
-
-  @param[in]  Num      the index of dcdp , 0 , 1 or 2
-
-  @param[in]  Color         Color to fill the region with
-
-  @param[in]  DestinationX  X location to start fill operation
-
-  @param[in]  DestinationY  Y location to start fill operation
-
-  @param[in]  Width         Width (in pixels) to fill
-
-  @param[in]  Height        Height to fill
-
-  @retval  EFI_DEVICE_ERROR  A hardware error occured
-
-  @retval  EFI_INVALID_PARAMETER  Invalid parameter passed in
-
-  @retval  EFI_SUCCESS  Success.
-**/
-EFI_STATUS
-BltVideoToFill (
-  IN PHY_PRIVATE_DATA                      *Private,
-  IN UINT8                                 Num,
-  IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL         *Color,
-  IN UINTN                                 DestinationX,
-  IN UINTN                                 DestinationY,
-  IN UINTN                                 Width,
-  IN UINTN                                 Height
-  )
-{
-  UINT32  ResWidth;
-  UINT32  ResHeight;
-  UINT32  Stride;
-  UINT32  I;
-  UINT32  J;
-  UINT32  Blt;
-  ASSERT (Num < 3);
-  ResWidth = Private->ModeData[Private->ModeNum].Width;
-  ResHeight = Private->ModeData[Private->ModeNum].Height;
-  Stride = WidthToStride (ResWidth);
-  CopyMem (&Blt, Color, sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
-  //DEBUG((DEBUG_INFO,"desy : %d,height:%d,resheight:%d\n",DestinationY,Height,resHeight));
-  if (DestinationY + Height > ResHeight) {
-    DEBUG ((DEBUG_ERROR, "VideoFill: Past screen (Y)\n"));
-    return EFI_INVALID_PARAMETER;
-  }
-
-  if (DestinationX + Width > ResWidth) {
-    DEBUG ((DEBUG_ERROR, "VideoFill: Past screen (X)\n"));
-    return EFI_INVALID_PARAMETER;
-  }
-
-  if (Width == 0 || Height == 0) {
-    DEBUG ((DEBUG_ERROR, "VideoFill: Width or Height is 0\n"));
-    return EFI_INVALID_PARAMETER;
-  }
-  for (I = DestinationY; I < (DestinationY + Height); I++) {
-    for (J = DestinationX; J < (DestinationX + Width); J++) {
-      PhyFramebufferWrite (Private, I * Stride + J * 4, 1, &Blt);
-    }
-  }
-  return EFI_SUCCESS;
-}
-
-/**
-  Performs a UEFI Graphics Output Protocol Blt Buffer to Video operation
-  with extended parameters.
-
-  @param[in]  Private  Pointer to private data structure
-
-  @param[in]  Num      the index of dcdp , 0 , 1 or 2
-
-  @param[in]  BltBuffer     Output buffer for pixel color data
-
-  @param[in]  SourceX       X location within BltBuffer
-
-  @param[in]  SourceY       Y location within BltBuffer
-
-  @param[in]  DestinationX  X location within video
-
-  @param[in]  DestinationY  Y location within video
-
-  @param[in]  Width         Width (in pixels)
-
-  @param[in]  Height        Height
-
-  @param[in]  Delta         Number of bytes in a row of BltBuffer
-
-  @retval  EFI_DEVICE_ERROR  A hardware error occured
-
-  @retval  EFI_INVALID_PARAMETER  Invalid parameter passed in
-
-  @retval  EFI_SUCCESS  The sizes were returned
-**/
-EFI_STATUS
-BltBufferToVideo (
-  IN PHY_PRIVATE_DATA                       *Private,
-  IN UINT8                                   Num,
-  IN  EFI_GRAPHICS_OUTPUT_BLT_PIXEL         *BltBuffer,
-  IN  UINTN                                 SourceX,
-  IN  UINTN                                 SourceY,
-  IN  UINTN                                 DestinationX,
-  IN  UINTN                                 DestinationY,
-  IN  UINTN                                 Width,
-  IN  UINTN                                 Height,
-  IN  UINTN                                 Delta
-  )
-{
-  UINT32 Status;
-  ASSERT (Num < 3);
-  UINT32  ResWidth;
-  UINT32  ResHeight;
-  UINT32  Stride;
-  UINT32  SrcY;
-  UINT32  DstY;
-  UINT32  Offset;
-  UINT32  PixelWidth;
-  Status = EFI_SUCCESS;
-  ASSERT (Num < 3);
-  ResWidth = Private->ModeData[Private->ModeNum].Width;
-  ResHeight = Private->ModeData[Private->ModeNum].Height;
-  PixelWidth = Private->ModeData[Private->ModeNum].ColorDepth / 8;
-  Stride = WidthToStride (ResWidth);
-  //DEBUG((DEBUG_INFO,"Private->ModeNum : %d\n",Private->ModeNum));
-  //DEBUG((DEBUG_INFO,"resWidth : %d , resHeight : %d, stride : %d,SourceX : %d,SourceY : %d,DestinationX:%d,DestinationY:%d\n",
-    //resWidth,resHeight,stride,SourceX,SourceY,DestinationX,DestinationY));
-  if (DestinationY + Height > ResHeight) {
-    DEBUG ((DEBUG_ERROR, "BufferToVideo: Past screen (Y)\n"));
-    return EFI_INVALID_PARAMETER;
-  }
-
-  if (DestinationX + Width > ResWidth) {
-    DEBUG ((DEBUG_ERROR, "BufferToVideo: Past screen (X)\n"));
-    return EFI_INVALID_PARAMETER;
-  }
-
-  if (Width == 0 || Height == 0) {
-    DEBUG ((DEBUG_ERROR, "BufferToVideo: Width or Height is 0\n"));
-    return EFI_INVALID_PARAMETER;
-  }
-  //
-  // If Delta is zero, then the entire BltBuffer is being used, so Delta
-  // is the Number of bytes in each row of BltBuffer.  Since BltBuffer is Width pixels size,
-  // the Number of bytes in each row can be computed.
-  //
-  if (Delta == 0) {
-    Delta = Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
-  }
-
-  for (SrcY = SourceY, DstY = DestinationY; SrcY < (Height + SourceY); SrcY++, DstY++) {
-      Offset = DstY * Stride + DestinationX * PixelWidth;
-      PhyFramebufferWrite (Private, Offset, Width, (UINT8 *) (BltBuffer) + Delta * SrcY + SourceX * PixelWidth);
-  }
-  return Status;
-}
 /**
   Graphics Output protocol interface to query video mode
 
@@ -724,6 +344,7 @@ PhyGraphicsOutputSetMode (
   IN  UINT32                       ModeNumber
   )
 {
+  EFI_STATUS        Status;
   PHY_PRIVATE_DATA  *Private;
   PHY_GOP_MODE       *ModeData;
   DEBUG((DEBUG_INFO,"SetMode --- %d\n",ModeNumber));
@@ -752,7 +373,14 @@ PhyGraphicsOutputSetMode (
     return EFI_OUT_OF_RESOURCES;
   }
 
-  InitializeGraphicsMode (Private, &mPhyGopMode[ModeNumber]);
+  Status = InitializeGraphicsMode (Private, &mPhyGopMode[ModeNumber]);
+  if (EFI_ERROR (Status)) {
+    //
+    //The core kept the previous mode, so must the GOP mode
+    //
+    DEBUG ((DEBUG_ERROR, "SetMode %d failed : %r\n", ModeNumber, Status));
+    return EFI_DEVICE_ERROR;
+  }
   This->Mode->Mode = ModeNumber;
   This->Mode->Info->HorizontalResolution = ModeData->Width;
   This->Mode->Info->VerticalResolution  = ModeData->Height;
@@ -841,23 +469,22 @@ PhyGraphicsOutputBlt (
   //DEBUG((DEBUG_INFO,"Private->ModeNum : %d\n",Private->ModeNum));
   //DEBUG((DEBUG_INFO,"Width:%d,Height:%d,SourceX : %d,SourceY : %d,DestinationX:%d,DestinationY:%d\n",Width,Height,SourceX,SourceY,DestinationX,DestinationY));
   OriginalTPL = gBS->RaiseTPL (TPL_NOTIFY);
-  switch (BltOperation) {
-  case EfiBltVideoToBltBuffer:
-    Status = BltVideoToBltBuffer (Private, 0, BltBuffer, SourceX, SourceY, DestinationX, DestinationY, Width, Height, Delta);
-    break;
-  case EfiBltVideoToVideo:
-    Status = BltVideoToVideo (Private, 0, SourceX, SourceY, DestinationX, DestinationY, Width, Height);
-    break;
-  case EfiBltVideoFill:
-    Status = BltVideoToFill (Private, 0, BltBuffer, DestinationX, DestinationY, Width, Height);
-    break;
-  case EfiBltBufferToVideo:
-    Status = BltBufferToVideo (Private, 0, BltBuffer, SourceX, SourceY, DestinationX, DestinationY, Width, Height, Delta);
-    break;
-  default:
-    Status = EFI_INVALID_PARAMETER ;
-    break;
-  }
+  Status = PhyGopCoreBlt (
+             &Private->GopCore,
+             BltBuffer,
+             BltOperation,
+             SourceX,
+             SourceY,
+             DestinationX,
+             DestinationY,
+             Width,
+             Height,
+             Delta
+             );
+  //
+  // A scroll may have moved the scan-out address
+  //
+  This->Mode->FrameBufferBase = PhyGopCoreGetFrameBuffer (&Private->GopCore);
   gBS->RestoreTPL (OriginalTPL);
   return Status;
 }
@@ -991,6 +618,51 @@ DpSinkHotPlugCheck (
 }
 
 
+/**
+  Point every used display path at a new scan-out address.
+
+  @param[in]  Context  Pointer to private data structure.
+  @param[in]  Address  The address of the first visible pixel.
+**/
+VOID
+EFIAPI
+PhyGopSetScanout (
+  IN VOID                  *Context,
+  IN EFI_PHYSICAL_ADDRESS  Address
+  )
+{
+  PHY_PRIVATE_DATA  *Private;
+  UINT8             Index;
+
+  Private = (PHY_PRIVATE_DATA *) Context;
+  for (Index = 0; Index < DPDC_PATH_NUM; Index++) {
+    if (Private->DpIsUsed[Index] == 0) {
+      continue;
+    }
+    ConfFramebufferSetAddress (Private, Index, Address);
+  }
+}
+
+/**
+  Move the screen back to the start of the framebuffer before the OS takes over.
+
+  @param  Event        Event whose notification function is being invoked.
+  @param  Context      Pointer to the notification function's context.
+**/
+VOID
+EFIAPI
+PhyGopExitBootServices (
+  IN EFI_EVENT     Event,
+  IN VOID          *Context
+  )
+{
+  PHY_PRIVATE_DATA  *Private;
+
+  Private = (PHY_PRIVATE_DATA *) Context;
+  PhyGopCoreResetScanout (&Private->GopCore);
+  Private->GraphicsOutput.Mode->FrameBufferBase = PhyGopCoreGetFrameBuffer (&Private->GopCore);
+}
+
 /**
   Constructor for the Graphics Output Protocol,initialize,specific variables, information.
 
@@ -1157,12 +829,27 @@ PhyGraphicsOutputConstructor (
   ASSERT (!EFI_ERROR(Status));
   DEBUG ((DEBUG_INFO, "Buffer Addr : %llx\n", Private->BufferAddr));
 #endif
+  Status = PhyGopCoreInit (
+             &Private->GopCore,
+             Private->BufferAddr,
+             EFI_PAGES_TO_SIZE (MRAM_PAGES),
+             PhyGopSetScanout,
+             Private
+             );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "PhyGopCoreInit %r.\n", Status));
+    goto FreeBuffer;
+  }
   //
   // Initialize the hardware
   //
   //init phy
   LinkPhyAllInit (Private);
-  GraphicsOutput->SetMode (GraphicsOutput, Private->GraphicsOutput.Mode->Mode );
+  Status = GraphicsOutput->SetMode (GraphicsOutput, Private->GraphicsOutput.Mode->Mode);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Initial SetMode %r.\n", Status));
+    goto FreeCore;
+  }
   //Create hot plug check event
 #if 1
   Status = gBS->CreateEvent (
@@ -1186,7 +873,34 @@ PhyGraphicsOutputConstructor (
     gBS->CloseEvent (Private->DpSinkHotPlugEvent);
   }
 #endif
+  Status = gBS->CreateEvent (
+                  EVT_SIGNAL_EXIT_BOOT_SERVICES,
+                  TPL_NOTIFY,
+                  PhyGopExitBootServices,
+                  Private,
+                  &Private->ExitBootServicesEvent
+                  );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "gBS->CreateEvent for ExitBootServicesEvent %r.\n", Status));
+  }
   return EFI_SUCCESS;
+
+FreeCore:
+  if (Private->LineBuffer != NULL) {
+    gBS->FreePool (Private->LineBuffer);
+    Private->LineBuffer = NULL;
+  }
+  PhyGopCoreFree (&Private->GopCore);
+FreeBuffer:
+#ifndef MAIN_RAM_USE
+  gBS->FreePages (Private->ShadowBuffer, MRAM_PAGES);
+#else
+  gBS->FreePages (Private->BufferAddr, MRAM_PAGES);
+#endif
+  gBS->FreePool (Private->GraphicsOutput.Mode->Info);
+  gBS->FreePool (Private->GraphicsOutput.Mode);
+  Private->GraphicsOutput.Mode = NULL;
+  return Status;
 }
 
 /**
@@ -1202,6 +916,8 @@ PhyGraphicsOutputDestructor (
   )
 {
   gBS->CloseEvent (Private->DpSinkHotPlugEvent);
+  gBS->CloseEvent (Private->ExitBootServicesEvent);
+  PhyGopCoreFree (&Private->GopCore);
 
   if (Private->GraphicsOutput.Mode != NULL) {
     if (Private->GraphicsOutput.Mode->Info != NULL) {
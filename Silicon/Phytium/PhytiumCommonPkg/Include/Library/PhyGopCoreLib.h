@@ -0,0 +1,176 @@
+/** @file
+  Common Graphics Output Blt core of the Phytium display controller drivers.
+
+  The Phytium SoC, X100 and BMC GOP drivers scan out of a 32bpp linear
+  framebuffer. This library keeps an optional system memory copy of the
+  visible surface so reads never touch the framebuffer, and scrolls the whole
+  screen by moving the display controller scan-out address instead of copying
+  pixels when the driver provides a scan-out callback.
+
+  The framebuffer must be mapped as normal memory, which is the case for the
+  MAIN_RAM_USE framebuffer the drivers allocate from system memory.
+
+  Copyright (C) 2023, Phytium Technology Co., Ltd. All rights reserved.<BR>
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef PHY_GOP_CORE_LIB_H_
+#define PHY_GOP_CORE_LIB_H_
+
+#include <Uefi.h>
+#include <Protocol/GraphicsOutput.h>
+
+/**
+  Program the display controller to scan out from a new framebuffer address.
+
+  @param[in]  Context   The context given to PhyGopCoreInit.
+  @param[in]  Address   The address of the first visible pixel.
+**/
+typedef
+VOID
+(EFIAPI *PHY_GOP_CORE_SET_SCANOUT) (
+  IN VOID                  *Context,
+  IN EFI_PHYSICAL_ADDRESS  Address
+  );
+
+typedef struct {
+  //
+  // Framebuffer memory owned by the driver
+  //
+  EFI_PHYSICAL_ADDRESS       FrameBufferBase;
+  UINTN                      FrameBufferSize;
+  PHY_GOP_CORE_SET_SCANOUT   SetScanout;
+  VOID                       *Context;
+  //
+  // Current mode
+  //
+  UINT32                     Width;
+  UINT32                     Height;
+  UINT32                     Stride;
+  //
+  // System memory copy of the visible surface, Width pixels per line
+  //
+  UINT32                     *Shadow;
+  //
+  // First framebuffer line scanned out and the last usable one
+  //
+  UINT32                     ScanoutLine;
+  UINT32                     MaxScanoutLine;
+} PHY_GOP_CORE;
+
+/**
+  Initialize a GOP core instance over a framebuffer.
+
+  @param[out] Core             The GOP core instance.
+  @param[in]  FrameBufferBase  CPU address of the framebuffer memory.
+  @param[in]  FrameBufferSize  Size in bytes of the framebuffer memory.
+  @param[in]  SetScanout       Scan-out address callback, NULL if the
+                               controller cannot pan.
+  @param[in]  Context          Context passed to SetScanout.
+
+  @retval EFI_SUCCESS            The instance is initialized.
+  @retval EFI_INVALID_PARAMETER  Core is NULL or the framebuffer is empty.
+**/
+EFI_STATUS
+EFIAPI
+PhyGopCoreInit (
+  OUT PHY_GOP_CORE              *Core,
+  IN  EFI_PHYSICAL_ADDRESS      FrameBufferBase,
+  IN  UINTN                     FrameBufferSize,
+  IN  PHY_GOP_CORE_SET_SCANOUT  SetScanout,  OPTIONAL
+  IN  VOID                      *Context     OPTIONAL
+  );
+
+/**
+  Switch the core to a new mode and clear the visible surface to black.
+
+  @param[in,out] Core     The GOP core instance.
+  @param[in]     Width    Horizontal resolution in pixels.
+  @param[in]     Height   Vertical resolution in pixels.
+  @param[in]     Stride   Bytes per framebuffer line.
+
+  @retval EFI_SUCCESS            The mode is set.
+  @retval EFI_INVALID_PARAMETER  The mode does not fit in the framebuffer.
+**/
+EFI_STATUS
+EFIAPI
+PhyGopCoreSetMode (
+  IN OUT PHY_GOP_CORE  *Core,
+  IN     UINT32        Width,
+  IN     UINT32        Height,
+  IN     UINT32        Stride
+  );
+
+/**
+  Perform a Graphics Output Protocol Blt operation on the current mode.
+
+  @param[in,out] Core          The GOP core instance.
+  @param[in,out] BltBuffer     The data to transfer to or from the screen.
+  @param[in]     BltOperation  The operation to perform.
+  @param[in]     SourceX       The X coordinate of the source.
+  @param[in]     SourceY       The Y coordinate of the source.
+  @param[in]     DestinationX  The X coordinate of the destination.
+  @param[in]     DestinationY  The Y coordinate of the destination.
+  @param[in]     Width         The width of the rectangle in pixels.
+  @param[in]     Height        The height of the rectangle in pixels.
+  @param[in]     Delta         Bytes per row of BltBuffer, 0 for Width pixels.
+
+  @retval EFI_SUCCESS            The operation is done.
+  @retval EFI_INVALID_PARAMETER  The operation or the rectangle is invalid.
+**/
+EFI_STATUS
+EFIAPI
+PhyGopCoreBlt (
+  IN OUT PHY_GOP_CORE                       *Core,
+  IN OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL      *BltBuffer,  OPTIONAL
+  IN     EFI_GRAPHICS_OUTPUT_BLT_OPERATION  BltOperation,
+  IN     UINTN                              SourceX,
+  IN     UINTN                              SourceY,
+  IN     UINTN                              DestinationX,
+  IN     UINTN                              DestinationY,
+  IN     UINTN                              Width,
+  IN     UINTN                              Height,
+  IN     UINTN                              Delta
+  );
+
+/**
+  Return the address of the first visible pixel.
+
+  @param[in]  Core   The GOP core instance.
+
+  @return  The framebuffer address currently scanned out.
+**/
+EFI_PHYSICAL_ADDRESS
+EFIAPI
+PhyGopCoreGetFrameBuffer (
+  IN PHY_GOP_CORE  *Core
+  );
+
+/**
+  Move the visible surface back to the start of the framebuffer.
+
+  Used before the framebuffer is handed over to a consumer that only knows
+  the framebuffer base, e.g. at ExitBootServices.
+
+  @param[in,out] Core   The GOP core instance.
+**/
+VOID
+EFIAPI
+PhyGopCoreResetScanout (
+  IN OUT PHY_GOP_CORE  *Core
+  );
+
+/**
+  Release the resources of a GOP core instance.
+
+  @param[in,out] Core   The GOP core instance.
+**/
+VOID
+EFIAPI
+PhyGopCoreFree (
+  IN OUT PHY_GOP_CORE  *Core
+  );
+
+#endif // PHY_GOP_CORE_LIB_H_
@@ -0,0 +1,59 @@
+/** @file
+  Pre-rendered GOP logo format.
+
+  A logo file holds one or more images already converted to
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL, top-down, so drawing it is a single
+  EfiBltBufferToVideo. Images are produced by GopLogoTool.py from BMP files,
+  optionally one per GOP mode resolution.
+
+  Copyright (C) 2023, Phytium Technology Co., Ltd. All rights reserved.<BR>
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef GOP_LOGO_H_
+#define GOP_LOGO_H_
+
+#define GOP_LOGO_SIGNATURE     SIGNATURE_32 ('P', 'L', 'G', 'O')
+
+//
+// Pixels stored as Width * Height EFI_GRAPHICS_OUTPUT_BLT_PIXEL
+//
+#define GOP_LOGO_ENCODING_RAW  0
+//
+// Pixels stored as GOP_LOGO_RUN records
+//
+#define GOP_LOGO_ENCODING_RLE  1
+
+#pragma pack(1)
+
+typedef struct {
+  UINT32  Signature;
+  UINT32  Count;
+} GOP_LOGO_HEADER;
+
+typedef struct {
+  //
+  // Mode resolution the image is rendered for, 0 for any mode
+  //
+  UINT32  HorizontalResolution;
+  UINT32  VerticalResolution;
+  UINT32  Width;
+  UINT32  Height;
+  UINT32  Encoding;
+  //
+  // Pixel data, relative to the start of the file
+  //
+  UINT32  Offset;
+  UINT32  Size;
+} GOP_LOGO_IMAGE;
+
+typedef struct {
+  UINT32  Count;
+  UINT32  Pixel;
+} GOP_LOGO_RUN;
+
+#pragma pack()
+
+#endif // GOP_LOGO_H_
@@ -0,0 +1,82 @@
+## @file
+#  Convert BMP logos into the pre-rendered GOP logo format read by LogoLib.
+#
+#  Each input is converted to top-down EFI_GRAPHICS_OUTPUT_BLT_PIXEL rows and
+#  run-length encoded. An optional resolution suffix binds an image to the
+#  GOP mode it is drawn for, an image without one is used for any mode.
+#
+#    GopLogoTool.py -o PhytiumLogo_en.logo PhytiumLogo_en.bmp
+#    GopLogoTool.py -o Logo.logo Logo_1080p.bmp@1920x1080 Logo_768p.bmp@1024x768
+#
+#  Copyright (C) 2023, Phytium Technology Co., Ltd. All rights reserved.<BR>
+#
+#  SPDX-License-Identifier: BSD-2-Clause-Patent
+##
+
+import argparse
+import struct
+
+GOP_LOGO_SIGNATURE     = b'PLGO'
+GOP_LOGO_ENCODING_RAW  = 0
+GOP_LOGO_ENCODING_RLE  = 1
+HEADER_FORMAT          = '<4sI'
+IMAGE_FORMAT           = '<7I'
+
+def ReadBmp (Path):
+    Data = open (Path, 'rb').read ()
+    if Data[0:2] != b'BM':
+        raise ValueError ('%s is not a BMP file' % Path)
+    Offset, = struct.unpack_from ('<I', Data, 10)
+    Width, Height, _, Bpp, Compression = struct.unpack_from ('<iiHHI', Data, 18)
+    if Compression != 0 or Bpp not in (24, 32):
+        raise ValueError ('%s: only uncompressed 24 and 32 bit BMP are supported' % Path)
+    TopDown = Height < 0
+    Height  = abs (Height)
+    RowSize = ((Width * Bpp + 31) // 32) * 4
+    Pixels  = []
+    for Y in range (Height):
+        Row = Offset + (Y if TopDown else Height - 1 - Y) * RowSize
+        for X in range (Width):
+            Pixel = Row + X * (Bpp // 8)
+            Pixels.append (Data[Pixel:Pixel + 3] + b'\x00')
+    return Width, Height, Pixels
+
+def EncodeRle (Pixels):
+    Output = bytearray ()
+    Index  = 0
+    while Index < len (Pixels):
+        Count = 1
+        while Index + Count < len (Pixels) and Pixels[Index + Count] == Pixels[Index]:
+            Count += 1
+        Output += struct.pack ('<I', Count) + Pixels[Index]
+        Index  += Count
+    return bytes (Output)
+
+def main ():
+    Parser = argparse.ArgumentParser (description = 'Convert BMP logos into the LogoLib GOP logo format')
+    Parser.add_argument ('-o', '--output', required = True)
+    Parser.add_argument ('--raw', action = 'store_true', help = 'store pixels without run-length encoding')
+    Parser.add_argument ('images', nargs = '+', help = 'BMP file, optionally suffixed with @<width>x<height>')
+    Args = Parser.parse_args ()
+
+    Images = []
+    for Image in Args.images:
+        Path, _, Mode = Image.partition ('@')
+        ModeX, ModeY = (int (Value) for Value in Mode.split ('x')) if Mode else (0, 0)
+        Width, Height, Pixels = ReadBmp (Path)
+        if Args.raw:
+            Images.append ((ModeX, ModeY, Width, Height, GOP_LOGO_ENCODING_RAW, b''.join (Pixels)))
+        else:
+            Images.append ((ModeX, ModeY, Width, Height, GOP_LOGO_ENCODING_RLE, EncodeRle (Pixels)))
+
+    Offset = struct.calcsize (HEADER_FORMAT) + len (Images) * struct.calcsize (IMAGE_FORMAT)
+    Output = bytearray (struct.pack (HEADER_FORMAT, GOP_LOGO_SIGNATURE, len (Images)))
+    for ModeX, ModeY, Width, Height, Encoding, Data in Images:
+        Output += struct.pack (IMAGE_FORMAT, ModeX, ModeY, Width, Height, Encoding, Offset, len (Data))
+        Offset += len (Data)
+    for Image in Images:
+        Output += Image[5]
+    open (Args.output, 'wb').write (Output)
+
+if __name__ == '__main__':
+    main ()
@@ -14,6 +14,131 @@
 #include <IndustryStandard/Bmp.h>
 #include <Protocol/BootLogo.h>
 
+#include "GopLogo.h"
+
+/**
+  Pick the image of a pre-rendered GOP logo to draw on the screen.
+
+  An image rendered for the screen resolution is preferred, otherwise the
+  largest image that fits on the screen is used.
+
+  @param[in]  ImageData  The logo file.
+  @param[in]  ImageSize  The size of the logo file.
+  @param[in]  SizeOfX    Horizontal resolution of the screen.
+  @param[in]  SizeOfY    Vertical resolution of the screen.
+
+  @retval     NULL       The file is not a GOP logo or no image fits.
+  @retval     other      The image to draw.
+**/
+STATIC
+GOP_LOGO_IMAGE *
+GopLogoSelectImage (
+  IN UINT8   *ImageData,
+  IN UINTN   ImageSize,
+  IN UINT32  SizeOfX,
+  IN UINT32  SizeOfY
+  )
+{
+  GOP_LOGO_HEADER  *Header;
+  GOP_LOGO_IMAGE   *Image;
+  GOP_LOGO_IMAGE   *Best;
+  UINT32           Index;
+
+  Header = (GOP_LOGO_HEADER *) ImageData;
+  if ((ImageSize < sizeof (GOP_LOGO_HEADER)) ||
+      (Header->Signature != GOP_LOGO_SIGNATURE) ||
+      (Header->Count > (ImageSize - sizeof (GOP_LOGO_HEADER)) / sizeof (GOP_LOGO_IMAGE))) {
+    return NULL;
+  }
+
+  Best  = NULL;
+  Image = (GOP_LOGO_IMAGE *) (Header + 1);
+  for (Index = 0; Index < Header->Count; Index++, Image++) {
+    if ((Image->Width > SizeOfX) || (Image->Height > SizeOfY) ||
+        (Image->Offset > ImageSize) || (Image->Size > ImageSize - Image->Offset)) {
+      continue;
+    }
+    if ((Image->HorizontalResolution == SizeOfX) && (Image->VerticalResolution == SizeOfY)) {
+      return Image;
+    }
+    if ((Best == NULL) ||
+        ((UINT64) Image->Width * Image->Height > (UINT64) Best->Width * Best->Height)) {
+      Best = Image;
+    }
+  }
+
+  return Best;
+}
+
+/**
+  Get the pixels of a pre-rendered GOP logo image.
+
+  Raw images are used in place, run-length encoded images are expanded into
+  a new buffer.
+
+  @param[in]  ImageData  The logo file.
+  @param[in]  Image      The image to decode.
+  @param[out] Pixels     The pixels to draw.
+  @param[out] Blt        The buffer to free, NULL if Pixels points into ImageData.
+
+  @retval EFI_SUCCESS           The pixels are ready.
+  @retval EFI_OUT_OF_RESOURCES  No memory to expand the image.
+  @retval EFI_VOLUME_CORRUPTED  The image data does not match its size.
+  @retval EFI_UNSUPPORTED       Unknown encoding.
+**/
+STATIC
+EFI_STATUS
+GopLogoDecode (
+  IN  UINT8                          *ImageData,
+  IN  GOP_LOGO_IMAGE                 *Image,
+  OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL  **Pixels,
+  OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL  **Blt
+  )
+{
+  UINTN         PixelCount;
+  UINTN         Index;
+  GOP_LOGO_RUN  *Run;
+  GOP_LOGO_RUN  *RunEnd;
+
+  PixelCount = (UINTN) Image->Width * Image->Height;
+  *Blt = NULL;
+
+  switch (Image->Encoding) {
+  case GOP_LOGO_ENCODING_RAW:
+    if ((Image->Size < PixelCount * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)) ||
+        ((Image->Offset & (sizeof (UINT32) - 1)) != 0)) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+    *Pixels = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) (ImageData + Image->Offset);
+    return EFI_SUCCESS;
+
+  case GOP_LOGO_ENCODING_RLE:
+    if ((Image->Offset & (sizeof (UINT32) - 1)) != 0) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+    *Blt = AllocatePool (PixelCount * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+    if (*Blt == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    Run    = (GOP_LOGO_RUN *) (ImageData + Image->Offset);
+    RunEnd = Run + Image->Size / sizeof (GOP_LOGO_RUN);
+    for (Index = 0; (Run < RunEnd) && (Run->Count <= PixelCount - Index); Run++) {
+      SetMem32 (*Blt + Index, Run->Count * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL), Run->Pixel);
+      Index += Run->Count;
+    }
+    if (Index != PixelCount) {
+      FreePool (*Blt);
+      *Blt = NULL;
+      return EFI_VOLUME_CORRUPTED;
+    }
+    *Pixels = *Blt;
+    return EFI_SUCCESS;
+
+  default:
+    return EFI_UNSUPPORTED;
+  }
+}
+
 EFI_STATUS
 EFIAPI
 EnableQuietBoot (
@@ -28,6 +153,8 @@ EnableQuietBoot (
   UINTN                         Height;
   UINTN                         Width;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Blt = NULL;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Pixels = NULL;
+  GOP_LOGO_IMAGE                *Image;
   UINT8                         *ImageData = NULL;
   EFI_GRAPHICS_OUTPUT_PROTOCOL  *GraphicsOutput;
 
@@ -51,14 +178,25 @@ EnableQuietBoot (
     Status = EFI_UNSUPPORTED;
     goto ProcExit;
   }
-  Status = TranslateBmpToGopBlt (
-             ImageData,
-             ImageSize,
-             &Blt,
-             &BltSize,
-             &Height,
-             &Width
-             );
+  Image = GopLogoSelectImage (ImageData, ImageSize, SizeOfX, SizeOfY);
+  if (Image != NULL) {
+    Status = GopLogoDecode (ImageData, Image, &Pixels, &Blt);
+    Width = Image->Width;
+    Height = Image->Height;
+  } else {
+    //
+    // Not a pre-rendered logo, fall back to converting a BMP.
+    //
+    Status = TranslateBmpToGopBlt (
+               ImageData,
+               ImageSize,
+               &Blt,
+               &BltSize,
+               &Height,
+               &Width
+               );
+    Pixels = Blt;
+  }
   if (EFI_ERROR (Status)) {
       Status = EFI_UNSUPPORTED;
       goto ProcExit;
@@ -66,7 +204,7 @@ EnableQuietBoot (
   }
   Status = GraphicsOutput->Blt (
                       GraphicsOutput,
-                      Blt,
+                      Pixels,
                       EfiBltBufferToVideo,
                       0,
                       0,
@@ -0,0 +1,472 @@
+/** @file
+  Common Graphics Output Blt core of the Phytium display controller drivers.
+
+  Every Blt updates the shadow copy first and then writes the touched lines
+  to the framebuffer with whole-line copies. A full screen scroll up, which
+  is what the text console does for every new line at the bottom, only moves
+  the scan-out address and writes the newly exposed lines when panning is
+  enabled. Once the panned surface reaches the end of the framebuffer it is
+  written back to the start in one pass.
+
+  Copyright (C) 2023, Phytium Technology Co., Ltd. All rights reserved.<BR>
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
+#include <Library/PhyGopCoreLib.h>
+
+#define PHY_GOP_CORE_PIXEL_SIZE  sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
+
+/**
+  Return the framebuffer address of a visible line.
+
+  @param[in]  Core   The GOP core instance.
+  @param[in]  Y      The visible line.
+
+  @return  Pointer to the first pixel of the line in the framebuffer.
+**/
+STATIC
+UINT32 *
+FrameBufferLine (
+  IN PHY_GOP_CORE  *Core,
+  IN UINTN         Y
+  )
+{
+  return (UINT32 *)(UINTN)(Core->FrameBufferBase +
+                           (UINT64)(Core->ScanoutLine + Y) * Core->Stride);
+}
+
+/**
+  Return the shadow address of a visible line.
+
+  @param[in]  Core   The GOP core instance.
+  @param[in]  Y      The visible line.
+
+  @return  Pointer to the first pixel of the line in the shadow.
+**/
+STATIC
+UINT32 *
+ShadowLine (
+  IN PHY_GOP_CORE  *Core,
+  IN UINTN         Y
+  )
+{
+  return Core->Shadow + Y * Core->Width;
+}
+
+/**
+  Write visible lines from the shadow to the framebuffer.
+
+  @param[in]  Core   The GOP core instance.
+  @param[in]  Y      The first visible line.
+  @param[in]  Count  The number of lines.
+**/
+STATIC
+VOID
+FlushShadowLines (
+  IN PHY_GOP_CORE  *Core,
+  IN UINTN         Y,
+  IN UINTN         Count
+  )
+{
+  for (; Count > 0; Count--, Y++) {
+    CopyMem (
+      FrameBufferLine (Core, Y),
+      ShadowLine (Core, Y),
+      Core->Width * PHY_GOP_CORE_PIXEL_SIZE
+      );
+  }
+}
+
+/**
+  Program the scan-out address of the current first visible line.
+
+  @param[in]  Core   The GOP core instance.
+**/
+STATIC
+VOID
+UpdateScanout (
+  IN PHY_GOP_CORE  *Core
+  )
+{
+  if (Core->SetScanout != NULL) {
+    Core->SetScanout (Core->Context, PhyGopCoreGetFrameBuffer (Core));
+  }
+}
+
+/**
+  Scroll the whole screen up by moving the scan-out address.
+
+  @param[in,out] Core    The GOP core instance.
+  @param[in]     Lines   The number of lines to scroll.
+**/
+STATIC
+VOID
+PanScrollUp (
+  IN OUT PHY_GOP_CORE  *Core,
+  IN     UINTN         Lines
+  )
+{
+  CopyMem (
+    Core->Shadow,
+    ShadowLine (Core, Lines),
+    (Core->Height - Lines) * Core->Width * PHY_GOP_CORE_PIXEL_SIZE
+    );
+
+  if (Core->ScanoutLine + Lines > Core->MaxScanoutLine) {
+    //
+    // No room left below the visible surface, write it back to the start.
+    //
+    Core->ScanoutLine = 0;
+    FlushShadowLines (Core, 0, Core->Height);
+  } else {
+    Core->ScanoutLine += (UINT32)Lines;
+    FlushShadowLines (Core, Core->Height - Lines, Lines);
+  }
+
+  UpdateScanout (Core);
+}
+
+/**
+  Check whether a video to video Blt is a full screen scroll up that can be
+  done by panning.
+
+  @param[in]  Core      The GOP core instance.
+  @param[in]  SourceX   The X coordinate of the source.
+  @param[in]  SourceY   The Y coordinate of the source.
+  @param[in]  DestinationX  The X coordinate of the destination.
+  @param[in]  DestinationY  The Y coordinate of the destination.
+  @param[in]  Width     The width of the rectangle in pixels.
+  @param[in]  Height    The height of the rectangle in pixels.
+
+  @retval TRUE   The Blt can be done by panning.
+  @retval FALSE  The Blt has to copy pixels.
+**/
+STATIC
+BOOLEAN
+CanPanScroll (
+  IN PHY_GOP_CORE  *Core,
+  IN UINTN         SourceX,
+  IN UINTN         SourceY,
+  IN UINTN         DestinationX,
+  IN UINTN         DestinationY,
+  IN UINTN         Width,
+  IN UINTN         Height
+  )
+{
+  return (BOOLEAN)(Core->MaxScanoutLine > 0 &&
+                   SourceX == 0 && DestinationX == 0 && Width == Core->Width &&
+                   DestinationY == 0 && SourceY > 0 &&
+                   SourceY + Height == Core->Height);
+}
+
+/**
+  Initialize a GOP core instance over a framebuffer.
+
+  @param[out] Core             The GOP core instance.
+  @param[in]  FrameBufferBase  CPU address of the framebuffer memory.
+  @param[in]  FrameBufferSize  Size in bytes of the framebuffer memory.
+  @param[in]  SetScanout       Scan-out address callback, NULL if the
+                               controller cannot pan.
+  @param[in]  Context          Context passed to SetScanout.
+
+  @retval EFI_SUCCESS            The instance is initialized.
+  @retval EFI_INVALID_PARAMETER  Core is NULL or the framebuffer is empty.
+**/
+EFI_STATUS
+EFIAPI
+PhyGopCoreInit (
+  OUT PHY_GOP_CORE              *Core,
+  IN  EFI_PHYSICAL_ADDRESS      FrameBufferBase,
+  IN  UINTN                     FrameBufferSize,
+  IN  PHY_GOP_CORE_SET_SCANOUT  SetScanout,  OPTIONAL
+  IN  VOID                      *Context     OPTIONAL
+  )
+{
+  if ((Core == NULL) || (FrameBufferSize == 0)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  ZeroMem (Core, sizeof (PHY_GOP_CORE));
+  Core->FrameBufferBase = FrameBufferBase;
+  Core->FrameBufferSize = FrameBufferSize;
+  Core->SetScanout      = SetScanout;
+  Core->Context         = Context;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Switch the core to a new mode and clear the visible surface to black.
+
+  @param[in,out] Core     The GOP core instance.
+  @param[in]     Width    Horizontal resolution in pixels.
+  @param[in]     Height   Vertical resolution in pixels.
+  @param[in]     Stride   Bytes per framebuffer line.
+
+  @retval EFI_SUCCESS            The mode is set.
+  @retval EFI_INVALID_PARAMETER  The mode does not fit in the framebuffer.
+**/
+EFI_STATUS
+EFIAPI
+PhyGopCoreSetMode (
+  IN OUT PHY_GOP_CORE  *Core,
+  IN     UINT32        Width,
+  IN     UINT32        Height,
+  IN     UINT32        Stride
+  )
+{
+  UINTN  Lines;
+
+  if ((Width == 0) || (Height == 0) ||
+      (Stride < Width * PHY_GOP_CORE_PIXEL_SIZE) ||
+      ((UINT64)Stride * Height > Core->FrameBufferSize)) {
+    DEBUG ((DEBUG_ERROR, "PhyGopCore: %dx%d does not fit in the framebuffer\n", Width, Height));
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((Core->Shadow != NULL) &&
+      ((Core->Width != Width) || (Core->Height != Height))) {
+    FreePool (Core->Shadow);
+    Core->Shadow = NULL;
+  }
+
+  Core->Width          = Width;
+  Core->Height         = Height;
+  Core->Stride         = Stride;
+  Core->ScanoutLine    = 0;
+  Core->MaxScanoutLine = 0;
+
+  if (PcdGetBool (PcdPhytiumGopShadowBuffer) || PcdGetBool (PcdPhytiumGopPanScroll)) {
+    if (Core->Shadow == NULL) {
+      Core->Shadow = AllocateZeroPool ((UINTN)Width * Height * PHY_GOP_CORE_PIXEL_SIZE);
+      if (Core->Shadow == NULL) {
+        DEBUG ((DEBUG_WARN, "PhyGopCore: no shadow buffer, Blt works on the framebuffer\n"));
+      }
+    } else {
+      ZeroMem (Core->Shadow, (UINTN)Width * Height * PHY_GOP_CORE_PIXEL_SIZE);
+    }
+  }
+
+  //
+  // Panning needs the shadow to write the surface back to the start of the
+  // framebuffer once the end is reached.
+  //
+  if (PcdGetBool (PcdPhytiumGopPanScroll) &&
+      (Core->SetScanout != NULL) && (Core->Shadow != NULL)) {
+    Lines = Core->FrameBufferSize / Stride;
+    Core->MaxScanoutLine = (UINT32)(Lines - Height);
+  }
+
+  ZeroMem ((VOID *)(UINTN)Core->FrameBufferBase, (UINTN)Stride * Height);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Perform a Graphics Output Protocol Blt operation on the current mode.
+
+  @param[in,out] Core          The GOP core instance.
+  @param[in,out] BltBuffer     The data to transfer to or from the screen.
+  @param[in]     BltOperation  The operation to perform.
+  @param[in]     SourceX       The X coordinate of the source.
+  @param[in]     SourceY       The Y coordinate of the source.
+  @param[in]     DestinationX  The X coordinate of the destination.
+  @param[in]     DestinationY  The Y coordinate of the destination.
+  @param[in]     Width         The width of the rectangle in pixels.
+  @param[in]     Height        The height of the rectangle in pixels.
+  @param[in]     Delta         Bytes per row of BltBuffer, 0 for Width pixels.
+
+  @retval EFI_SUCCESS            The operation is done.
+  @retval EFI_INVALID_PARAMETER  The operation or the rectangle is invalid.
+**/
+EFI_STATUS
+EFIAPI
+PhyGopCoreBlt (
+  IN OUT PHY_GOP_CORE                       *Core,
+  IN OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL      *BltBuffer,  OPTIONAL
+  IN     EFI_GRAPHICS_OUTPUT_BLT_OPERATION  BltOperation,
+  IN     UINTN                              SourceX,
+  IN     UINTN                              SourceY,
+  IN     UINTN                              DestinationX,
+  IN     UINTN                              DestinationY,
+  IN     UINTN                              Width,
+  IN     UINTN                              Height,
+  IN     UINTN                              Delta
+  )
+{
+  UINTN   Index;
+  UINTN   SrcY;
+  UINTN   DstY;
+  UINTN   LineSize;
+  UINT32  *Src;
+  UINT32  *Dst;
+  UINT32  Color;
+
+  if ((Width == 0) || (Height == 0) || (Core->Width == 0)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (((BltOperation == EfiBltVideoToBltBuffer) || (BltOperation == EfiBltVideoToVideo)) &&
+      ((SourceX + Width > Core->Width) || (SourceY + Height > Core->Height))) {
+    DEBUG ((DEBUG_ERROR, "PhyGopCore: source past screen\n"));
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((BltOperation != EfiBltVideoToBltBuffer) &&
+      ((DestinationX + Width > Core->Width) || (DestinationY + Height > Core->Height))) {
+    DEBUG ((DEBUG_ERROR, "PhyGopCore: destination past screen\n"));
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((BltOperation != EfiBltVideoToVideo) && (BltBuffer == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Delta == 0) {
+    Delta = Width * PHY_GOP_CORE_PIXEL_SIZE;
+  }
+
+  LineSize = Width * PHY_GOP_CORE_PIXEL_SIZE;
+
+  switch (BltOperation) {
+  case EfiBltVideoFill:
+    CopyMem (&Color, BltBuffer, sizeof (Color));
+    for (DstY = DestinationY; DstY < DestinationY + Height; DstY++) {
+      if (Core->Shadow != NULL) {
+        SetMem32 (ShadowLine (Core, DstY) + DestinationX, LineSize, Color);
+      }
+      SetMem32 (FrameBufferLine (Core, DstY) + DestinationX, LineSize, Color);
+    }
+    break;
+
+  case EfiBltVideoToBltBuffer:
+    for (Index = 0; Index < Height; Index++) {
+      SrcY = SourceY + Index;
+      Src  = (Core->Shadow != NULL) ? ShadowLine (Core, SrcY) : FrameBufferLine (Core, SrcY);
+      CopyMem (
+        (UINT8 *)BltBuffer + (DestinationY + Index) * Delta + DestinationX * PHY_GOP_CORE_PIXEL_SIZE,
+        Src + SourceX,
+        LineSize
+        );
+    }
+    break;
+
+  case EfiBltBufferToVideo:
+    for (Index = 0; Index < Height; Index++) {
+      DstY = DestinationY + Index;
+      Src  = (UINT32 *)((UINT8 *)BltBuffer + (SourceY + Index) * Delta +
+                        SourceX * PHY_GOP_CORE_PIXEL_SIZE);
+      if (Core->Shadow != NULL) {
+        CopyMem (ShadowLine (Core, DstY) + DestinationX, Src, LineSize);
+      }
+      CopyMem (FrameBufferLine (Core, DstY) + DestinationX, Src, LineSize);
+    }
+    break;
+
+  case EfiBltVideoToVideo:
+    if (CanPanScroll (Core, SourceX, SourceY, DestinationX, DestinationY, Width, Height)) {
+      PanScrollUp (Core, SourceY);
+      break;
+    }
+
+    //
+    // Walk the lines against the move direction so overlapping rectangles
+    // read every source line before it is overwritten.
+    //
+    for (Index = 0; Index < Height; Index++) {
+      if (DestinationY > SourceY) {
+        SrcY = SourceY + Height - 1 - Index;
+        DstY = DestinationY + Height - 1 - Index;
+      } else {
+        SrcY = SourceY + Index;
+        DstY = DestinationY + Index;
+      }
+
+      if (Core->Shadow != NULL) {
+        Dst = ShadowLine (Core, DstY) + DestinationX;
+        CopyMem (Dst, ShadowLine (Core, SrcY) + SourceX, LineSize);
+        CopyMem (FrameBufferLine (Core, DstY) + DestinationX, Dst, LineSize);
+      } else {
+        CopyMem (
+          FrameBufferLine (Core, DstY) + DestinationX,
+          FrameBufferLine (Core, SrcY) + SourceX,
+          LineSize
+          );
+      }
+    }
+    break;
+
+  default:
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Return the address of the first visible pixel.
+
+  @param[in]  Core   The GOP core instance.
+
+  @return  The framebuffer address currently scanned out.
+**/
+EFI_PHYSICAL_ADDRESS
+EFIAPI
+PhyGopCoreGetFrameBuffer (
+  IN PHY_GOP_CORE  *Core
+  )
+{
+  return Core->FrameBufferBase + (UINT64)Core->ScanoutLine * Core->Stride;
+}
+
+/**
+  Move the visible surface back to the start of the framebuffer.
+
+  Used before the framebuffer is handed over to a consumer that only knows
+  the framebuffer base, e.g. at ExitBootServices.
+
+  @param[in,out] Core   The GOP core instance.
+**/
+VOID
+EFIAPI
+PhyGopCoreResetScanout (
+  IN OUT PHY_GOP_CORE  *Core
+  )
+{
+  if (Core->ScanoutLine == 0) {
+    return;
+  }
+
+  //
+  // Panning is only enabled with a shadow, so it holds the whole surface.
+  //
+  Core->ScanoutLine = 0;
+  FlushShadowLines (Core, 0, Core->Height);
+  UpdateScanout (Core);
+}
+
+/**
+  Release the resources of a GOP core instance.
+
+  @param[in,out] Core   The GOP core instance.
+**/
+VOID
+EFIAPI
+PhyGopCoreFree (
+  IN OUT PHY_GOP_CORE  *Core
+  )
+{
+  if (Core->Shadow != NULL) {
+    FreePool (Core->Shadow);
+    Core->Shadow = NULL;
+  }
+
+  Core->Width  = 0;
+  Core->Height = 0;
+}
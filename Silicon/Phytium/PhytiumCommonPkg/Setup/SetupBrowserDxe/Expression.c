@@ -861,38 +861,55 @@ IdToQuestion (
   IN UINT16                QuestionId
   )
 {
+  LIST_ENTRY              *HashHead;
   LIST_ENTRY              *Link;
   FORM_BROWSER_STATEMENT  *Question;
 
+  if (QuestionId == 0) {
+    //
+    // The value of zero is reserved
+    //
+    return NULL;
+  }
+
+  HashHead = &FormSet->QuestionHash[QUESTION_HASH (QuestionId)];
+
   //
   // Search in the form scope first
   //
-  Question = IdToQuestion2 (Form, QuestionId);
-  if (Question != NULL) {
-    return Question;
+  if (Form != NULL) {
+    Link = GetFirstNode (HashHead);
+    while (!IsNull (HashHead, Link)) {
+      Question = FORM_BROWSER_STATEMENT_FROM_HASH_LINK (Link);
+
+      if ((Question->QuestionId == QuestionId) && (Question->ParentForm == Form)) {
+        return Question;
+      }
+
+      Link = GetNextNode (HashHead, Link);
+    }
   }
 
   //
-  // Search in the formset scope
+  // Search in the formset scope, questions are hashed in form order
   //
-  Link = GetFirstNode (&FormSet->FormListHead);
-  while (!IsNull (&FormSet->FormListHead, Link)) {
-    Form = FORM_BROWSER_FORM_FROM_LINK (Link);
+  Link = GetFirstNode (HashHead);
+  while (!IsNull (HashHead, Link)) {
+    Question = FORM_BROWSER_STATEMENT_FROM_HASH_LINK (Link);
 
-    Question = IdToQuestion2 (Form, QuestionId);
-    if (Question != NULL) {
+    if (Question->QuestionId == QuestionId) {
       //
       // EFI variable storage may be updated by Callback() asynchronous,
       // to keep synchronous, always reload the Question Value.
       //
       if (Question->Storage->Type == EFI_HII_VARSTORE_EFI_VARIABLE) {
-        GetQuestionValue (FormSet, Form, Question, GetSetValueWithHiiDriver);
+        GetQuestionValue (FormSet, Question->ParentForm, Question, GetSetValueWithHiiDriver);
       }
 
       return Question;
     }
 
-    Link = GetNextNode (&FormSet->FormListHead, Link);
+    Link = GetNextNode (HashHead, Link);
   }
 
   return NULL;
@@ -120,6 +120,11 @@ CreateQuestion (
 
   Statement->QuestionFlags = QuestionHdr->Flags;
 
+  if ((Form != NULL) && (Statement->QuestionId != 0)) {
+    Statement->ParentForm = Form;
+    InsertTailList (&FormSet->QuestionHash[QUESTION_HASH (Statement->QuestionId)], &Statement->HashLink);
+  }
+
   if (Statement->VarStoreId == 0) {
     //
     // VarStoreId of zero indicates no variable storage
@@ -284,13 +289,15 @@ FindStorageInList (
   IN EFI_HII_HANDLE        HiiHandle
   )
 {
+  LIST_ENTRY       *HashHead;
   LIST_ENTRY       *Link;
   BROWSER_STORAGE  *BrowserStorage;
 
-  Link  = GetFirstNode (&gBrowserStorageList);
-  while (!IsNull (&gBrowserStorageList, Link)) {
-    BrowserStorage = BROWSER_STORAGE_FROM_LINK (Link);
-    Link = GetNextNode (&gBrowserStorageList, Link);
+  HashHead = &gBrowserStorageHash[BROWSER_STORAGE_HASH (StorageGuid)];
+  Link  = GetFirstNode (HashHead);
+  while (!IsNull (HashHead, Link)) {
+    BrowserStorage = BROWSER_STORAGE_FROM_HASH_LINK (Link);
+    Link = GetNextNode (HashHead, Link);
 
     if ((BrowserStorage->Type == StorageType) && CompareGuid (&BrowserStorage->Guid, StorageGuid)) {
       if (StorageType == EFI_HII_VARSTORE_NAME_VALUE) {
@@ -429,6 +436,7 @@ CreateStorage (
 
     BrowserStorage->Signature = BROWSER_STORAGE_SIGNATURE;
     InsertTailList (&gBrowserStorageList, &BrowserStorage->Link);
+    InsertTailList (&gBrowserStorageHash[BROWSER_STORAGE_HASH (StorageGuid)], &BrowserStorage->HashLink);
 
     IntializeBrowserStorage (BrowserStorage, StorageType, OpCodeData);
     BrowserStorage->Type = StorageType;
@@ -1194,6 +1202,7 @@ ParseOpCodes (
   BOOLEAN                 HaveInserted;
   UINT16                  TotalBits;
   BOOLEAN                 QuestionReferBitField;
+  UINTN                   Index;
 
   SuppressForQuestion      = FALSE;
   SuppressForOption        = FALSE;
@@ -1241,6 +1250,9 @@ ParseOpCodes (
   InitializeListHead (&FormSet->DefaultStoreListHead);
   InitializeListHead (&FormSet->FormListHead);
   InitializeListHead (&FormSet->ExpressionListHead);
+  for (Index = 0; Index < QUESTION_HASH_SIZE; Index++) {
+    InitializeListHead (&FormSet->QuestionHash[Index]);
+  }
   ResetCurrentExpressionStack ();
   ResetMapExpressionListStack ();
 
@@ -45,6 +45,8 @@ LIST_ENTRY      gBrowserFormSetList = INITIALIZE_LIST_HEAD_VARIABLE (gBrowserFor
 LIST_ENTRY      gBrowserHotKeyList  = INITIALIZE_LIST_HEAD_VARIABLE (gBrowserHotKeyList);
 LIST_ENTRY      gBrowserStorageList = INITIALIZE_LIST_HEAD_VARIABLE (gBrowserStorageList);
 LIST_ENTRY      gBrowserSaveFailFormSetList = INITIALIZE_LIST_HEAD_VARIABLE (gBrowserSaveFailFormSetList);
+LIST_ENTRY      gBrowserStorageHash[BROWSER_STORAGE_HASH_SIZE];
+LIST_ENTRY      mIfrBinaryCache = INITIALIZE_LIST_HEAD_VARIABLE (mIfrBinaryCache);
 
 BOOLEAN               mSystemSubmit = FALSE;
 BOOLEAN               gResetRequiredFormLevel;
@@ -862,6 +864,44 @@ FormDisplayCallback (
                   );
 }
 
+/**
+  Drop the cached IFR binaries of a HII handle when its form packages change.
+
+  @param PackageType  Package type of the notification.
+  @param PackageGuid  Not used, must be NULL for form package.
+  @param Package      Points to the package referred to by the notification.
+  @param Handle       The HII handle.
+  @param NotifyType   The type of change concerning the database.
+
+**/
+EFI_STATUS
+EFIAPI
+IfrBinaryCacheNotify (
+  IN UINT8                              PackageType,
+  IN CONST EFI_GUID                     *PackageGuid,
+  IN CONST EFI_HII_PACKAGE_HEADER       *Package,
+  IN EFI_HII_HANDLE                     Handle,
+  IN EFI_HII_DATABASE_NOTIFY_TYPE       NotifyType
+  )
+{
+  LIST_ENTRY              *Link;
+  IFR_BINARY_CACHE_ENTRY  *Entry;
+
+  Link = GetFirstNode (&mIfrBinaryCache);
+  while (!IsNull (&mIfrBinaryCache, Link)) {
+    Entry = IFR_BINARY_CACHE_FROM_LINK (Link);
+    Link = GetNextNode (&mIfrBinaryCache, Link);
+
+    if (Entry->Handle == Handle) {
+      RemoveEntryList (&Entry->Link);
+      FreePool (Entry->BinaryData);
+      FreePool (Entry);
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
 /**
   Initialize Setup Browser driver.
 
@@ -881,6 +921,12 @@ InitializeSetup (
 {
   EFI_STATUS                  Status;
   VOID                        *Registration;
+  EFI_HANDLE                  NotifyHandle;
+  UINTN                       Index;
+
+  for (Index = 0; Index < BROWSER_STORAGE_HASH_SIZE; Index++) {
+    InitializeListHead (&gBrowserStorageHash[Index]);
+  }
 
   //
   // Locate required Hii relative protocols
@@ -905,6 +951,30 @@ InitializeSetup (
                   (VOID **) &mPathFromText
                   );
 
+  //
+  // The IFR binary cache is kept in sync with the form packages. An update
+  // of a package list removes the old form package and adds the new one.
+  //
+  Status = mHiiDatabase->RegisterPackageNotify (
+                           mHiiDatabase,
+                           EFI_HII_PACKAGE_FORMS,
+                           NULL,
+                           IfrBinaryCacheNotify,
+                           EFI_HII_DATABASE_NOTIFY_ADD_PACK,
+                           &NotifyHandle
+                           );
+  ASSERT_EFI_ERROR (Status);
+
+  Status = mHiiDatabase->RegisterPackageNotify (
+                           mHiiDatabase,
+                           EFI_HII_PACKAGE_FORMS,
+                           NULL,
+                           IfrBinaryCacheNotify,
+                           EFI_HII_DATABASE_NOTIFY_REMOVE_PACK,
+                           &NotifyHandle
+                           );
+  ASSERT_EFI_ERROR (Status);
+
   //
   // Install FormBrowser2 protocol
   //
@@ -2414,6 +2484,58 @@ NoSubmitCheck (
   return EFI_SUCCESS;
 }
 
+/**
+  Copy the blocks of a buffer storage named by a <ConfigRequest>.
+
+  The result is the same as BlockToConfig() on the source buffer followed by
+  ConfigToBlock() into the destination buffer, without building and parsing
+  the intermediate <ConfigResp> string.
+
+  @param  ConfigRequest          The config request string, "&OFFSET=####&WIDTH=####" list.
+  @param  Src                    The buffer to copy from.
+  @param  Dst                    The buffer to copy to.
+  @param  BufferSize             Size of both buffers.
+
+  @retval EFI_SUCCESS            The requested blocks are copied.
+  @retval EFI_INVALID_PARAMETER  A requested block is out of the buffer.
+
+**/
+EFI_STATUS
+SynchronizeBufferBlocks (
+  IN  CHAR16                      *ConfigRequest,
+  IN  UINT8                       *Src,
+  OUT UINT8                       *Dst,
+  IN  UINTN                       BufferSize
+  )
+{
+  CHAR16                  *StringPtr;
+  UINTN                   Offset;
+  UINTN                   Width;
+
+  StringPtr = StrStr (ConfigRequest, L"&OFFSET=");
+  while (StringPtr != NULL) {
+    StringPtr += StrLen (L"&OFFSET=");
+    Offset = StrHexToUintn (StringPtr);
+
+    StringPtr = StrStr (StringPtr, L"&WIDTH=");
+    if (StringPtr == NULL) {
+      return EFI_INVALID_PARAMETER;
+    }
+    StringPtr += StrLen (L"&WIDTH=");
+    Width = StrHexToUintn (StringPtr);
+
+    if ((Offset > BufferSize) || (Width > BufferSize - Offset)) {
+      return EFI_INVALID_PARAMETER;
+    }
+
+    CopyMem (Dst + Offset, Src + Offset, Width);
+
+    StringPtr = StrStr (StringPtr, L"&OFFSET=");
+  }
+
+  return EFI_SUCCESS;
+}
+
 /**
   Fill storage's edit copy with settings requested from Configuration Driver.
 
@@ -2435,8 +2557,6 @@ SynchronizeStorage (
   )
 {
   EFI_STATUS              Status;
-  EFI_STRING              Progress;
-  EFI_STRING              Result;
   UINTN                   BufferSize;
   LIST_ENTRY              *Link;
   NAME_VALUE_NODE         *Node;
@@ -2444,7 +2564,6 @@ SynchronizeStorage (
   UINT8                   *Dst;
 
   Status = EFI_SUCCESS;
-  Result = NULL;
 
   if (Storage->Type == EFI_HII_VARSTORE_BUFFER ||
       (Storage->Type == EFI_HII_VARSTORE_EFI_VARIABLE_BUFFER)) {
@@ -2459,28 +2578,7 @@ SynchronizeStorage (
     }
 
     if (ConfigRequest != NULL) {
-      Status = mHiiConfigRouting->BlockToConfig(
-                                    mHiiConfigRouting,
-                                    ConfigRequest,
-                                    Src,
-                                    BufferSize,
-                                    &Result,
-                                    &Progress
-                                    );
-      if (EFI_ERROR (Status)) {
-        return Status;
-      }
-
-      Status = mHiiConfigRouting->ConfigToBlock (
-                                    mHiiConfigRouting,
-                                    Result,
-                                    Dst,
-                                    &BufferSize,
-                                    &Progress
-                                    );
-      if (Result != NULL) {
-        FreePool (Result);
-      }
+      Status = SynchronizeBufferBlocks (ConfigRequest, Src, Dst, BufferSize);
     } else {
       CopyMem (Dst, Src, BufferSize);
     }
@@ -5749,7 +5847,7 @@ InitializeCurrentSetting (
 
 
 /**
-  Fetch the Ifr binary data of a FormSet.
+  Fetch the Ifr binary data of a FormSet from the HII database.
 
   @param  Handle                 PackageList Handle
   @param  FormSetGuid            On input, GUID or class GUID of a formset. If not
@@ -5768,7 +5866,7 @@ InitializeCurrentSetting (
 
 **/
 EFI_STATUS
-GetIfrBinaryData (
+ExportIfrBinaryData (
   IN  EFI_HII_HANDLE   Handle,
   IN OUT EFI_GUID      *FormSetGuid,
   OUT UINTN            *BinaryLength,
@@ -5916,6 +6014,106 @@ GetIfrBinaryData (
   return EFI_SUCCESS;
 }
 
+/**
+  Fetch the Ifr binary data of a FormSet.
+
+  The FormSet found is cached per HII handle and requested GUID, so entering
+  a formset again does not export and search the whole package list. The cache
+  of a handle is dropped when its form packages change.
+
+  @param  Handle                 PackageList Handle
+  @param  FormSetGuid            On input, GUID or class GUID of a formset. If not
+                                 specified (NULL or zero GUID), take the first
+                                 FormSet with class GUID EFI_HII_PLATFORM_SETUP_FORMSET_GUID
+                                 found in package list.
+                                 On output, GUID of the formset found(if not NULL).
+  @param  BinaryLength           The length of the FormSet IFR binary.
+  @param  BinaryData             The buffer designed to receive the FormSet.
+
+  @retval EFI_SUCCESS            Buffer filled with the requested FormSet.
+                                 BufferLength was updated.
+  @retval EFI_INVALID_PARAMETER  The handle is unknown.
+  @retval EFI_NOT_FOUND          A form or FormSet on the requested handle cannot
+                                 be found with the requested FormId.
+
+**/
+EFI_STATUS
+GetIfrBinaryData (
+  IN  EFI_HII_HANDLE   Handle,
+  IN OUT EFI_GUID      *FormSetGuid,
+  OUT UINTN            *BinaryLength,
+  OUT UINT8            **BinaryData
+  )
+{
+  EFI_STATUS              Status;
+  LIST_ENTRY              *Link;
+  IFR_BINARY_CACHE_ENTRY  *Entry;
+  EFI_GUID                RequestGuid;
+
+  //
+  // The platform setup class GUID is matched by address in ExportIfrBinaryData(),
+  // don't cache it under its value.
+  //
+  if (FormSetGuid == &gEfiHiiPlatformSetupFormsetGuid) {
+    return ExportIfrBinaryData (Handle, FormSetGuid, BinaryLength, BinaryData);
+  }
+
+  if (FormSetGuid == NULL) {
+    ZeroMem (&RequestGuid, sizeof (EFI_GUID));
+  } else {
+    CopyGuid (&RequestGuid, FormSetGuid);
+  }
+
+  Link = GetFirstNode (&mIfrBinaryCache);
+  while (!IsNull (&mIfrBinaryCache, Link)) {
+    Entry = IFR_BINARY_CACHE_FROM_LINK (Link);
+
+    if ((Entry->Handle == Handle) && CompareGuid (&Entry->RequestGuid, &RequestGuid)) {
+      *BinaryData = AllocateCopyPool (Entry->BinaryLength, Entry->BinaryData);
+      if (*BinaryData == NULL) {
+        return EFI_OUT_OF_RESOURCES;
+      }
+      *BinaryLength = Entry->BinaryLength;
+
+      if (FormSetGuid != NULL) {
+        CopyGuid (FormSetGuid, &Entry->FormSetGuid);
+      }
+
+      return EFI_SUCCESS;
+    }
+
+    Link = GetNextNode (&mIfrBinaryCache, Link);
+  }
+
+  Status = ExportIfrBinaryData (Handle, FormSetGuid, BinaryLength, BinaryData);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // Failing to cache the FormSet is not an error, it is exported again next time.
+  //
+  Entry = AllocateZeroPool (sizeof (IFR_BINARY_CACHE_ENTRY));
+  if (Entry == NULL) {
+    return EFI_SUCCESS;
+  }
+
+  Entry->BinaryData = AllocateCopyPool (*BinaryLength, *BinaryData);
+  if (Entry->BinaryData == NULL) {
+    FreePool (Entry);
+    return EFI_SUCCESS;
+  }
+
+  Entry->Signature    = IFR_BINARY_CACHE_SIGNATURE;
+  Entry->Handle       = Handle;
+  Entry->BinaryLength = *BinaryLength;
+  CopyGuid (&Entry->RequestGuid, &RequestGuid);
+  CopyGuid (&Entry->FormSetGuid, &((EFI_IFR_FORM_SET *) *BinaryData)->Guid);
+  InsertTailList (&mIfrBinaryCache, &Entry->Link);
+
+  return EFI_SUCCESS;
+}
+
 
 /**
   Initialize the internal data structure of a FormSet.
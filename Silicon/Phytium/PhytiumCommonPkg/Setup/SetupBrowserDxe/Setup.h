@@ -129,6 +129,7 @@ typedef struct {
 typedef struct {
   UINTN            Signature;
   LIST_ENTRY       Link;
+  LIST_ENTRY       HashLink;       // Link in gBrowserStorageHash
 
   UINT8            Type;           // Storage type
 
@@ -152,6 +153,14 @@ typedef struct {
 } BROWSER_STORAGE;
 
 #define BROWSER_STORAGE_FROM_LINK(a)  CR (a, BROWSER_STORAGE, Link, BROWSER_STORAGE_SIGNATURE)
+#define BROWSER_STORAGE_FROM_HASH_LINK(a)  CR (a, BROWSER_STORAGE, HashLink, BROWSER_STORAGE_SIGNATURE)
+
+//
+// gBrowserStorageList is also hashed by the storage guid, so that parsing a
+// formset does not walk every storage ever created by the browser.
+//
+#define BROWSER_STORAGE_HASH_SIZE  32
+#define BROWSER_STORAGE_HASH(Guid) (ReadUnaligned32 (&(Guid)->Data1) & (BROWSER_STORAGE_HASH_SIZE - 1))
 
 #define FORMSET_STORAGE_SIGNATURE  SIGNATURE_32 ('F', 'S', 'T', 'G')
 
@@ -293,12 +302,15 @@ typedef enum {
 } EXPRESS_LEVEL;
 
 typedef struct _FORM_BROWSER_STATEMENT FORM_BROWSER_STATEMENT;
+typedef struct _FORM_BROWSER_FORM FORM_BROWSER_FORM;
 
 #define FORM_BROWSER_STATEMENT_SIGNATURE  SIGNATURE_32 ('F', 'S', 'T', 'A')
 
 struct _FORM_BROWSER_STATEMENT{
   UINTN                 Signature;
   LIST_ENTRY            Link;
+  LIST_ENTRY            HashLink;         // Link in FORM_BROWSER_FORMSET.QuestionHash
+  FORM_BROWSER_FORM     *ParentForm;      // The form which contains this Question
 
   UINT8                 Operand;          // The operand (first byte) of this Statement or Question
   EFI_IFR_OP_HEADER     *OpCode;
@@ -374,6 +386,14 @@ struct _FORM_BROWSER_STATEMENT{
 };
 
 #define FORM_BROWSER_STATEMENT_FROM_LINK(a)  CR (a, FORM_BROWSER_STATEMENT, Link, FORM_BROWSER_STATEMENT_SIGNATURE)
+#define FORM_BROWSER_STATEMENT_FROM_HASH_LINK(a)  CR (a, FORM_BROWSER_STATEMENT, HashLink, FORM_BROWSER_STATEMENT_SIGNATURE)
+
+//
+// Questions of a formset are hashed by QuestionId, so that expressions
+// referring other questions do not walk every form of the formset.
+//
+#define QUESTION_HASH_SIZE  64
+#define QUESTION_HASH(Id)   ((Id) & (QUESTION_HASH_SIZE - 1))
 
 #define FORM_BROWSER_CONFIG_REQUEST_SIGNATURE  SIGNATURE_32 ('F', 'C', 'R', 'S')
 typedef struct {
@@ -397,7 +417,7 @@ typedef struct {
 #define FORM_BROWSER_FORM_SIGNATURE  SIGNATURE_32 ('F', 'F', 'R', 'M')
 #define STANDARD_MAP_FORM_TYPE 0x01
 
-typedef struct {
+struct _FORM_BROWSER_FORM {
   UINTN                Signature;
   LIST_ENTRY           Link;
 
@@ -416,7 +436,7 @@ typedef struct {
   LIST_ENTRY           StatementListHead;    // List of Statements and Questions (FORM_BROWSER_STATEMENT)
   LIST_ENTRY           ConfigRequestHead;    // List of configreques for all storage.
   FORM_EXPRESSION_LIST *SuppressExpression;  // nesting inside of SuppressIf
-} FORM_BROWSER_FORM;
+};
 
 #define FORM_BROWSER_FORM_FROM_LINK(a)  CR (a, FORM_BROWSER_FORM, Link, FORM_BROWSER_FORM_SIGNATURE)
 
@@ -469,6 +489,7 @@ typedef struct {
   LIST_ENTRY                      DefaultStoreListHead; // DefaultStore list (FORMSET_DEFAULTSTORE)
   LIST_ENTRY                      FormListHead;         // Form list (FORM_BROWSER_FORM)
   LIST_ENTRY                      ExpressionListHead;   // List of Expressions (FORM_EXPRESSION)
+  LIST_ENTRY                      QuestionHash[QUESTION_HASH_SIZE]; // Questions of all forms, hashed by QuestionId
 } FORM_BROWSER_FORMSET;
 #define FORM_BROWSER_FORMSET_FROM_LINK(a)  CR (a, FORM_BROWSER_FORMSET, Link, FORM_BROWSER_FORMSET_SIGNATURE)
 
@@ -481,6 +502,25 @@ typedef struct {
 
 #define FORM_BROWSER_REFRESH_EVENT_FROM_LINK(a) BASE_CR (a, FORM_BROWSER_REFRESH_EVENT_NODE, Link)
 
+#define IFR_BINARY_CACHE_SIGNATURE  SIGNATURE_32 ('I', 'F', 'R', 'C')
+
+//
+// IFR binary of a formset found in the HII database, kept until the form
+// packages of its HII handle change.
+//
+typedef struct {
+  UINTN           Signature;
+  LIST_ENTRY      Link;
+
+  EFI_HII_HANDLE  Handle;
+  EFI_GUID        RequestGuid;    // FormSet guid or class guid asked for, zero for the first formset.
+  EFI_GUID        FormSetGuid;    // Guid of the formset found.
+  UINTN           BinaryLength;
+  UINT8           *BinaryData;
+} IFR_BINARY_CACHE_ENTRY;
+
+#define IFR_BINARY_CACHE_FROM_LINK(a)  CR (a, IFR_BINARY_CACHE_ENTRY, Link, IFR_BINARY_CACHE_SIGNATURE)
+
 
 typedef struct {
   EFI_HII_HANDLE  Handle;
@@ -581,6 +621,7 @@ extern BOOLEAN               gResetRequiredFormLevel;
 extern BOOLEAN               gResetRequiredSystemLevel;
 extern BOOLEAN               gExitRequired;
 extern LIST_ENTRY            gBrowserFormSetList;
+extern LIST_ENTRY            gBrowserStorageHash[BROWSER_STORAGE_HASH_SIZE];
 extern LIST_ENTRY            gBrowserHotKeyList;
 extern BROWSER_SETTING_SCOPE gBrowserSettingScope;
 extern EXIT_HANDLER          ExitHandlerFunction;